@@ -0,0 +1,56 @@
+// Compares the heat control, built once per THERMOSTAT_HVAC_CONTROLLER.
+//
+// Simulates a January and an April week with only the heat enabled. The swing is the RMS
+// of the indoor temperature around the middle of the band between the setpoint and the
+// setpoint plus the tolerance, which is where the tolerance band control holds it on
+// average.
+#include <stdint.h>
+#include <stdio.h>
+
+#include <cmath>
+
+#include "simulation/simulator.h"
+#include "thermostat/thermostat_tasks.h"
+
+#define THERMOSTAT_STRINGIFY_(x) #x
+#define THERMOSTAT_STRINGIFY(x) THERMOSTAT_STRINGIFY_(x)
+
+namespace thermostat {
+namespace {
+
+void RunWeek(const char* const name, const double start_day_of_year) {
+  simulation::SimulationConfig config;
+  config.start_day_of_year = start_day_of_year;
+  config.persisted.cool_enabled = false;
+  simulation::Simulator simulator(config);
+
+  double sum_squares = 0;
+  const uint64_t steps = 7ULL * 24 * 60 * 60 * 1000 / config.step_ms;
+  for (uint64_t i = 0; i < steps; ++i) {
+    simulator.Step();
+    const Settings& settings = *simulator.settings();
+    const double middle_f =
+        (GetSetpointTemp(settings, simulator.clock()->Now(), HvacMode::HEAT) +
+         settings.persisted.tolerance_x10 / 2.0) / 10.0;
+    const double error_f = simulator.indoor_f() - middle_f;
+    sum_squares += error_f * error_f;
+  }
+  const simulation::SimulationReport& report = simulator.report();
+
+  printf("%-20s %-7s swing %.2fF rms  heat %5.1f h (%4.1f h high) %4u cycles  comfort error "
+         "%5.2f degree hours\n",
+         THERMOSTAT_STRINGIFY(THERMOSTAT_HVAC_CONTROLLER), name, std::sqrt(sum_squares / steps),
+         report.heat_hours, report.heat_high_hours, report.heat_cycles,
+         report.comfort_error_degree_hours);
+}
+
+int Main() {
+  RunWeek("January", 15);
+  RunWeek("April", 105);
+  return 0;
+}
+
+}  // namespace
+}  // namespace thermostat
+
+int main() { return thermostat::Main(); }
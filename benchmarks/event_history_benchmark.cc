@@ -0,0 +1,110 @@
+// Measures the per cycle cost of the event history bookkeeping and the status queries,
+// comparing the scanning functions against the running totals kept in Settings.
+//
+// The cost of the scans grows with EVENT_SIZE, which is set at build time through
+// THERMOSTAT_EVENT_SIZE.
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <cmath>
+
+#include "testing/event_scans.h"
+#include "thermostat/events.h"
+#include "thermostat/settings.h"
+#include "thermostat/thermostat_tasks.h"
+
+namespace thermostat {
+namespace {
+
+constexpr int kIterations = 200000;
+
+class BenchmarkClock : public Clock {
+ public:
+  uint32_t Millis() const override { return millis_; }
+  Date Now() override { return Date(); }
+  void Set(const Date& date) override { UNUSED(date); }
+
+  void Increment(const uint32_t millis) { millis_ += millis; }
+
+ private:
+  uint32_t millis_ = Clock::HoursToMillis(48);
+};
+
+class NullThermostatTask : public ThermostatTask {
+ public:
+  Status RunOnce(Settings* settings) override {
+    UNUSED(settings);
+    return Status::kOk;
+  }
+};
+
+// Everything the status pages show, using the scanning functions.
+uint32_t ScanStatuses(const Settings& settings, const Clock& clock) {
+  const uint32_t window = cmin(settings.events.oldest_start(), Clock::HoursToMillis(24));
+  const uint32_t day = Clock::HoursToMillis(24);
+  return CalculateSeconds(HvacMode::HEAT, settings, window, clock) +
+         CalculateSeconds(HvacMode::COOL, settings, window, clock) +
+         CalculateSeconds(FanMode::ON, settings, window, clock) +
+         CalculateSeconds(HvacMode::HEAT, settings, day, clock) +
+         CalculateSeconds(FanMode::ON, settings, day, clock) +
+         static_cast<uint32_t>(GetHeatTempPerMinX100(settings, clock));
+}
+
+// The same statuses from the running totals.
+uint32_t RecentStatuses(const Settings& settings, const Clock& clock) {
+  return RecentHistoryMillis(settings, clock.Millis()) +
+         RecentSeconds(HvacMode::HEAT, settings, clock) +
+         RecentSeconds(HvacMode::COOL, settings, clock) +
+         RecentSeconds(FanMode::ON, settings, clock) +
+         static_cast<uint32_t>(RecentHeatTempPerMinX100(settings)) +
+         OutdoorTemperatureEstimate(settings, clock);
+}
+
+template <typename Fn>
+double NanosPerCall(Fn fn) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; ++i) {
+    fn();
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / kIterations;
+}
+
+int Main() {
+  Settings settings;
+  BenchmarkClock clock;
+  NullThermostatTask null_task;
+  HistoryUpdatingThermostatTask history(&null_task);
+
+  // Fill the whole history with a heating cycle every 20 minutes.
+  for (int i = 0; i < 2 * EVENT_SIZE; ++i) {
+    settings.hvac = i % 2 == 0 ? HvacMode::HEAT : HvacMode::IDLE;
+    settings.fan = i % 2 == 0 ? FanMode::ON : FanMode::OFF;
+    settings.current_mean_temperature_x10 = 680 + i % 10;
+    settings.now = clock.Millis();
+    history.RunOnce(&settings);
+    clock.Increment(Clock::MinutesToMillis(10));
+  }
+
+  volatile uint32_t sink = 0;
+  const double scan_status_ns = NanosPerCall([&] { sink += ScanStatuses(settings, clock); });
+  const double recent_status_ns =
+      NanosPerCall([&] { sink += RecentStatuses(settings, clock); });
+  const double history_ns = NanosPerCall([&] {
+    clock.Increment(1);
+    settings.now = clock.Millis();
+    history.RunOnce(&settings);
+  });
+
+  printf("EVENT_SIZE=%3u (%4u bytes)  statuses: scan %8.1f ns  totals %6.1f ns  |  "
+         "history task %6.1f ns\n",
+         EVENT_SIZE, static_cast<unsigned>(sizeof(settings.events)), scan_status_ns,
+         recent_status_ns, history_ns);
+  return 0;
+}
+
+}  // namespace
+}  // namespace thermostat
+
+int main() { return thermostat::Main(); }
@@ -0,0 +1,87 @@
+// Compares the temperature filters, built once per THERMOSTAT_TEMPERATURE_FILTER.
+//
+// The step response is how many readings the output takes to cover 90% of a 2°F step,
+// the noise is the RMS error of the output with ±0.5°F uniform noise on the readings, and
+// the spike is how far one 10°F bad reading moves the output. A simulated January week
+// with noisy sensors then shows the effect on the heat cycling and comfort.
+#include <stdint.h>
+#include <stdio.h>
+
+#include <cmath>
+
+#include "simulation/simulator.h"
+#include "thermostat/thermostat_tasks.h"
+
+#define THERMOSTAT_STRINGIFY_(x) #x
+#define THERMOSTAT_STRINGIFY(x) THERMOSTAT_STRINGIFY_(x)
+
+namespace thermostat {
+namespace {
+
+// Uniform noise in [-1, 1] using xorshift32 so runs are reproducible.
+double Noise(uint32_t* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return (*state / 4294967295.0) * 2 - 1;
+}
+
+int StepReadings() {
+  TemperatureFilter filter;
+  for (int i = 0; i < 20; ++i) {
+    filter.Add(680);
+  }
+  for (int readings = 1; readings < 100; ++readings) {
+    if (filter.Add(700) >= 698) {
+      return readings;
+    }
+  }
+  return -1;
+}
+
+double NoiseRms() {
+  TemperatureFilter filter;
+  uint32_t state = 1;
+  double sum_squares = 0;
+  constexpr int kReadings = 100000;
+  for (int i = 0; i < kReadings; ++i) {
+    const int16_t reading = 680 + std::lround(Noise(&state) * 5);
+    const double error = (filter.Add(reading) - 680) / 10.0;
+    sum_squares += error * error;
+  }
+  return std::sqrt(sum_squares / kReadings);
+}
+
+double SpikeF() {
+  TemperatureFilter filter;
+  for (int i = 0; i < 20; ++i) {
+    filter.Add(680);
+  }
+  int max_error = std::abs(filter.Add(780) - 680);
+  for (int i = 0; i < 20; ++i) {
+    const int error = std::abs(filter.Add(680) - 680);
+    max_error = error > max_error ? error : max_error;
+  }
+  return max_error / 10.0;
+}
+
+int Main() {
+  simulation::SimulationConfig config;
+  config.start_day_of_year = 15;
+  config.sensor_noise_f = 1.0;
+  simulation::Simulator simulator(config);
+  simulator.Run(7 * 24 * 60 * 60);
+  const simulation::SimulationReport& report = simulator.report();
+
+  printf("%-24s %2zu bytes  step %2d readings  noise %.3fF rms  spike %.1fF  |  week: %u heat "
+         "cycles, comfort error %.3fF, %.1f to %.1fF\n",
+         THERMOSTAT_STRINGIFY(THERMOSTAT_TEMPERATURE_FILTER), sizeof(TemperatureFilter),
+         StepReadings(), NoiseRms(), SpikeF(), report.heat_cycles, report.MeanComfortError(),
+         report.min_indoor_f, report.max_indoor_f);
+  return 0;
+}
+
+}  // namespace
+}  // namespace thermostat
+
+int main() { return thermostat::Main(); }
@@ -0,0 +1,78 @@
+// Compares the cost of the fixed point CalculateIaqScoreQ8 against the floating point
+// calculation it replaced.
+//
+// The host has an FPU, so this understates the difference on the AVR, where every float
+// operation and log10 is a software routine.
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "thermostat/calculate_iaq.h"
+
+namespace thermostat {
+namespace {
+
+constexpr int kIterations = 2000000;
+
+// The floating point calculation CalculateIaqScoreQ8 replaced.
+float FloatIaqScore(const float humidity, const uint32_t resistance) {
+  const float humidity_quality = 100 - (std::abs(humidity - 45) - 5) * 2;
+  const float gas_resistance =
+      std::fmin(std::fmax(static_cast<float>(resistance), 5000), 50000);
+  const float gas_quality = (std::log10(gas_resistance) - std::log10(5000)) * 100.0;
+  return 0.75 * gas_quality + 0.25 * humidity_quality;
+}
+
+uint64_t Cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct Cost {
+  double ns;
+  double cycles;
+};
+
+template <typename Fn>
+Cost PerCall(Fn fn) {
+  const auto start = std::chrono::steady_clock::now();
+  const uint64_t start_cycles = Cycles();
+  for (int i = 0; i < kIterations; ++i) {
+    fn(i);
+  }
+  const uint64_t end_cycles = Cycles();
+  const auto end = std::chrono::steady_clock::now();
+  return {std::chrono::duration<double, std::nano>(end - start).count() / kIterations,
+          static_cast<double>(end_cycles - start_cycles) / kIterations};
+}
+
+int Main() {
+  // Vary the inputs so the calls can't be hoisted.
+  volatile float float_sink = 0;
+  volatile int32_t fixed_sink = 0;
+  const Cost float_cost = PerCall([&](const int i) {
+    float_sink += FloatIaqScore((i & 127) * 0.78f, 4000 + (i & 0xFFFF));
+  });
+  const Cost fixed_cost = PerCall([&](const int i) {
+    fixed_sink += CalculateIaqScoreQ8((i & 127) * 200, 4000 + (i & 0xFFFF));
+  });
+
+  printf("IAQ score  float: %6.1f ns %6.1f tsc cycles  |  fixed Q8: %6.1f ns %6.1f tsc "
+         "cycles\n",
+         float_cost.ns, float_cost.cycles, fixed_cost.ns, fixed_cost.cycles);
+  return 0;
+}
+
+}  // namespace
+}  // namespace thermostat
+
+int main() { return thermostat::Main(); }
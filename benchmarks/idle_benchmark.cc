@@ -0,0 +1,147 @@
+// Counts the main loop passes wasted spinning against sleeping with the Idler, along
+// with the button press latency of each.
+//
+// This runs on simulated time: each pass costs what the AVR spends in the analogRead and
+// the scheduler check, the tasks cost what the control cycle takes, and a button is
+// pressed at odd intervals so the presses land at every point of the poll period.
+#include <stdint.h>
+#include <stdio.h>
+
+#include "thermostat/buttons.h"
+#include "thermostat/idle.h"
+#include "thermostat/scheduler.h"
+#include "thermostat/settings.h"
+
+namespace thermostat {
+namespace {
+
+constexpr uint32_t kSimulatedSeconds = 600;
+// About 112us for the analogRead plus the scheduler and display checks.
+constexpr uint32_t kPassCostUs = 150;
+constexpr uint32_t kTaskCostUs = 5000;
+constexpr uint32_t kPressEveryUs = 1373000;
+constexpr uint32_t kPressLengthUs = 200000;
+constexpr uint16_t kPollMs = 5;
+
+class StubClock : public Clock {
+ public:
+  Date Now() override { return date_; }
+  void Set(const Date& date) override { date_ = date; }
+  uint32_t Millis() const override { return micros_ / 1000; }
+  uint32_t Micros() const override { return micros_; }
+
+  void Advance(const uint32_t micros) { micros_ += micros; }
+
+ private:
+  Date date_;
+  uint32_t micros_ = 10000000;
+};
+
+class CostlyTask : public ThermostatTask {
+ public:
+  explicit CostlyTask(StubClock* clock) : clock_(clock) {}
+
+  Status RunOnce(Settings* settings) override {
+    UNUSED(settings);
+    clock_->Advance(kTaskCostUs);
+    return Status::kOk;
+  }
+
+ private:
+  StubClock* const clock_;
+};
+
+// Sleeps by passing the simulated time, or returns right away to spin as the main loop
+// did before the Idler.
+class StubSleeper : public Sleeper {
+ public:
+  StubSleeper(StubClock* clock, const bool spin) : clock_(clock), spin_(spin) {}
+
+  void Sleep(const uint32_t duration_us) override {
+    if (!spin_) {
+      clock_->Advance(duration_us);
+      slept_us_ += duration_us;
+    }
+  }
+
+  uint64_t slept_us() const { return slept_us_; }
+
+ private:
+  StubClock* const clock_;
+  const bool spin_;
+  uint64_t slept_us_ = 0;
+};
+
+struct Result {
+  double passes_per_second;
+  double wasted_per_second;
+  double awake_percent;
+  double mean_latency_ms;
+  double max_latency_ms;
+};
+
+Result Run(const bool spin) {
+  StubClock clock;
+  StubSleeper sleeper(&clock, spin);
+  NullPrint print;
+  Settings settings;
+  CostlyTask control(&clock);
+  CostlyTask display(&clock);
+  ScheduledTask tasks[] = {
+      {"Control", &control, 1000, 500, true},
+      {"Display", &display, 250, 100, true},
+  };
+  Scheduler scheduler(&clock, &print, tasks, 2);
+  Idler idler(&clock, &sleeper, &scheduler, kPollMs);
+  Buttons buttons;
+
+  const uint32_t start_us = clock.Micros();
+  // The first press is at kPressEveryUs.
+  uint32_t last_press = 0;
+  uint64_t total_latency_us = 0;
+  uint32_t max_latency_us = 0;
+  uint32_t presses = 0;
+  while (clock.Micros() - start_us < kSimulatedSeconds * 1000000) {
+    const Status status = scheduler.RunOnce(&settings);
+
+    // Sample the button at the end of the pass, as the analogRead does.
+    clock.Advance(kPassCostUs);
+    const uint32_t elapsed_us = clock.Micros() - start_us;
+    const uint32_t press = elapsed_us / kPressEveryUs;
+    const bool down = press > 0 && elapsed_us % kPressEveryUs < kPressLengthUs;
+    const Button button = buttons.GetSinglePress(
+        buttons.StabilizedButtonPressed(Buttons::GetButton(down ? 150 : 1023)), clock.Millis());
+    if (button == Button::UP && press != last_press) {
+      const uint32_t latency_us = elapsed_us % kPressEveryUs;
+      total_latency_us += latency_us;
+      max_latency_us = latency_us > max_latency_us ? latency_us : max_latency_us;
+      presses++;
+      last_press = press;
+    }
+
+    idler.Idle(status != Status::kSkipped);
+  }
+
+  const double seconds = (clock.Micros() - start_us) / 1e6;
+  return {idler.passes() / seconds, idler.wasted() / seconds,
+          100.0 * (1.0 - sleeper.slept_us() / 1e6 / seconds),
+          presses == 0 ? 0.0 : total_latency_us / 1000.0 / presses, max_latency_us / 1000.0};
+}
+
+void PrintResult(const char* name, const Result& result) {
+  printf("%-6s %9.1f passes/s %9.1f wasted/s %6.1f%% awake  latency mean %5.1f ms max "
+         "%5.1f ms\n",
+         name, result.passes_per_second, result.wasted_per_second, result.awake_percent,
+         result.mean_latency_ms, result.max_latency_ms);
+}
+
+int Main() {
+  PrintResult("spin", Run(/*spin=*/true));
+  PrintResult("idle", Run(/*spin=*/false));
+  return 0;
+}
+
+}  // namespace
+}  // namespace thermostat
+
+int main() { return thermostat::Main(); }
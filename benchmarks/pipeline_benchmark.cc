@@ -0,0 +1,189 @@
+// Compares a full thermostat cycle through the layers wired with ThermostatTask pointers
+// against the same layers composed statically with a Pipeline.
+//
+// The host predicts the indirect calls well, so this understates the difference on the
+// AVR, where each virtual call also loads the vtable from RAM and blocks inlining.
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "thermostat/pipeline.h"
+#include "thermostat/settings.h"
+#include "thermostat/thermostat_tasks.h"
+
+namespace thermostat {
+namespace {
+
+constexpr int kIterations = 200000;
+
+class StubClock : public Clock {
+ public:
+  Date Now() override { return date_; }
+  void Set(const Date& date) override { date_ = date; }
+  uint32_t Millis() const override { return millis_; }
+
+  void Advance(const uint32_t millis) { millis_ += millis; }
+
+ private:
+  Date date_;
+  uint32_t millis_ = 10000;
+};
+
+class StubSensor : public Sensor {
+ public:
+  int16_t GetTemperatureX10() override { return temperature_x10_; }
+  uint8_t GetHumidity() override { return 40; }
+
+  void set_temperature_x10(const int16_t temperature_x10) {
+    temperature_x10_ = temperature_x10;
+  }
+
+ private:
+  int16_t temperature_x10_ = 685;
+};
+
+class StubDisplay : public Display {
+ public:
+  void write(const uint8_t ch) override { sink_ += ch; }
+
+ private:
+  volatile uint8_t sink_ = 0;
+};
+
+class StubRelays : public Relays {
+ public:
+  void Set(const RelayType relay, const RelayState state) override {
+    sink_ += static_cast<uint8_t>(relay) + static_cast<uint8_t>(state);
+  }
+
+ private:
+  volatile uint8_t sink_ = 0;
+};
+
+struct Hardware {
+  Hardware() {
+    settings.persisted = DefaultPersistedSettings();
+    settings.persisted.heat_enabled = true;
+    settings.persisted.cool_enabled = true;
+    CompileSchedules(&settings);
+  }
+
+  StubClock clock;
+  StubSensor sensor;
+  StubDisplay display;
+  StubRelays relays;
+  NullPrint print;
+  Settings settings;
+};
+
+typedef Pipeline<WrapperThermostatTask, HistoryUpdatingLayer, ErrorDisplayingLayer,
+                 UpdateDisplayLayer, RelaySettingLayer, FanControllerLayer,
+                 HeatAdvancingLayer, LockoutControllingLayer, HvacControllerLayer,
+                 SensorUpdatingLayer>
+    BenchmarkPipeline;
+
+// The layers below the pacing, which only adds a clock check.
+struct VirtualChain {
+  explicit VirtualChain(Hardware* hw)
+      : sensor_updating(&hw->clock, &hw->sensor, &hw->print, &wrapper),
+        hvac_controller(&hw->clock, &hw->print, &sensor_updating),
+        lockout_controlling(&hvac_controller),
+        heat_advancing(&lockout_controlling),
+        fan_controller(&hw->clock, &hw->print, &heat_advancing),
+        relay_setting(&hw->relays, &hw->print, &fan_controller),
+        update_display(&hw->display, &hw->print, &relay_setting),
+        error_displaying(&hw->display, &hw->print, &update_display),
+        history_updating(&error_displaying) {}
+
+  ThermostatTask* top() { return &history_updating; }
+
+  WrapperThermostatTask wrapper;
+  SensorUpdatingThermostatTask sensor_updating;
+  HvacControllerThermostatTask hvac_controller;
+  LockoutControllingThermostatTask lockout_controlling;
+  HeatAdvancingThermostatTask heat_advancing;
+  FanControllerThermostatTask fan_controller;
+  RelaySettingThermostatTask relay_setting;
+  UpdateDisplayThermostatTask update_display;
+  ErrorDisplayingThermostatTask error_displaying;
+  HistoryUpdatingThermostatTask history_updating;
+};
+
+struct StaticChain {
+  explicit StaticChain(Hardware* hw)
+      : sensor_updating(&hw->clock, &hw->sensor, &hw->print, &wrapper),
+        hvac_controller(&hw->clock, &hw->print, &sensor_updating),
+        lockout_controlling(&hvac_controller),
+        heat_advancing(&lockout_controlling),
+        fan_controller(&hw->clock, &hw->print, &heat_advancing),
+        relay_setting(&hw->relays, &hw->print, &fan_controller),
+        update_display(&hw->display, &hw->print, &relay_setting),
+        error_displaying(&hw->display, &hw->print, &update_display),
+        history_updating(&error_displaying) {}
+
+  BenchmarkPipeline::Outermost* top() { return &history_updating; }
+
+  WrapperThermostatTask wrapper;
+  BenchmarkPipeline::Of<SensorUpdatingLayer> sensor_updating;
+  BenchmarkPipeline::Of<HvacControllerLayer> hvac_controller;
+  BenchmarkPipeline::Of<LockoutControllingLayer> lockout_controlling;
+  BenchmarkPipeline::Of<HeatAdvancingLayer> heat_advancing;
+  BenchmarkPipeline::Of<FanControllerLayer> fan_controller;
+  BenchmarkPipeline::Of<RelaySettingLayer> relay_setting;
+  BenchmarkPipeline::Of<UpdateDisplayLayer> update_display;
+  BenchmarkPipeline::Of<ErrorDisplayingLayer> error_displaying;
+  BenchmarkPipeline::Of<HistoryUpdatingLayer> history_updating;
+};
+
+uint64_t Cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct Cost {
+  double ns;
+  double cycles;
+};
+
+// Runs the chain with the temperature swinging between heating and cooling.
+template <typename Chain>
+Cost PerCycle() {
+  Hardware hw;
+  Chain chain(&hw);
+  const auto start = std::chrono::steady_clock::now();
+  const uint64_t start_cycles = Cycles();
+  for (int i = 0; i < kIterations; ++i) {
+    hw.clock.Advance(2000);
+    hw.settings.now = hw.clock.Millis();
+    hw.sensor.set_temperature_x10(650 + (i / 500) % 100);
+    chain.top()->RunOnce(&hw.settings);
+    hw.settings.first_run = false;
+  }
+  const uint64_t end_cycles = Cycles();
+  const auto end = std::chrono::steady_clock::now();
+  return {std::chrono::duration<double, std::nano>(end - start).count() / kIterations,
+          static_cast<double>(end_cycles - start_cycles) / kIterations};
+}
+
+int Main() {
+  const Cost virtual_cost = PerCycle<VirtualChain>();
+  const Cost static_cost = PerCycle<StaticChain>();
+
+  printf("Thermostat cycle  virtual: %6.1f ns %6.1f tsc cycles  |  pipeline: %6.1f ns "
+         "%6.1f tsc cycles\n",
+         virtual_cost.ns, virtual_cost.cycles, static_cost.ns, static_cost.cycles);
+  return 0;
+}
+
+}  // namespace
+}  // namespace thermostat
+
+int main() { return thermostat::Main(); }
@@ -0,0 +1,39 @@
+// Scores the heat staging, built once per THERMOSTAT_HEAT_STAGING_MINUTES.
+//
+// Simulates a cold January week, where the low stage can't keep up, and a mild April week,
+// where it mostly can, and prints the heat runtime, how much of it was at the high stage,
+// how long the room spent below the setpoint and how far it overshot.
+#include <stdint.h>
+#include <stdio.h>
+
+#include "simulation/simulator.h"
+#include "thermostat/thermostat_tasks.h"
+
+namespace thermostat {
+namespace {
+
+void RunWeek(const char* const name, const double start_day_of_year) {
+  simulation::SimulationConfig config;
+  config.start_day_of_year = start_day_of_year;
+  config.persisted.cool_enabled = false;
+  simulation::Simulator simulator(config);
+  simulator.Run(7 * 24 * 60 * 60);
+  const simulation::SimulationReport& report = simulator.report();
+
+  printf("%2u minutes  %-7s heat %6.1f h (%5.1f h high) %4u cycles  comfort error %5.2f "
+         "degree hours  overshoot %.2fF max, %.2f degree hours\n",
+         kHeatStagingMinutes, name, report.heat_hours, report.heat_high_hours,
+         report.heat_cycles, report.comfort_error_degree_hours, report.max_overshoot_f,
+         report.overshoot_degree_hours);
+}
+
+int Main() {
+  RunWeek("January", 15);
+  RunWeek("April", 105);
+  return 0;
+}
+
+}  // namespace
+}  // namespace thermostat
+
+int main() { return thermostat::Main(); }
@@ -0,0 +1,104 @@
+// Lumped RC thermal model of a house with a two stage furnace, air conditioner and fan.
+//
+// This is only used on the host for simulating the thermostat over long periods of time.
+#ifndef BUILDING_MODEL_H_
+#define BUILDING_MODEL_H_
+
+#include <cmath>
+
+namespace thermostat {
+namespace simulation {
+
+constexpr double kPi = 3.14159265358979323846;
+
+struct BuildingParameters {
+  // Heat lost through the envelope per degree of indoor/outdoor difference (BTU/hr/°F).
+  double ua_btu_per_hour_f = 500;
+  // Thermal mass of the air, furniture and structure (BTU/°F).
+  double capacitance_btu_per_f = 8000;
+  // People, appliances and sun (BTU/hr).
+  double internal_gain_btu_per_hour = 1500;
+
+  double furnace_low_btu_per_hour = 40000;
+  double furnace_high_btu_per_hour = 60000;
+  double ac_btu_per_hour = 24000;
+  // The blower motor ends up as heat inside the house.
+  double fan_btu_per_hour = 1500;
+
+  // How long the heat exchanger / evaporator take to reach full output after the relay
+  // changes (seconds).
+  double equipment_time_constant_s = 120;
+};
+
+// Outdoor temperature with a yearly and daily sinusoid (defaults roughly match Wisconsin).
+struct WeatherParameters {
+  double annual_mean_f = 47;
+  double annual_amplitude_f = 28;
+  // Day of the year with the coldest average temperature.
+  double coldest_day = 20;
+  double daily_amplitude_f = 8;
+  // Hour of the day with the coldest temperature.
+  double coldest_hour = 5;
+};
+
+static double OutdoorTemperature(const WeatherParameters& weather, const double day_of_year,
+                                 const double hour_of_day) {
+  const double annual = -std::cos(2 * kPi * (day_of_year - weather.coldest_day) / 365.0);
+  const double daily = -std::cos(2 * kPi * (hour_of_day - weather.coldest_hour) / 24.0);
+  return weather.annual_mean_f + weather.annual_amplitude_f * annual +
+         weather.daily_amplitude_f * daily;
+}
+
+// What the relays are asking the equipment to do.
+struct EquipmentState {
+  bool heat = false;
+  bool heat_high = false;
+  bool cool = false;
+  bool fan = false;
+};
+
+// Single node RC model:
+//
+//   C * dT/dt = UA * (T_out - T_in) + Q_internal + Q_furnace - Q_ac + Q_fan
+//
+// The equipment output follows the relays with a first order lag.
+class BuildingModel {
+ public:
+  BuildingModel(const BuildingParameters& params, const double indoor_f)
+      : params_(params), indoor_f_(indoor_f) {}
+
+  void Step(const double dt_s, const double outdoor_f, const EquipmentState& equipment) {
+    double target_heat = 0;
+    if (equipment.heat) {
+      target_heat = equipment.heat_high ? params_.furnace_high_btu_per_hour
+                                        : params_.furnace_low_btu_per_hour;
+    }
+    const double target_cool = equipment.cool ? params_.ac_btu_per_hour : 0;
+
+    // Exact discretization of the first order equipment lag.
+    const double alpha = 1 - std::exp(-dt_s / params_.equipment_time_constant_s);
+    heat_btu_per_hour_ += (target_heat - heat_btu_per_hour_) * alpha;
+    cool_btu_per_hour_ += (target_cool - cool_btu_per_hour_) * alpha;
+
+    const double fan = (equipment.fan || equipment.heat || equipment.cool)
+                           ? params_.fan_btu_per_hour
+                           : 0;
+    const double q = params_.ua_btu_per_hour_f * (outdoor_f - indoor_f_) +
+                     params_.internal_gain_btu_per_hour + heat_btu_per_hour_ -
+                     cool_btu_per_hour_ + fan;
+    indoor_f_ += q * (dt_s / 3600.0) / params_.capacitance_btu_per_f;
+  }
+
+  double indoor_f() const { return indoor_f_; }
+
+ private:
+  const BuildingParameters params_;
+  double indoor_f_;
+  double heat_btu_per_hour_ = 0;
+  double cool_btu_per_hour_ = 0;
+};
+
+}  // namespace simulation
+}  // namespace thermostat
+
+#endif  // BUILDING_MODEL_H_
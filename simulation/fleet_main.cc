@@ -0,0 +1,39 @@
+// Simulates a fleet of independent thermostats across all cores and prints a summary.
+//
+// Usage: simulate_fleet [houses] [days] [threads] [start_day_of_year]
+//
+// A thread count of 0 uses every available core.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "simulation/fleet_runner.h"
+
+using thermostat::simulation::FleetReport;
+using thermostat::simulation::FleetRunner;
+using thermostat::simulation::MakeFleetConfigs;
+using thermostat::simulation::SimulationConfig;
+
+int main(int argc, char* argv[]) {
+  const int houses = argc > 1 ? atoi(argv[1]) : 1000;
+  const int days = argc > 2 ? atoi(argv[2]) : 7;
+  const int threads = argc > 3 ? atoi(argv[3]) : 0;
+  const double start_day_of_year = argc > 4 ? atof(argv[4]) : 0;
+
+  const std::vector<SimulationConfig> configs =
+      MakeFleetConfigs(houses, start_day_of_year, /*seed=*/1);
+
+  FleetRunner runner(threads);
+  const FleetReport fleet = runner.Run(configs, static_cast<uint64_t>(days) * 24 * 60 * 60);
+
+  printf("Simulated %u houses for %d days on %u threads in %.2fs\n", fleet.houses, days,
+         fleet.threads, fleet.wall_seconds);
+  printf("Cycles: %llu total, %.0f per second (%llu jobs stolen)\n",
+         static_cast<unsigned long long>(fleet.total_steps), fleet.CyclesPerSecond(),
+         static_cast<unsigned long long>(fleet.steals));
+  printf("Comfort error: %.3f F mean, %.3f F worst house\n", fleet.mean_comfort_error_f,
+         fleet.max_comfort_error_f);
+  printf("Max overshoot: %.2f F\n", fleet.max_overshoot_f);
+  return 0;
+}
@@ -0,0 +1,224 @@
+// Host only batch runner simulating a fleet of independent thermostats in parallel.
+//
+// Every house gets its own Simulator (Settings, decorator chain, clock and building), so
+// houses share no state and can run on any thread. Jobs are scheduled on a work-stealing
+// pool since the run time per house varies with its weather and equipment.
+#ifndef FLEET_RUNNER_H_
+#define FLEET_RUNNER_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "simulation/simulator.h"
+
+namespace thermostat {
+namespace simulation {
+
+// Fixed size thread pool where each worker owns a deque of jobs. Workers take jobs from
+// the back of their own deque and, once empty, steal from the front of the others.
+class WorkStealingPool {
+ public:
+  // A thread count of 0 uses every available core.
+  explicit WorkStealingPool(unsigned threads)
+      : threads_(threads == 0 ? std::max(1u, std::thread::hardware_concurrency())
+                              : threads) {}
+
+  // Runs job(i) for every i in [0, count) and returns once all of them finished.
+  void ParallelFor(const size_t count, const std::function<void(size_t)>& job) {
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned t = 0; t < threads_; ++t) {
+      workers.emplace_back(new Worker());
+    }
+    // Hand out contiguous blocks so the workers start without contention.
+    for (size_t i = 0; i < count; ++i) {
+      workers[i * threads_ / count]->jobs.push_back(i);
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < threads_; ++t) {
+      threads.emplace_back([this, t, &workers, &job] { Work(t, &workers, job); });
+    }
+    Work(0, &workers, job);
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+
+  unsigned threads() const { return threads_; }
+
+  // Number of jobs taken from another worker's deque since construction.
+  uint64_t steals() const { return steals_; }
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<size_t> jobs;
+  };
+
+  void Work(const unsigned self, std::vector<std::unique_ptr<Worker>>* workers,
+            const std::function<void(size_t)>& job) {
+    size_t index;
+    while (PopOwn(self, workers, &index) || Steal(self, workers, &index)) {
+      job(index);
+    }
+  }
+
+  static bool PopOwn(const unsigned self, std::vector<std::unique_ptr<Worker>>* workers,
+                     size_t* index) {
+    Worker& worker = *(*workers)[self];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.jobs.empty()) {
+      return false;
+    }
+    *index = worker.jobs.back();
+    worker.jobs.pop_back();
+    return true;
+  }
+
+  bool Steal(const unsigned self, std::vector<std::unique_ptr<Worker>>* workers,
+             size_t* index) {
+    // Jobs never get added while running, so a full pass finding nothing means done.
+    for (unsigned offset = 1; offset < threads_; ++offset) {
+      Worker& victim = *(*workers)[(self + offset) % threads_];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.jobs.empty()) {
+        *index = victim.jobs.front();
+        victim.jobs.pop_front();
+        steals_++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const unsigned threads_;
+  std::atomic<uint64_t> steals_{0};
+};
+
+// Builds a reproducible fleet of houses with varied setpoints, insulation, equipment and
+// climate around the defaults.
+static std::vector<SimulationConfig> MakeFleetConfigs(const unsigned houses,
+                                                      const double start_day_of_year,
+                                                      uint32_t seed) {
+  // xorshift32 so the same seed always builds the same fleet.
+  auto uniform = [&seed](const double low, const double high) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return low + (high - low) * (seed / 4294967295.0);
+  };
+  if (seed == 0) {
+    seed = 1;
+  }
+
+  std::vector<SimulationConfig> configs(houses);
+  for (unsigned i = 0; i < houses; ++i) {
+    SimulationConfig& config = configs[i];
+    config.start_day_of_year = start_day_of_year;
+    config.seed = i + 1;
+    config.initial_indoor_f = uniform(62, 74);
+
+    PersistedSettings& persisted = config.persisted;
+    persisted = DefaultPersistedSettings();
+    persisted.heat_enabled = true;
+    persisted.cool_enabled = true;
+    persisted.tolerance_x10 = static_cast<int>(uniform(5, 20));
+    persisted.fan_on_min_period = static_cast<uint16_t>(uniform(60, 600));
+    const int heat_offset_x10 = static_cast<int>(uniform(-30, 30));
+    const int cool_offset_x10 = static_cast<int>(uniform(-30, 30));
+    // Only the used setpoints, an offset would make the unused ones look used.
+    for (Setpoint& setpoint : persisted.heat_setpoints) {
+      if (setpoint.used()) {
+        setpoint.temperature_x10 += heat_offset_x10;
+      }
+    }
+    for (Setpoint& setpoint : persisted.cool_setpoints) {
+      if (setpoint.used()) {
+        setpoint.temperature_x10 += cool_offset_x10;
+      }
+    }
+
+    BuildingParameters& building = config.building;
+    building.ua_btu_per_hour_f = uniform(300, 900);
+    building.capacitance_btu_per_f = uniform(5000, 15000);
+    building.furnace_low_btu_per_hour = uniform(30000, 50000);
+    building.furnace_high_btu_per_hour = building.furnace_low_btu_per_hour * 1.5;
+    building.ac_btu_per_hour = uniform(18000, 36000);
+
+    config.weather.annual_mean_f = uniform(35, 65);
+    config.weather.daily_amplitude_f = uniform(4, 12);
+  }
+  return configs;
+}
+
+struct FleetReport {
+  unsigned houses = 0;
+  unsigned threads = 0;
+  double wall_seconds = 0;
+  // Sum of the thermostat RunOnce cycles across all houses.
+  uint64_t total_steps = 0;
+  uint64_t steals = 0;
+  double mean_comfort_error_f = 0;
+  double max_comfort_error_f = 0;
+  double max_overshoot_f = 0;
+  // Per house reports in the same order as the configs.
+  std::vector<SimulationReport> reports;
+
+  double CyclesPerSecond() const {
+    return wall_seconds > 0 ? total_steps / wall_seconds : 0;
+  }
+};
+
+// Simulates every config for the same amount of time and aggregates the results.
+class FleetRunner {
+ public:
+  explicit FleetRunner(const unsigned threads) : pool_(threads) {}
+
+  FleetReport Run(const std::vector<SimulationConfig>& configs, const uint64_t seconds) {
+    FleetReport fleet;
+    fleet.houses = configs.size();
+    fleet.threads = pool_.threads();
+    fleet.reports.resize(configs.size());
+
+    const uint64_t steals_before = pool_.steals();
+    const auto start = std::chrono::steady_clock::now();
+    pool_.ParallelFor(configs.size(), [&](const size_t i) {
+      Simulator simulator(configs[i]);
+      simulator.Run(seconds);
+      fleet.reports[i] = simulator.report();
+    });
+    fleet.wall_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fleet.steals = pool_.steals() - steals_before;
+
+    for (const SimulationReport& report : fleet.reports) {
+      fleet.total_steps += report.steps;
+      fleet.mean_comfort_error_f += report.MeanComfortError();
+      fleet.max_comfort_error_f =
+          std::fmax(fleet.max_comfort_error_f, report.MeanComfortError());
+      fleet.max_overshoot_f = std::fmax(fleet.max_overshoot_f, report.max_overshoot_f);
+    }
+    if (!fleet.reports.empty()) {
+      fleet.mean_comfort_error_f /= fleet.reports.size();
+    }
+    return fleet;
+  }
+
+ private:
+  WorkStealingPool pool_;
+};
+
+}  // namespace simulation
+}  // namespace thermostat
+
+#endif  // FLEET_RUNNER_H_
@@ -0,0 +1,43 @@
+// Runs the thermostat chain against the building model and prints a summary.
+//
+// Usage: simulate [days] [start_day_of_year]
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+#include "simulation/simulator.h"
+
+using thermostat::simulation::SimulationConfig;
+using thermostat::simulation::SimulationReport;
+using thermostat::simulation::Simulator;
+
+int main(int argc, char* argv[]) {
+  const int days = argc > 1 ? atoi(argv[1]) : 365;
+
+  SimulationConfig config;
+  config.start_day_of_year = argc > 2 ? atof(argv[2]) : 0;
+  config.persisted.heat_enabled = true;
+  config.persisted.cool_enabled = true;
+
+  Simulator simulator(config);
+
+  const auto start = std::chrono::steady_clock::now();
+  simulator.Run(static_cast<uint64_t>(days) * 24 * 60 * 60);
+  const double wall_s =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  const SimulationReport& report = simulator.report();
+  printf("Simulated %d days (%llu cycles) in %.2fs\n", days,
+         static_cast<unsigned long long>(report.steps), wall_s);
+  printf("Heat:   %8.1f h (%.1f h high stage) %6u cycles\n", report.heat_hours,
+         report.heat_high_hours, report.heat_cycles);
+  printf("Cool:   %8.1f h %6u cycles\n", report.cool_hours, report.cool_cycles);
+  printf("Fan:    %8.1f h %6u cycles\n", report.fan_hours, report.fan_cycles);
+  printf("Indoor: %.1f - %.1f F, max overshoot %.2f F (%.1f degree hours)\n",
+         report.min_indoor_f, report.max_indoor_f, report.max_overshoot_f,
+         report.overshoot_degree_hours);
+  printf("Comfort error: %.1f degree hours (%.3f F mean)\n",
+         report.comfort_error_degree_hours, report.MeanComfortError());
+  return 0;
+}
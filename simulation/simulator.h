@@ -0,0 +1,369 @@
+// Host only discrete-time simulator driving the real thermostat decorator chain.
+//
+// The chain is wired the same way as thermostat.ino but with simulated sensors, relays and
+// clock that are backed by a BuildingModel. This allows evaluating control changes over a
+// whole season in seconds.
+#ifndef SIMULATOR_H_
+#define SIMULATOR_H_
+
+#include <stdint.h>
+
+#include <cmath>
+
+#include "simulation/building_model.h"
+#include "thermostat/fused_sensor.h"
+#include "thermostat/interfaces.h"
+#include "thermostat/settings.h"
+#include "thermostat/thermostat_tasks.h"
+
+namespace thermostat {
+namespace simulation {
+
+constexpr uint64_t kMillisPerDay = 24ULL * 60 * 60 * 1000;
+
+// How long after the equipment stops to keep tracking the temperature overshoot.
+constexpr uint64_t kOvershootWindowMs = 30ULL * 60 * 1000;
+
+// Clock driven by the simulation rather than wall time.
+class SimulatedClock : public Clock {
+ public:
+  explicit SimulatedClock(const double start_day_of_year)
+      : start_ms_(static_cast<uint64_t>(start_day_of_year * kMillisPerDay)) {}
+
+  // Millis since boot, which wraps around like the Arduino millis().
+  uint32_t Millis() const override { return static_cast<uint32_t>(elapsed_ms_); }
+
+  Date Now() override {
+    const uint64_t minutes = (start_ms_ + elapsed_ms_) / 1000 / 60;
+    Date date;
+    date.minute = minutes % 60;
+    date.hour = (minutes / 60) % 24;
+    date.day_of_week = (minutes / 60 / 24) % 7;
+    return date;
+  }
+
+  // The simulation owns the time, so setting the date is ignored.
+  void Set(const Date& date) override { UNUSED(date); }
+
+  void Advance(const uint32_t millis) { elapsed_ms_ += millis; }
+
+  uint64_t elapsed_ms() const { return elapsed_ms_; }
+
+  double DayOfYear() const {
+    return std::fmod(static_cast<double>(start_ms_ + elapsed_ms_) / kMillisPerDay, 365.0);
+  }
+
+  double HourOfDay() const {
+    return std::fmod(static_cast<double>(start_ms_ + elapsed_ms_) / 3600000.0, 24.0);
+  }
+
+ private:
+  const uint64_t start_ms_;
+  uint64_t elapsed_ms_ = 0;
+};
+
+// Reports the building temperature with a small amount of deterministic noise.
+class SimulatedSensor : public Sensor {
+ public:
+  int16_t GetTemperatureX10() override { return static_cast<int16_t>(temperature_f_ * 10); }
+  uint8_t GetHumidity() override { return humidity_; }
+
+  void SetTemperature(const float temperature_f) { temperature_f_ = temperature_f; }
+  void SetHumidity(const float humidity) { humidity_ = humidity; }
+
+ private:
+  float temperature_f_ = 0;
+  float humidity_ = 40;
+};
+
+class SimulatedRelays : public Relays {
+ public:
+  void Set(const RelayType relay, const RelayState state) override {
+    const bool on = state == RelayState::kOn;
+    switch (relay) {
+      case RelayType::kHeat:
+        equipment_.heat = on;
+        break;
+      case RelayType::kHeatHigh:
+        equipment_.heat_high = on;
+        break;
+      case RelayType::kCool:
+        equipment_.cool = on;
+        break;
+      case RelayType::kFan:
+        equipment_.fan = on;
+        break;
+      default:
+        break;
+    }
+  }
+
+  const EquipmentState& equipment() const { return equipment_; }
+
+ private:
+  EquipmentState equipment_;
+};
+
+// Discards all debug output.
+class NullPrint : public Print {
+ public:
+  void write(uint8_t ch) override { UNUSED(ch); }
+};
+
+class NullDisplay : public Display {
+ public:
+  void write(uint8_t ch) override { UNUSED(ch); }
+};
+
+struct SimulationConfig {
+  PersistedSettings persisted = DefaultPersistedSettings();
+  BuildingParameters building;
+  WeatherParameters weather;
+
+  double start_day_of_year = 0;
+  double initial_indoor_f = 68;
+
+  // The main loop calls the chain continuously, so the pacing layer runs it as soon as
+  // kRunEveryMillis has passed.
+  uint32_t step_ms = kRunEveryMillis + 1;
+
+  // Peak to peak sensor noise, independent for each sensor.
+  double sensor_noise_f = 0.2;
+  // Whether the secondary sensor is fused with the primary, as thermostat.ino does.
+  bool fuse_secondary_sensor = true;
+  uint32_t seed = 1;
+};
+
+struct SimulationReport {
+  uint64_t steps = 0;
+  double simulated_hours = 0;
+
+  double heat_hours = 0;
+  double heat_high_hours = 0;
+  double cool_hours = 0;
+  double fan_hours = 0;
+
+  // Number of times the relay turned on.
+  uint32_t heat_cycles = 0;
+  uint32_t cool_cycles = 0;
+  uint32_t fan_cycles = 0;
+
+  // Integral of how far the room was outside of the band between the enabled heat and cool
+  // setpoints.
+  double comfort_error_degree_hours = 0;
+
+  // Largest excursion past the setpoint plus tolerance (heating) or minus the tolerance
+  // (cooling) while running or shortly after stopping.
+  double max_overshoot_f = 0;
+  // Integral of those excursions.
+  double overshoot_degree_hours = 0;
+
+  double min_indoor_f = 1000;
+  double max_indoor_f = -1000;
+
+  double MeanComfortError() const {
+    return simulated_hours > 0 ? comfort_error_degree_hours / simulated_hours : 0;
+  }
+};
+
+class Simulator {
+ public:
+  explicit Simulator(const SimulationConfig& config)
+      : config_(config),
+        clock_(config.start_day_of_year),
+        building_(config.building, config.initial_indoor_f),
+        rng_state_(config.seed == 0 ? 1 : config.seed) {
+    settings_.persisted = config.persisted;
+    CompileSchedules(&settings_);
+    settings_.changed = false;
+    settings_.heat_high = false;
+    settings_.within_tolerance = true;
+    settings_.fan = FanMode::OFF;
+    settings_.hvac = HvacMode::IDLE;
+    sensor_.SetTemperature(config.initial_indoor_f);
+    secondary_sensor_.SetTemperature(config.initial_indoor_f);
+  }
+
+  // Runs the simulation for the requested amount of simulated time.
+  void Run(const uint64_t seconds) {
+    const uint64_t steps = seconds * 1000 / config_.step_ms;
+    for (uint64_t i = 0; i < steps; ++i) {
+      Step();
+    }
+  }
+
+  void Step() {
+    const EquipmentState previous = relays_.equipment();
+
+    clock_.Advance(config_.step_ms);
+    const double dt_s = config_.step_ms / 1000.0;
+
+    // The weather changes slowly, so only update it once a simulated minute.
+    const uint64_t minute = clock_.elapsed_ms() / 60000;
+    if (minute != outdoor_minute_) {
+      outdoor_minute_ = minute;
+      outdoor_f_ =
+          OutdoorTemperature(config_.weather, clock_.DayOfYear(), clock_.HourOfDay());
+    }
+    building_.Step(dt_s, outdoor_f_, previous);
+
+    sensor_.SetTemperature(building_.indoor_f() + Noise() * config_.sensor_noise_f / 2);
+    secondary_sensor_.SetTemperature(building_.indoor_f() +
+                                     Noise() * config_.sensor_noise_f / 2);
+    pacing_thermostat_task_.RunOnce(&settings_);
+
+    Record(dt_s, previous, relays_.equipment());
+  }
+
+  const SimulationReport& report() const { return report_; }
+  Settings* settings() { return &settings_; }
+  SimulatedClock* clock() { return &clock_; }
+  double indoor_f() const { return building_.indoor_f(); }
+
+ private:
+  // Uniform noise in [-1, 1] using xorshift32 so runs are reproducible.
+  double Noise() {
+    rng_state_ ^= rng_state_ << 13;
+    rng_state_ ^= rng_state_ >> 17;
+    rng_state_ ^= rng_state_ << 5;
+    return (rng_state_ / 4294967295.0) * 2 - 1;
+  }
+
+  void Record(const double dt_s, const EquipmentState& before,
+              const EquipmentState& after) {
+    const double dt_h = dt_s / 3600.0;
+    report_.steps++;
+    report_.simulated_hours += dt_h;
+
+    if (after.heat) {
+      report_.heat_hours += dt_h;
+      if (after.heat_high) {
+        report_.heat_high_hours += dt_h;
+      }
+    }
+    if (after.cool) {
+      report_.cool_hours += dt_h;
+    }
+    if (after.fan) {
+      report_.fan_hours += dt_h;
+    }
+    report_.heat_cycles += (after.heat && !before.heat);
+    report_.cool_cycles += (after.cool && !before.cool);
+    report_.fan_cycles += (after.fan && !before.fan);
+
+    const double indoor_f = building_.indoor_f();
+    report_.min_indoor_f = std::fmin(report_.min_indoor_f, indoor_f);
+    report_.max_indoor_f = std::fmax(report_.max_indoor_f, indoor_f);
+
+    if (before.heat && !after.heat) {
+      heat_off_ms_ = clock_.elapsed_ms();
+    }
+    if (before.cool && !after.cool) {
+      cool_off_ms_ = clock_.elapsed_ms();
+    }
+
+    const Date date = clock_.Now();
+    const double tolerance_f = settings_.persisted.tolerance_x10 / 10.0;
+    if (settings_.persisted.heat_enabled) {
+      const double setpoint_f = GetSetpointTemp(settings_, date, HvacMode::HEAT) / 10.0;
+      if (indoor_f < setpoint_f) {
+        report_.comfort_error_degree_hours += (setpoint_f - indoor_f) * dt_h;
+      }
+      // Against what the heat ran to, which is ahead of the schedule during an adaptive
+      // recovery, and kept after it stops so a setback doesn't count.
+      if (after.heat) {
+        heat_limit_f_ = settings_.heat_setpoint_x10 / 10.0 + tolerance_f;
+      }
+      if (after.heat || InOvershootWindow(heat_off_ms_)) {
+        RecordOvershoot(indoor_f - heat_limit_f_, dt_h);
+      }
+    }
+    if (settings_.persisted.cool_enabled) {
+      const double setpoint_f = GetSetpointTemp(settings_, date, HvacMode::COOL) / 10.0;
+      if (indoor_f > setpoint_f) {
+        report_.comfort_error_degree_hours += (indoor_f - setpoint_f) * dt_h;
+      }
+      if (after.cool) {
+        cool_limit_f_ = setpoint_f - tolerance_f;
+      }
+      if (after.cool || InOvershootWindow(cool_off_ms_)) {
+        RecordOvershoot(cool_limit_f_ - indoor_f, dt_h);
+      }
+    }
+  }
+
+  void RecordOvershoot(const double overshoot_f, const double dt_h) {
+    report_.max_overshoot_f = std::fmax(report_.max_overshoot_f, overshoot_f);
+    if (overshoot_f > 0) {
+      report_.overshoot_degree_hours += overshoot_f * dt_h;
+    }
+  }
+
+  // The equipment keeps delivering heat/cooling for a while after the relay opens.
+  bool InOvershootWindow(const uint64_t off_ms) const {
+    return off_ms != UINT64_MAX && clock_.elapsed_ms() - off_ms < kOvershootWindowMs;
+  }
+
+  const SimulationConfig config_;
+  SimulationReport report_;
+
+  Settings settings_;
+
+  SimulatedClock clock_;
+  SimulatedSensor sensor_;
+  SimulatedSensor secondary_sensor_;
+  // Both sensors are equally noisy.
+  FusedSource temperature_sources_[2] = {
+      {&sensor_, 1, Clock::SecondsToMillis(10)},
+      {&secondary_sensor_, 1, Clock::SecondsToMillis(10)},
+  };
+  FusedSensor fused_sensor_{&clock_, temperature_sources_,
+                            static_cast<uint8_t>(config_.fuse_secondary_sensor ? 2 : 1)};
+  SimulatedRelays relays_;
+  NullPrint print_;
+  NullDisplay display_;
+
+  BuildingModel building_;
+  uint32_t rng_state_;
+  uint64_t outdoor_minute_ = UINT64_MAX;
+  double outdoor_f_ = 0;
+
+  // When the heat or cool last turned off, for measuring the overshoot that follows.
+  uint64_t heat_off_ms_ = UINT64_MAX;
+  uint64_t cool_off_ms_ = UINT64_MAX;
+  // The temperature the heat or cool last ran to.
+  double heat_limit_f_ = 0;
+  double cool_limit_f_ = 0;
+
+  // The same layers as thermostat.ino, but all run on the pacing cadence rather than by
+  // its scheduler, so every step runs the whole chain.
+  WrapperThermostatTask wrapper_thermostat_task_;
+  SensorUpdatingThermostatTask sensor_updating_thermostat_task_{
+      &clock_, &fused_sensor_, &print_, &wrapper_thermostat_task_};
+  ControllerThermostatTask hvac_controller_thermostat_task_{
+      &clock_, &print_, &sensor_updating_thermostat_task_};
+  LockoutControllingThermostatTask lockout_controlling_thermostat_task_{
+      &hvac_controller_thermostat_task_};
+  HeatAdvancingThermostatTask heat_advancing_thermostat_task_{
+      &lockout_controlling_thermostat_task_};
+  FanControllerThermostatTask fan_controller_thermostat_task_{
+      &clock_, &print_, &heat_advancing_thermostat_task_};
+  RelaySettingThermostatTask relay_setting_thermostat_task_{
+      &relays_, &print_, &fan_controller_thermostat_task_};
+  UpdateDisplayThermostatTask update_display_thermostat_task_{
+      &display_, &print_, &relay_setting_thermostat_task_};
+  ErrorDisplayingThermostatTask error_displaying_thermostat_task_{
+      &display_, &print_, &update_display_thermostat_task_};
+  HistoryUpdatingThermostatTask history_updating_thermostat_task_{
+      &error_displaying_thermostat_task_};
+  HistoryPruningThermostatTask history_pruning_thermostat_task_{
+      &history_updating_thermostat_task_};
+  LoggingThermostatTask logging_thermostat_task_{&print_,
+                                                 &history_pruning_thermostat_task_};
+  PacingThermostatTask pacing_thermostat_task_{&clock_, &logging_thermostat_task_};
+};
+
+}  // namespace simulation
+}  // namespace thermostat
+
+#endif  // SIMULATOR_H_
@@ -0,0 +1,126 @@
+#include <glog/logging.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "mock_impls.h"
+#include "thermostat/buffered_display.h"
+#include "thermostat/interfaces.h"
+#include "thermostat/settings.h"
+#include "thermostat/thermostat_tasks.h"
+
+namespace thermostat {
+
+namespace t = testing;
+
+TEST(BufferedDisplayTest, OnlySendsChangedCells) {
+  FakeDisplay lcd;
+  BufferedDisplay display(&lcd);
+  char str[17];
+
+  display.SetCursor(0, 0);
+  display.print("Hello");
+  // Nothing is sent until flushed.
+  EXPECT_EQ(lcd.write_count(), 0);
+  display.Flush();
+  EXPECT_STREQ(lcd.GetString(str, 0, 0, 5), "Hello");
+  EXPECT_EQ(lcd.write_count(), 5);
+  EXPECT_EQ(lcd.set_cursor_count(), 1);
+
+  // Rewriting the same text is free.
+  display.SetCursor(0, 0);
+  display.print("Hello");
+  display.Flush();
+  EXPECT_EQ(lcd.write_count(), 5);
+  EXPECT_EQ(lcd.set_cursor_count(), 1);
+
+  display.SetCursor(0, 0);
+  display.print("Hallo");
+  display.Flush();
+  EXPECT_STREQ(lcd.GetString(str, 0, 0, 5), "Hallo");
+  EXPECT_EQ(lcd.write_count(), 6);
+  EXPECT_EQ(lcd.set_cursor_count(), 2);
+}
+
+TEST(BufferedDisplayTest, MovesCursorOnlyBetweenRuns) {
+  FakeDisplay lcd;
+  BufferedDisplay display(&lcd);
+
+  display.SetCursor(2, 1);
+  display.print("ab");
+  display.SetCursor(10, 1);
+  display.print("c");
+  display.SetCursor(0, 0);
+  display.print("d");
+  display.Flush();
+
+  EXPECT_EQ(lcd.write_count(), 4);
+  EXPECT_EQ(lcd.set_cursor_count(), 3);
+  EXPECT_EQ(lcd.GetChar(1, 2), 'a');
+  EXPECT_EQ(lcd.GetChar(1, 3), 'b');
+  EXPECT_EQ(lcd.GetChar(1, 10), 'c');
+  EXPECT_EQ(lcd.GetChar(0, 0), 'd');
+}
+
+TEST(BufferedDisplayTest, DropsTextPastTheRow) {
+  FakeDisplay lcd;
+  BufferedDisplay display(&lcd);
+
+  display.SetCursor(14, 0);
+  display.print("xyz");
+  display.Flush();
+
+  EXPECT_EQ(lcd.write_count(), 2);
+  EXPECT_EQ(display.GetChar(0, 14), 'x');
+  EXPECT_EQ(display.GetChar(0, 15), 'y');
+  EXPECT_EQ(display.GetChar(1, 0), ' ');
+}
+
+// Counts the LCD bus traffic of the status line and a status page being redrawn every
+// loop, with and without the framebuffer.
+TEST(BufferedDisplayTest, BusTrafficBenchmark) {
+  constexpr int kLoops = 1000;
+
+  uint32_t writes[2];
+  uint32_t cursor_moves[2];
+  for (int buffered = 0; buffered < 2; ++buffered) {
+    FakeDisplay lcd;
+    BufferedDisplay framebuffer(&lcd);
+    Display* const display = buffered ? static_cast<Display*>(&framebuffer) : &lcd;
+
+    FakePrint print;
+    t::NiceMock<MockThermostatTask> wrapper;
+    ON_CALL(wrapper, RunOnce(t::_)).WillByDefault(t::Return(Status::kOk));
+    UpdateDisplayThermostatTask update_display(display, &print, &wrapper);
+    ErrorDisplayingThermostatTask error_displaying(display, &print, &update_display);
+
+    Settings settings;
+    settings.current_humidity = 40;
+    for (int i = 0; i < kLoops; ++i) {
+      // The temperature changes slowly compared to the loop.
+      settings.current_mean_temperature_x10 = 700 + i / 100;
+      error_displaying.RunOnce(&settings);
+
+      // A status page redrawn while waiting for a button press.
+      display->SetCursor(0, 1);
+      display->print("H:");
+      display->print(12);
+      display->print(" C:00 F:");
+      display->print(34 + i / 500);
+      display->print(" %");
+
+      framebuffer.Flush();
+    }
+    writes[buffered] = lcd.write_count();
+    cursor_moves[buffered] = lcd.set_cursor_count();
+  }
+
+  LOG(INFO) << "Direct: " << writes[0] << " writes, " << cursor_moves[0]
+            << " cursor moves. Buffered: " << writes[1] << " writes, " << cursor_moves[1]
+            << " cursor moves.";
+  // Only the spinner changes on most loops.
+  EXPECT_LT(writes[1] * 10, writes[0]);
+  EXPECT_LT(cursor_moves[1], cursor_moves[0]);
+}
+
+}  // namespace thermostat
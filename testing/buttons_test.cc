@@ -21,43 +21,79 @@ TEST(ButtonsTest, GetButton) {
 }
 
 TEST(ButtonsTest, GetSingleButton) {
-  Buttons::GetSinglePress(Button::NONE, 0);
+  Buttons buttons;
 
-  EXPECT_EQ(Buttons::GetSinglePress(Button::LEFT, 0), Button::LEFT);
-  EXPECT_EQ(Buttons::GetSinglePress(Button::LEFT, 0), Button::NONE);
+  EXPECT_EQ(buttons.GetSinglePress(Button::LEFT, 0), Button::LEFT);
+  EXPECT_EQ(buttons.GetSinglePress(Button::LEFT, 0), Button::NONE);
 
   // Every 250 ms after 1 second of holding.
-  EXPECT_EQ(Buttons::GetSinglePress(Button::LEFT, 900), Button::NONE);
-  EXPECT_EQ(Buttons::GetSinglePress(Button::LEFT, 1000), Button::LEFT);
-  EXPECT_EQ(Buttons::GetSinglePress(Button::LEFT, 1200), Button::NONE);
-  EXPECT_EQ(Buttons::GetSinglePress(Button::LEFT, 1250), Button::LEFT);
+  EXPECT_EQ(buttons.GetSinglePress(Button::LEFT, 900), Button::NONE);
+  EXPECT_EQ(buttons.GetSinglePress(Button::LEFT, 1000), Button::LEFT);
+  EXPECT_EQ(buttons.GetSinglePress(Button::LEFT, 1200), Button::NONE);
+  EXPECT_EQ(buttons.GetSinglePress(Button::LEFT, 1250), Button::LEFT);
 
   // Every 25 ms after 5 seconds of holding.
-  EXPECT_EQ(Buttons::GetSinglePress(Button::LEFT, 5000), Button::LEFT);
-  EXPECT_EQ(Buttons::GetSinglePress(Button::LEFT, 5020), Button::NONE);
-  EXPECT_EQ(Buttons::GetSinglePress(Button::LEFT, 5025), Button::LEFT);
+  EXPECT_EQ(buttons.GetSinglePress(Button::LEFT, 5000), Button::LEFT);
+  EXPECT_EQ(buttons.GetSinglePress(Button::LEFT, 5020), Button::NONE);
+  EXPECT_EQ(buttons.GetSinglePress(Button::LEFT, 5025), Button::LEFT);
 }
 
 TEST(ButtonTest, StabilizedButtonPressed) {
-  // Ensure we're stabilized since this uses a static.
-  for (int i = 0; i < 10; ++i) {
-    Buttons::StabilizedButtonPressed(Button::NONE);
-  }
+  Buttons buttons;
 
   // Oscillating input should delay stabilization.
-  EXPECT_EQ(Buttons::StabilizedButtonPressed(Button::LEFT), Button::NONE);
-  EXPECT_EQ(Buttons::StabilizedButtonPressed(Button::RIGHT), Button::NONE);
-  EXPECT_EQ(Buttons::StabilizedButtonPressed(Button::NONE), Button::NONE);
+  EXPECT_EQ(buttons.StabilizedButtonPressed(Button::LEFT), Button::NONE);
+  EXPECT_EQ(buttons.StabilizedButtonPressed(Button::RIGHT), Button::NONE);
+  EXPECT_EQ(buttons.StabilizedButtonPressed(Button::NONE), Button::NONE);
 
   // After several matching button presses, it should stabilize.
-  EXPECT_EQ(Buttons::StabilizedButtonPressed(Button::LEFT), Button::NONE);
-  EXPECT_EQ(Buttons::StabilizedButtonPressed(Button::LEFT), Button::NONE);
-  EXPECT_EQ(Buttons::StabilizedButtonPressed(Button::LEFT), Button::LEFT);
+  EXPECT_EQ(buttons.StabilizedButtonPressed(Button::LEFT), Button::NONE);
+  EXPECT_EQ(buttons.StabilizedButtonPressed(Button::LEFT), Button::NONE);
+  EXPECT_EQ(buttons.StabilizedButtonPressed(Button::LEFT), Button::LEFT);
 
   // Same behavior going back to none pressed.
-  EXPECT_EQ(Buttons::StabilizedButtonPressed(Button::NONE), Button::LEFT);
-  EXPECT_EQ(Buttons::StabilizedButtonPressed(Button::NONE), Button::LEFT);
-  EXPECT_EQ(Buttons::StabilizedButtonPressed(Button::NONE), Button::NONE);
+  EXPECT_EQ(buttons.StabilizedButtonPressed(Button::NONE), Button::LEFT);
+  EXPECT_EQ(buttons.StabilizedButtonPressed(Button::NONE), Button::LEFT);
+  EXPECT_EQ(buttons.StabilizedButtonPressed(Button::NONE), Button::NONE);
+}
+
+TEST(ButtonTest, InstancesAreIndependent) {
+  Buttons first;
+  Buttons second;
+
+  EXPECT_EQ(first.GetSinglePress(Button::LEFT, 0), Button::LEFT);
+  // A different press on the other instance doesn't restart the first one's hold.
+  EXPECT_EQ(second.GetSinglePress(Button::RIGHT, 500), Button::RIGHT);
+  EXPECT_EQ(first.GetSinglePress(Button::LEFT, 1000), Button::LEFT);
+  EXPECT_EQ(second.GetSinglePress(Button::RIGHT, 1000), Button::NONE);
+
+  for (int i = 0; i < 3; ++i) {
+    first.StabilizedButtonPressed(Button::UP);
+  }
+  EXPECT_EQ(first.StabilizedButtonPressed(Button::UP), Button::UP);
+  EXPECT_EQ(second.StabilizedButtonPressed(Button::UP), Button::NONE);
+}
+
+TEST(SampledButtonsTest, PressesAfterThreeReadings) {
+  SampledButtons buttons(5120);
+
+  EXPECT_EQ(buttons.Add(1023), Button::NONE);
+  EXPECT_EQ(buttons.Add(150), Button::NONE);
+  EXPECT_EQ(buttons.Add(150), Button::NONE);
+  EXPECT_EQ(buttons.Add(150), Button::UP);
+  EXPECT_EQ(buttons.Add(150), Button::NONE);
+}
+
+TEST(SampledButtonsTest, AutoPressesFromTheReadingCount) {
+  SampledButtons buttons(5120);
+  int presses = 0;
+  // Holding for 2 seconds is one press, then auto-presses at 1, 1.25, 1.5 and 1.75 seconds.
+  for (int i = 0; i < 2000000 / 5120; ++i) {
+    presses += buttons.Add(150) == Button::UP ? 1 : 0;
+  }
+
+  EXPECT_EQ(buttons.now_ms(), 1996);
+  EXPECT_EQ(presses, 1 + 4);
 }
 
 }  // namespace
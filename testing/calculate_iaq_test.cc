@@ -1,4 +1,5 @@
 
+#include <glog/logging.h>
 #include <gtest/gtest.h>
 #include <stdint.h>
 
@@ -35,10 +36,51 @@ TEST(CalculateIaqScore, WithTypicalValues) {
   }
 
   {
-    const float score = CalculateIaqScore(45.0, 10000);
+    const float score = CalculateIaqScore(45, 10000);
     EXPECT_LT(score, 60) << "ideal humidity, moderate gas";
     EXPECT_GT(score, 40) << "ideal humidity, moderate gas";
   }
 }
 
+// The floating point calculation the fixed point one replaced.
+float FloatIaqScore(const float humidity, const uint32_t resistance) {
+  const float humidity_quality = 100 - (std::abs(humidity - 45) - 5) * 2;
+  const float gas_resistance =
+      std::fmin(std::fmax(static_cast<float>(resistance), 5000), 50000);
+  const float gas_quality = (std::log10(gas_resistance) - std::log10(5000)) * 100.0;
+  return 0.75 * gas_quality + 0.25 * humidity_quality;
+}
+
+TEST(CalculateIaqScore, MatchesFloatingPoint) {
+  float worst_error = 0;
+  for (int humidity_x2 = 0; humidity_x2 <= 200; ++humidity_x2) {
+    for (uint32_t resistance = 0; resistance <= 60000; resistance += 97) {
+      const float humidity = humidity_x2 / 2.0;
+      const float error = std::abs(CalculateIaqScoreQ8(humidity_x2 * 128, resistance) / 256.0 -
+                                   FloatIaqScore(humidity, resistance));
+      worst_error = std::fmax(worst_error, error);
+      ASSERT_LE(error, 0.5) << humidity << "% " << resistance << " ohms";
+    }
+  }
+  LOG(INFO) << "Worst error: " << worst_error;
+}
+
+TEST(CalculateIaqScore, RoundsAndClamps) {
+  EXPECT_EQ(CalculateIaqScore(45, 50000), 100);
+  EXPECT_EQ(CalculateIaqScore(45, 10000), 50);
+  EXPECT_EQ(CalculateIaqScore(100, 0), 0);
+}
+
+TEST(CalculateIaqScore, ClampsHumidity) {
+  // 100% is the worst humidity, and still matches the floating point score.
+  EXPECT_NEAR(CalculateIaqScoreQ8(100 * 256, 50000) / 256.0, FloatIaqScore(100, 50000), 0.5);
+  EXPECT_EQ(CalculateIaqScore(100, 50000), 75);
+
+  // A bad reading above 100% scores as 100% instead of overflowing.
+  EXPECT_EQ(CalculateIaqScoreQ8(255 * 256, 50000), CalculateIaqScoreQ8(100 * 256, 50000));
+  EXPECT_EQ(CalculateIaqScoreQ8(0xFFFF, 5000), CalculateIaqScoreQ8(100 * 256, 5000));
+  EXPECT_EQ(CalculateIaqScore(255, 50000), 75);
+  EXPECT_EQ(CalculateIaqScore(255, 0), 0);
+}
+
 }  // namespace thermostat
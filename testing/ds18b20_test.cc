@@ -0,0 +1,135 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "mock_impls.h"
+#include "thermostat/ds18b20.h"
+
+namespace thermostat {
+namespace {
+
+// Records the DallasTemperature calls.
+class FakeBus {
+ public:
+  void begin() {}
+  bool getAddress(uint8_t* address, const uint8_t index) {
+    UNUSED(index);
+    address[0] = 0x28;
+    return present;
+  }
+  void setWaitForConversion(const bool wait) { waits = wait; }
+  bool setResolution(const uint8_t* address, const uint8_t bits) {
+    UNUSED(address);
+    resolution = bits;
+    return true;
+  }
+  bool requestTemperaturesByAddress(const uint8_t* address) {
+    EXPECT_EQ(address[0], 0x28);
+    ++requests;
+    return true;
+  }
+  int16_t getTemp(const uint8_t* address) {
+    EXPECT_EQ(address[0], 0x28);
+    ++reads;
+    return raw;
+  }
+
+  bool present = true;
+  bool waits = true;
+  uint8_t resolution = 0;
+  int requests = 0;
+  int reads = 0;
+  // 20°C in 1/128°C.
+  int16_t raw = 20 * 128;
+};
+
+class Ds18b20Test : public testing::Test {
+ protected:
+  void SetUp() override {
+    clock.SetMillis(10000);
+    sensor.SetUp();
+  }
+
+  FakeClock clock;
+  FakeBus bus;
+  Ds18b20<FakeBus> sensor = Ds18b20<FakeBus>(&bus, &clock, Ds18b20Resolution::k12Bit);
+};
+
+TEST(Ds18b20ConversionTest, ConversionMillis) {
+  EXPECT_EQ(Ds18b20ConversionMillis(Ds18b20Resolution::k9Bit), 94);
+  EXPECT_EQ(Ds18b20ConversionMillis(Ds18b20Resolution::k10Bit), 188);
+  EXPECT_EQ(Ds18b20ConversionMillis(Ds18b20Resolution::k11Bit), 375);
+  EXPECT_EQ(Ds18b20ConversionMillis(Ds18b20Resolution::k12Bit), 750);
+}
+
+TEST_F(Ds18b20Test, SetsUpTheBus) {
+  EXPECT_FALSE(bus.waits);
+  EXPECT_EQ(bus.resolution, 12);
+}
+
+TEST_F(Ds18b20Test, ReadsOnlyAfterTheConversionTime) {
+  sensor.StartRequestAsync();
+  EXPECT_EQ(bus.requests, 1);
+
+  clock.Increment(749);
+  EXPECT_FALSE(sensor.EndReading());
+  // A running conversion isn't restarted.
+  sensor.StartRequestAsync();
+  EXPECT_EQ(bus.requests, 1);
+  EXPECT_EQ(bus.reads, 0);
+
+  clock.Increment(1);
+  EXPECT_TRUE(sensor.EndReading());
+  EXPECT_EQ(sensor.GetTemperatureX10(), 680);
+  EXPECT_EQ(sensor.reading_ms(), 10750);
+  EXPECT_EQ(bus.reads, 1);
+
+  // The getters don't touch the bus.
+  sensor.GetTemperatureX10();
+  EXPECT_TRUE(sensor.EndReading());
+  EXPECT_EQ(bus.reads, 1);
+}
+
+TEST_F(Ds18b20Test, KeepsTheLastValidReading) {
+  sensor.StartRequestAsync();
+  clock.Increment(750);
+  EXPECT_TRUE(sensor.EndReading());
+
+  bus.raw = Ds18b20<FakeBus>::kDisconnectedRaw;
+  sensor.StartRequestAsync();
+  clock.Increment(750);
+  EXPECT_FALSE(sensor.EndReading());
+  EXPECT_EQ(sensor.GetTemperatureX10(), 680);
+  EXPECT_EQ(sensor.reading_ms(), 10750);
+
+  // The next conversion is started after the failed one.
+  sensor.StartRequestAsync();
+  EXPECT_EQ(bus.requests, 3);
+}
+
+TEST_F(Ds18b20Test, LowerResolutionConvertsFaster) {
+  Ds18b20<FakeBus> fast(&bus, &clock, Ds18b20Resolution::k9Bit);
+  fast.SetUp();
+  EXPECT_EQ(bus.resolution, 9);
+
+  // 20.0625°C, which has bits below the 0.5°C resolution.
+  bus.raw = 20 * 128 + 8;
+  fast.StartRequestAsync();
+  clock.Increment(94);
+  EXPECT_TRUE(fast.EndReading());
+  EXPECT_EQ(fast.GetTemperatureX10(), 680);
+}
+
+TEST_F(Ds18b20Test, MissingSensorIsNeverValid) {
+  bus.present = false;
+  Ds18b20<FakeBus> missing(&bus, &clock, Ds18b20Resolution::k12Bit);
+  missing.SetUp();
+
+  missing.StartRequestAsync();
+  clock.Increment(1000);
+  EXPECT_FALSE(missing.EndReading());
+  EXPECT_EQ(bus.requests, 0);
+}
+
+}  // namespace
+}  // namespace thermostat
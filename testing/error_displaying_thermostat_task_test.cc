@@ -0,0 +1,74 @@
+#include <glog/logging.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "mock_impls.h"
+#include "thermostat/interfaces.h"
+#include "thermostat/settings.h"
+#include "thermostat/thermostat_tasks.h"
+
+namespace thermostat {
+
+namespace t = testing;
+
+class ErrorDisplayingThermostatTaskTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ON_CALL(first_wrapper, RunOnce(t::_)).WillByDefault(t::Return(Status::kOk));
+    ON_CALL(second_wrapper, RunOnce(t::_)).WillByDefault(t::Return(Status::kOk));
+  }
+
+ protected:
+  FakePrint print;
+
+  // Two independent thermostats.
+  Settings first_settings;
+  FakeDisplay first_display;
+  t::NiceMock<MockThermostatTask> first_wrapper;
+  ErrorDisplayingThermostatTask first_task =
+      ErrorDisplayingThermostatTask(&first_display, &print, &first_wrapper);
+
+  Settings second_settings;
+  FakeDisplay second_display;
+  t::NiceMock<MockThermostatTask> second_wrapper;
+  ErrorDisplayingThermostatTask second_task =
+      ErrorDisplayingThermostatTask(&second_display, &print, &second_wrapper);
+};
+
+TEST_F(ErrorDisplayingThermostatTaskTest, LatchesError) {
+  EXPECT_CALL(first_wrapper, RunOnce(t::_))
+      .WillOnce(t::Return(Status::kPrimarySensorFail))
+      .WillRepeatedly(t::Return(Status::kOk));
+
+  EXPECT_EQ(first_task.RunOnce(&first_settings), Status::kPrimarySensorFail);
+  EXPECT_EQ(first_settings.status, Status::kPrimarySensorFail);
+  EXPECT_EQ(first_display.GetChar(0, 15), 'C');
+
+  // Stays latched after recovering.
+  EXPECT_EQ(first_task.RunOnce(&first_settings), Status::kOk);
+  EXPECT_EQ(first_settings.status, Status::kPrimarySensorFail);
+  EXPECT_EQ(first_display.GetChar(0, 15), 'C');
+}
+
+TEST_F(ErrorDisplayingThermostatTaskTest, InstancesAreIndependent) {
+  EXPECT_CALL(first_wrapper, RunOnce(t::_))
+      .WillOnce(t::Return(Status::kHeatAndCool))
+      .WillRepeatedly(t::Return(Status::kOk));
+
+  first_task.RunOnce(&first_settings);
+  second_task.RunOnce(&second_settings);
+
+  // The error on one thermostat doesn't leak into the other.
+  EXPECT_EQ(first_settings.status, Status::kHeatAndCool);
+  EXPECT_EQ(second_settings.status, Status::kOk);
+  EXPECT_EQ(second_display.GetChar(0, 15), '-');
+
+  // Each spinner advances on its own.
+  second_task.RunOnce(&second_settings);
+  EXPECT_EQ(second_display.GetChar(0, 15), '\1');
+  first_task.RunOnce(&first_settings);
+  EXPECT_EQ(first_display.GetChar(0, 15), 'D');
+}
+
+}  // namespace thermostat
@@ -0,0 +1,126 @@
+#ifndef EVENT_SCANS_H_
+#define EVENT_SCANS_H_
+// Reference versions of the event status queries which scan the whole history.
+//
+// The firmware answers these from the running Settings::event_totals instead, see
+// events.h. The tests and the event history benchmark compare the totals against these.
+
+#include "thermostat/events.h"
+#include "thermostat/settings.h"
+
+namespace thermostat {
+
+// Returns the average heating temperature change per minute over the last day in
+// degrees x100, or 0 without any heat rises.
+static int16_t GetHeatTempPerMinX100(const Settings& settings, const Clock& clock) {
+  const uint32_t now = clock.Millis();
+  // Find the average 10 minute temperature difference when heating (in the last day).
+  uint8_t count = 0;
+  int32_t sum = 0;
+  // Find any events in the last day that have heat and 10 minute run time temperature.
+  uint32_t start_time = settings.events.newest_start();
+  for (uint8_t age = 0; age < settings.events.size(); ++age) {
+    if (age > 0) {
+      start_time -= settings.events.StartDeltaMillis(age - 1);
+    }
+
+    if (Clock::MillisDiff(start_time, now) > kEventHorizon) {
+      // Everything older is outside of the horizon too.
+      break;
+    }
+
+    int16_t rise_x10;
+    if (!settings.events.GetHeatRise(age, &rise_x10)) {
+      continue;
+    }
+    count++;
+    sum += rise_x10;
+  }
+
+  // Use this heat/time as the basis for the temperature.
+  // Complete guesses atm.
+  // if ~ 1*/min set to 15%
+  // if ~ 2*/min set to 25%
+  // if ~ 3*/min set to 35%
+
+  if (count == 0) {
+    return 0;
+  }
+  // sum / 10 (x10) / count / 9.5 mins * 100 (x100).
+  return sum * 100 / (static_cast<int32_t>(count) * kTenMinuteAdjustmentMinsX10);
+}
+
+// Returns how long the system has been either running or not running.
+static uint32_t CalculateSeconds(const FanMode fan, const Settings& settings,
+                                 const uint32_t history_window_ms, const Clock& clock) {
+  uint32_t total_seconds = 0;
+  const uint32_t now = clock.Millis();
+
+  // Loop through all the stored events.
+  uint32_t start_time = settings.events.newest_start();
+  for (uint8_t age = 0; age < settings.events.size(); ++age) {
+    if (age > 0) {
+      start_time -= settings.events.StartDeltaMillis(age - 1);
+    }
+    const uint32_t duration_ms = CalculateDurationSinceTime(
+                                   now - history_window_ms,
+                                   start_time,
+                                   GetEventDuration(age, settings, now));
+
+    // Only sum events that have a duration.
+    if (duration_ms == 0) {
+      continue;
+    }
+
+    // Only sum events that match the desired running state.
+    if (settings.events.fan(age) != fan) {
+      continue;
+    }
+
+    total_seconds += duration_ms / 1000;
+  }
+
+  return total_seconds;
+};
+
+// Returns how long the system has been either running or not running.
+static uint32_t CalculateSeconds(const HvacMode hvac, const Settings& settings,
+                                 const uint32_t history_window_ms, const Clock& clock) {
+  uint32_t total_seconds = 0;
+  const uint32_t now = clock.Millis();
+
+  // Loop through all the stored events.
+  uint32_t start_time = settings.events.newest_start();
+  for (uint8_t age = 0; age < settings.events.size(); ++age) {
+    if (age > 0) {
+      start_time -= settings.events.StartDeltaMillis(age - 1);
+    }
+    uint32_t duration_ms = GetEventDuration(age, settings, now);
+
+    // Clip to the amount during the history window.
+    //
+    // TODO: Fix the millis wrap around issue if this is used for more
+    // than simple user output.
+    if (now - history_window_ms < start_time + duration_ms &&
+        now - history_window_ms >= start_time) {
+      duration_ms = (start_time + duration_ms) - (now - history_window_ms);
+    }
+
+    // Only sum events that valid and have a duration.
+    if (duration_ms == 0) {
+      continue;
+    }
+
+    // Only sum events that match the desired running state.
+    if (settings.events.hvac(age) != hvac) {
+      continue;
+    }
+
+    total_seconds += duration_ms / 1000;
+  }
+
+  return total_seconds;
+};
+
+}  // namespace thermostat
+#endif  // EVENT_SCANS_H_
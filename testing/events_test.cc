@@ -7,6 +7,7 @@
 
 #include <cmath>
 
+#include "event_scans.h"
 #include "mock_impls.h"
 #include "thermostat/comparison.h"
 #include "thermostat/events.h"
@@ -21,7 +22,7 @@ TEST(EventsTest, InitialConditions) {
   Settings settings;
   FakeClock clock;
   
-  EXPECT_EQ(settings.CurrentEventIndex(), -1);
+  EXPECT_TRUE(settings.events.empty());
   for (int i = -1; i < EVENT_SIZE; ++i) {
     EXPECT_EQ(GetEventDuration(i, settings, clock.Millis()), 0);
   }
@@ -49,23 +50,24 @@ TEST(EventsTest, HeatRiseNoEvents) {
   EXPECT_EQ(HeatRise(settings,clock), 000);
 }
 
+// Opens a new event at the current time.
+void AddEvent(Settings* settings, const FakeClock& clock, const HvacMode hvac,
+              const FanMode fan, const int temperature_x10) {
+  settings->now = clock.Millis();
+  settings->current_mean_temperature_x10 = temperature_x10;
+  PushEvent(settings, hvac, fan);
+}
+
 TEST(EventsTest, SeveralEvents) {
   Settings settings;
 
   FakeClock clock;
   // Move forward so we don't start at 0.
   clock.Increment(Clock::HoursToMillis(48));
-  
-  int i = 0;
-  {
-    settings.event_index = i;
-    settings.events[i].hvac = HvacMode::HEAT;
-    settings.events[i].fan = FanMode::ON;
-    settings.events[i].temperature_x10 = 75;
-    settings.events[i].start_time = clock.Millis();
-  }
 
-  EXPECT_EQ(settings.CurrentEventIndex(), 0);
+  AddEvent(&settings, clock, HvacMode::HEAT, FanMode::ON, 75);
+
+  EXPECT_EQ(settings.events.size(), 1);
   EXPECT_FALSE(IsInLockoutMode(HvacMode::HEAT, settings.events, clock.Millis()));
   EXPECT_TRUE(IsInLockoutMode(HvacMode::COOL, settings.events, clock.Millis()));
 
@@ -77,44 +79,24 @@ TEST(EventsTest, SeveralEvents) {
   EXPECT_EQ(CalculateSeconds(HvacMode::HEAT, settings, Clock::HoursToMillis(24), clock),
             Clock::MinutesToSeconds(24));
 
-  {
-    ++i;
-    settings.event_index = i;
-    settings.events[i].hvac = HvacMode::IDLE;
-    settings.events[i].fan = FanMode::ON;
-    settings.events[i].temperature_x10 = 75;
-    settings.events[i].start_time = clock.Millis();
-  }
+  AddEvent(&settings, clock, HvacMode::IDLE, FanMode::ON, 75);
 
   clock.Increment(Clock::MinutesToMillis(10));
 
-  {
-    ++i;
-    settings.event_index = i;
-    settings.events[i].hvac = HvacMode::IDLE;
-    settings.events[i].fan = FanMode::OFF;
-    settings.events[i].temperature_x10 = 73;
-    settings.events[i].start_time = clock.Millis();
-  }
+  AddEvent(&settings, clock, HvacMode::IDLE, FanMode::OFF, 73);
 
   clock.Increment(Clock::MinutesToMillis(25));
 
-  EXPECT_EQ(settings.CurrentEventIndex(), 2);
+  EXPECT_EQ(settings.events.size(), 3);
 
   EXPECT_EQ(CalculateSeconds(FanMode::ON, settings, Clock::HoursToMillis(24), clock),
             Clock::MinutesToSeconds(24 + 10));
   EXPECT_EQ(CalculateSeconds(HvacMode::HEAT, settings, Clock::HoursToMillis(2), clock),
             Clock::MinutesToSeconds(24));
 
-  {
-    ++i;
-    settings.event_index = i;
-    settings.events[i].hvac = HvacMode::COOL;
-    settings.events[i].temperature_x10 = 75;
-    settings.events[i].start_time = clock.Millis();
-  }
+  AddEvent(&settings, clock, HvacMode::COOL, FanMode::OFF, 75);
 
-  EXPECT_EQ(settings.CurrentEventIndex(), 3);
+  EXPECT_EQ(settings.events.size(), 4);
 
   EXPECT_TRUE(IsInLockoutMode(HvacMode::HEAT, settings.events, clock.Millis()));
   EXPECT_FALSE(IsInLockoutMode(HvacMode::COOL, settings.events, clock.Millis()));
@@ -125,10 +107,11 @@ TEST(EventsTest, SeveralEvents) {
   EXPECT_TRUE(IsInLockoutMode(HvacMode::HEAT, settings.events, clock.Millis()));
   EXPECT_FALSE(IsInLockoutMode(HvacMode::COOL, settings.events, clock.Millis()));
 
-  EXPECT_EQ(GetEventDuration(0, settings, clock.Millis()), Clock::MinutesToMillis(24));
-  EXPECT_EQ(GetEventDuration(1, settings, clock.Millis()), Clock::MinutesToMillis(10));
-  EXPECT_EQ(GetEventDuration(2, settings, clock.Millis()), Clock::MinutesToMillis(25));
-  EXPECT_EQ(GetEventDuration(3, settings, clock.Millis()), Clock::MinutesToMillis(17));
+  // Newest first.
+  EXPECT_EQ(GetEventDuration(0, settings, clock.Millis()), Clock::MinutesToMillis(17));
+  EXPECT_EQ(GetEventDuration(1, settings, clock.Millis()), Clock::MinutesToMillis(25));
+  EXPECT_EQ(GetEventDuration(2, settings, clock.Millis()), Clock::MinutesToMillis(10));
+  EXPECT_EQ(GetEventDuration(3, settings, clock.Millis()), Clock::MinutesToMillis(24));
   for (int i = 4; i < EVENT_SIZE; ++i) {
     EXPECT_EQ(GetEventDuration(i, settings, clock.Millis()), 0);
   }
@@ -140,47 +123,84 @@ TEST(EventsTest, SeveralEvents) {
   EXPECT_EQ(CalculateSeconds(FanMode::ON, settings, Clock::HoursToMillis(2), clock),
             Clock::MinutesToSeconds(24 + 10));
 
-  //    event->empty = false;
-  //    event->heat = settings->heat_running;
-  //    event->cool = settings->cool_running;
-  //    event->temperature_x10 = settings->current_mean_temperature_x10;
+  // The unpacked events.
+  const Event oldest = settings.events.Get(3);
+  EXPECT_EQ(oldest.hvac, HvacMode::HEAT);
+  EXPECT_EQ(oldest.fan, FanMode::ON);
+  EXPECT_EQ(oldest.temperature_x10, 75);
+  EXPECT_EQ(oldest.start_time, Clock::HoursToMillis(48));
+  EXPECT_EQ(settings.events.Get(1).temperature_x10, 73);
+  EXPECT_EQ(settings.events.oldest_start(), Clock::HoursToMillis(48));
 }
 
 TEST(EventsTest, GetHeatTempPerMin) {
   Settings settings;
   FakeClock clock;
-  
+
   clock.SetMillis(Clock::HoursToMillis(0));
-  settings.events[3].hvac = HvacMode::HEAT;
-  settings.events[3].start_time = clock.Millis();
-  settings.events[3].temperature_x10 = 600;
-  settings.events[3].temperature_10min_x10 = 800;
-      
-  float temp_per_min = GetHeatTempPerMin(settings, clock);
-  
-  EXPECT_FLOAT_EQ(temp_per_min, 20 / kTenMinuteAdjustmentMins); 
+  AddEvent(&settings, clock, HvacMode::HEAT, FanMode::ON, 600);
+  settings.events.SetHeatRise(20);
+
+  // 2° in 9.5 minutes.
+  EXPECT_EQ(GetHeatTempPerMinX100(settings, clock), 21);
 
   clock.Increment(Clock::HoursToMillis(6));
   // Add a second event now.
-  settings.events[4].hvac = HvacMode::HEAT;
-  settings.events[4].start_time = clock.Millis();
-  settings.events[4].temperature_x10 = 700;
-  settings.events[4].temperature_10min_x10 = 750;
+  AddEvent(&settings, clock, HvacMode::HEAT, FanMode::OFF, 700);
+  settings.events.SetHeatRise(5);
 
   {
-    float temp_per_min = GetHeatTempPerMin(settings, clock);
     // Average of the two.
-    EXPECT_FLOAT_EQ(temp_per_min, (20 + 5) / kTenMinuteAdjustmentMins / 2); 
+    EXPECT_EQ(GetHeatTempPerMinX100(settings, clock), 13);
+    EXPECT_EQ(RecentHeatTempPerMinX100(settings), 13);
   }
 
   // Move beyond the first event, so we only have the second event.
   clock.Increment(kEventHorizon);
-  {
-    float temp_per_min = GetHeatTempPerMin(settings, clock);
-    // Only the newest value should be accounted for.
-    EXPECT_FLOAT_EQ(temp_per_min, 5 / kTenMinuteAdjustmentMins); 
+  // Only the newest value should be accounted for.
+  EXPECT_EQ(GetHeatTempPerMinX100(settings, clock), 5);
+}
+
+TEST(EventLogTest, PacksEvents) {
+  EXPECT_EQ(sizeof(PackedEvent), 5);
+
+  EventLog<4> events;
+  events.Push(HvacMode::HEAT, FanMode::ON, 700, 1000);
+  // Start times stay on whole seconds from the previous event.
+  EXPECT_EQ(events.Push(HvacMode::IDLE, FanMode::OFF, 690, 62500), 62000);
+  events.SetHeatRise(200);
+  EXPECT_EQ(events.hvac(0), HvacMode::IDLE);
+  EXPECT_EQ(events.fan(0), FanMode::OFF);
+  EXPECT_EQ(events.hvac(1), HvacMode::HEAT);
+  EXPECT_EQ(events.fan(1), FanMode::ON);
+  EXPECT_EQ(events.DurationMillis(1, 70000), 61000);
+  EXPECT_EQ(events.DurationMillis(0, 70000), 8000);
+
+  // Rises and temperature changes saturate.
+  int16_t rise_x10;
+  EXPECT_TRUE(events.GetHeatRise(0, &rise_x10));
+  EXPECT_EQ(rise_x10, 127);
+  EXPECT_FALSE(events.GetHeatRise(1, &rise_x10));
+  events.Push(HvacMode::COOL, FanMode::ON, 900, 70000);
+  EXPECT_EQ(events.Get(0).temperature_x10, 900);
+  EXPECT_EQ(events.Get(1).temperature_x10, 900 - 127);
+}
+
+TEST(EventLogTest, DropsOldestWhenFull) {
+  EventLog<3> events;
+  for (uint32_t i = 0; i < 5; ++i) {
+    events.Push(i % 2 == 0 ? HvacMode::HEAT : HvacMode::IDLE, FanMode::OFF, 700,
+                i * 60000);
   }
-  
+  EXPECT_EQ(events.size(), 3);
+  EXPECT_EQ(events.oldest_start(), 2 * 60000);
+  EXPECT_EQ(events.Get(2).start_time, 2 * 60000);
+  EXPECT_EQ(events.hvac(2), HvacMode::HEAT);
+  EXPECT_EQ(events.hvac(3), HvacMode::EMPTY);
+
+  events.DropOldest();
+  EXPECT_EQ(events.size(), 2);
+  EXPECT_EQ(events.oldest_start(), 3 * 60000);
 }
 
 TEST(InterfacesTest, MillisSubtract) {
@@ -219,59 +239,152 @@ TEST(InterfacesTest, MillisSubtract) {
 
 TEST(EventsTest, FanSampleEvents) {
   Settings settings;
-  uint8_t idx = 0;
-  settings.events[idx].start_time = 1172ul * 60 * 1000;
-  settings.events[idx].hvac = HvacMode::IDLE;
-  settings.events[idx].fan = FanMode::ON;
-  
-  settings.events[++idx].start_time = 1202ul * 60 * 1000;
-  settings.events[idx].hvac = HvacMode::HEAT;
-  settings.events[idx].fan = FanMode::ON;
-
-  settings.events[++idx].start_time = 1202 * 60 * 1000;
-  settings.events[idx].hvac = HvacMode::IDLE;
-  settings.events[idx].fan = FanMode::ON;
+  FakeClock clock;
 
-  settings.events[++idx].start_time = 100 * 60 * 1000;
-  settings.events[idx].hvac = HvacMode::EMPTY;
-  settings.events[idx].fan = FanMode::EMPTY;
+  const struct {
+    uint32_t start_minute;
+    HvacMode hvac;
+    FanMode fan;
+  } kEvents[] = {
+      {259, HvacMode::IDLE, FanMode::OFF}, {484, HvacMode::IDLE, FanMode::ON},
+      {490, HvacMode::HEAT, FanMode::ON},  {509, HvacMode::IDLE, FanMode::ON},
+      {541, HvacMode::IDLE, FanMode::OFF}, {912, HvacMode::IDLE, FanMode::ON},
+      {947, HvacMode::IDLE, FanMode::OFF}, {1172, HvacMode::IDLE, FanMode::ON},
+      {1202, HvacMode::HEAT, FanMode::ON}, {1202, HvacMode::IDLE, FanMode::ON},
+  };
+  for (const auto& event : kEvents) {
+    clock.SetMillis(event.start_minute * 60 * 1000);
+    AddEvent(&settings, clock, event.hvac, event.fan, 700);
+  }
+  clock.SetMillis(1203 * 60 * 1000);
 
-  settings.events[++idx].start_time = 259 * 60 * 1000;
-  settings.events[idx].hvac = HvacMode::IDLE;
-  settings.events[idx].fan = FanMode::OFF;
+  uint32_t fan_on = CalculateSeconds(FanMode::ON, settings, Clock::HoursToMillis(24), clock);
+  uint32_t fan_off = CalculateSeconds(FanMode::OFF, settings, Clock::HoursToMillis(24), clock);
+  LOG(INFO) << "FanOn: " << fan_on << " FanOff: " << fan_off;
+  EXPECT_GT(fan_on, fan_off * 0.10);
+  EXPECT_LT(fan_on, fan_off * 0.30);
+}
 
-  settings.events[++idx].start_time = 484 * 60 * 1000;
-  settings.events[idx].hvac = HvacMode::IDLE;
-  settings.events[idx].fan = FanMode::ON;
+class RecentTotalsTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ON_CALL(wrapper, RunOnce(testing::_)).WillByDefault(testing::Return(Status::kOk));
+    clock.SetMillis(Clock::HoursToMillis(48));
+  }
 
-  settings.events[++idx].start_time = 490 * 60 * 1000;
-  settings.events[idx].hvac = HvacMode::HEAT;
-  settings.events[idx].fan = FanMode::ON;
+  // Runs the history task as the thermostat would after the mode changed.
+  void RunFor(const HvacMode hvac, const FanMode fan, const uint32_t millis) {
+    settings.hvac = hvac;
+    settings.fan = fan;
+    settings.now = clock.Millis();
+    task.RunOnce(&settings);
+    clock.Increment(millis);
+  }
 
-  settings.events[++idx].start_time = 509 * 60 * 1000;
-  settings.events[idx].hvac = HvacMode::IDLE;
-  settings.events[idx].fan = FanMode::ON;
+ protected:
+  Settings settings;
+  FakeClock clock;
+  testing::NiceMock<MockThermostatTask> wrapper;
+  HistoryUpdatingThermostatTask task = HistoryUpdatingThermostatTask(&wrapper);
+};
+
+TEST_F(RecentTotalsTest, NoEvents) {
+  EXPECT_EQ(RecentHistoryMillis(settings, clock.Millis()), 0);
+  EXPECT_EQ(RecentSeconds(HvacMode::HEAT, settings, clock), 0);
+  EXPECT_EQ(RecentSeconds(HvacMode::IDLE, settings, clock), 0);
+  EXPECT_EQ(RecentSeconds(FanMode::ON, settings, clock), 0);
+  EXPECT_EQ(RecentSeconds(FanMode::OFF, settings, clock), 0);
+  EXPECT_EQ(RecentHeatTempPerMinX100(settings), 0);
+}
 
-  settings.events[++idx].start_time = 541 * 60 * 1000;
-  settings.events[idx].hvac = HvacMode::IDLE;
-  settings.events[idx].fan = FanMode::OFF;
+TEST_F(RecentTotalsTest, MatchesScanningCalculations) {
+  // Deterministic pseudo random sequence of modes and durations, long enough to wrap
+  // around the event buffer several times while staying within the last day.
+  uint32_t seed = 7;
+  for (int i = 0; i < 10 * EVENT_SIZE; ++i) {
+    seed = seed * 1103515245 + 12345;
+    const HvacMode hvac = (seed >> 8) % 3 == 0   ? HvacMode::HEAT
+                          : (seed >> 8) % 3 == 1 ? HvacMode::COOL
+                                                 : HvacMode::IDLE;
+    const FanMode fan = (seed >> 12) % 2 == 0 ? FanMode::ON : FanMode::OFF;
+    settings.current_mean_temperature_x10 = 650 + (seed >> 16) % 50;
+    RunFor(hvac, fan, Clock::SecondsToMillis(60 + (seed >> 4) % 900));
+    // Update the 10 minute heating temperature.
+    settings.now = clock.Millis();
+    task.RunOnce(&settings);
+
+    const uint32_t day = Clock::HoursToMillis(24);
+    ASSERT_EQ(RecentSeconds(HvacMode::HEAT, settings, clock),
+              CalculateSeconds(HvacMode::HEAT, settings, day, clock));
+    ASSERT_EQ(RecentSeconds(HvacMode::COOL, settings, clock),
+              CalculateSeconds(HvacMode::COOL, settings, day, clock));
+    ASSERT_EQ(RecentSeconds(HvacMode::IDLE, settings, clock),
+              CalculateSeconds(HvacMode::IDLE, settings, day, clock));
+    ASSERT_EQ(RecentSeconds(FanMode::ON, settings, clock),
+              CalculateSeconds(FanMode::ON, settings, day, clock));
+    ASSERT_EQ(RecentSeconds(FanMode::OFF, settings, clock),
+              CalculateSeconds(FanMode::OFF, settings, day, clock));
+
+    ASSERT_EQ(RecentHeatTempPerMinX100(settings), GetHeatTempPerMinX100(settings, clock));
+  }
+}
 
-  settings.events[++idx].start_time = 912 * 60 * 1000;
-  settings.events[idx].hvac = HvacMode::IDLE;
-  settings.events[idx].fan = FanMode::ON;
+TEST_F(RecentTotalsTest, SlidesOverTheLastDay) {
+  RunFor(HvacMode::HEAT, FanMode::ON, Clock::HoursToMillis(2));
+  RunFor(HvacMode::IDLE, FanMode::OFF, Clock::HoursToMillis(23));
+  settings.now = clock.Millis();
+  task.RunOnce(&settings);
+
+  // Only the last hour of heating is within the window.
+  EXPECT_EQ(RecentHistoryMillis(settings, clock.Millis()), Clock::HoursToMillis(24));
+  EXPECT_EQ(RecentSeconds(HvacMode::HEAT, settings, clock), Clock::HoursToSeconds(1));
+  EXPECT_EQ(RecentSeconds(FanMode::ON, settings, clock), Clock::HoursToSeconds(1));
+  EXPECT_EQ(RecentSeconds(HvacMode::IDLE, settings, clock), Clock::HoursToSeconds(23));
+  EXPECT_EQ(RecentSeconds(FanMode::OFF, settings, clock), Clock::HoursToSeconds(23));
+
+  // The heating event drops out of the totals once it ended over a day ago.
+  clock.Increment(Clock::HoursToMillis(2));
+  settings.now = clock.Millis();
+  task.RunOnce(&settings);
+  EXPECT_EQ(settings.event_totals.heat_ms, 0);
+  EXPECT_EQ(settings.event_totals.fan_ms, 0);
+  EXPECT_EQ(RecentSeconds(HvacMode::HEAT, settings, clock), 0);
+  EXPECT_EQ(RecentSeconds(HvacMode::IDLE, settings, clock), Clock::HoursToSeconds(24));
+}
 
-  settings.events[++idx].start_time = 947 * 60 * 1000;
-  settings.events[idx].hvac = HvacMode::IDLE;
-  settings.events[idx].fan = FanMode::OFF;
+TEST_F(RecentTotalsTest, OutdoorTemperatureEstimate) {
+  // Heating a third of the day.
+  for (int i = 0; i < 8; ++i) {
+    RunFor(HvacMode::HEAT, FanMode::ON, Clock::HoursToMillis(1));
+    RunFor(HvacMode::IDLE, FanMode::OFF, Clock::HoursToMillis(2));
+  }
+  EXPECT_EQ(OutdoorTemperatureEstimate(settings, clock), -100);
+}
 
-  FakeClock clock;
-  clock.SetMillis(1203 * 60 * 1000);
+TEST_F(RecentTotalsTest, PruningDropsEventsOlderThan24Days) {
+  testing::NiceMock<MockThermostatTask> pruning_wrapper;
+  ON_CALL(pruning_wrapper, RunOnce(testing::_)).WillByDefault(testing::Return(Status::kOk));
+  HistoryPruningThermostatTask pruning(&pruning_wrapper);
 
-  uint32_t fan_on = CalculateSeconds(FanMode::ON, settings, Clock::HoursToMillis(24), clock); 
-  uint32_t fan_off = CalculateSeconds(FanMode::OFF, settings, Clock::HoursToMillis(24), clock); 
-  LOG(INFO) << "FanOn: " << fan_on << " FanOff: " << fan_off;
-  EXPECT_GT(fan_on, fan_off * 0.10);
-  EXPECT_LT(fan_on, fan_off * 0.30);
+  RunFor(HvacMode::HEAT, FanMode::ON, Clock::HoursToMillis(1));
+  // Long events get split, so keep the history updated as the thermostat would.
+  for (uint32_t minute = 0; minute < 24 * 24 * 60 - 60; ++minute) {
+    RunFor(HvacMode::IDLE, FanMode::OFF, Clock::MinutesToMillis(1));
+  }
+  settings.now = clock.Millis();
+  task.RunOnce(&settings);
+  const uint8_t size = settings.events.size();
+  ASSERT_EQ(settings.events.hvac(size - 1), HvacMode::HEAT);
+
+  // Nothing is older than 24 days yet.
+  pruning.RunOnce(&settings);
+  EXPECT_EQ(settings.events.size(), size);
+
+  clock.Increment(Clock::HoursToMillis(12));
+  settings.now = clock.Millis();
+  pruning.RunOnce(&settings);
+  EXPECT_LT(settings.events.size(), size);
+  EXPECT_EQ(settings.events.hvac(settings.events.size() - 1), HvacMode::IDLE);
 }
 
 }  // namespace
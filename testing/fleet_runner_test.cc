@@ -0,0 +1,83 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include "simulation/fleet_runner.h"
+
+namespace thermostat {
+namespace simulation {
+namespace {
+
+constexpr uint64_t kOneDaySeconds = 24 * 60 * 60;
+
+TEST(WorkStealingPoolTest, RunsEveryJobOnce) {
+  WorkStealingPool pool(4);
+  std::vector<std::atomic<int>> runs(1000);
+
+  pool.ParallelFor(runs.size(), [&runs](const size_t i) { runs[i]++; });
+
+  for (const std::atomic<int>& count : runs) {
+    EXPECT_EQ(count, 1);
+  }
+}
+
+TEST(WorkStealingPoolTest, IdleWorkersSteal) {
+  WorkStealingPool pool(2);
+  std::atomic<bool> released(false);
+
+  // The first worker's block starts with a job that blocks until the second worker has
+  // stolen the remaining jobs of that block.
+  pool.ParallelFor(4, [&](const size_t i) {
+    if (i == 1) {
+      while (!released) {
+      }
+    }
+    if (i == 0) {
+      released = true;
+    }
+  });
+  EXPECT_GE(pool.steals(), 1);
+}
+
+TEST(FleetRunnerTest, ParallelMatchesSequential) {
+  const std::vector<SimulationConfig> configs =
+      MakeFleetConfigs(/*houses=*/8, /*start_day_of_year=*/15, /*seed=*/3);
+
+  const FleetReport sequential = FleetRunner(1).Run(configs, kOneDaySeconds);
+  const FleetReport parallel = FleetRunner(4).Run(configs, kOneDaySeconds);
+  LOG(INFO) << "Sequential " << sequential.wall_seconds << "s, parallel "
+            << parallel.wall_seconds << "s";
+
+  ASSERT_EQ(parallel.reports.size(), configs.size());
+  EXPECT_EQ(parallel.total_steps, sequential.total_steps);
+  for (size_t i = 0; i < configs.size(); ++i) {
+    // Every house is independent, so the thread it ran on can't change the outcome.
+    EXPECT_EQ(parallel.reports[i].heat_cycles, sequential.reports[i].heat_cycles);
+    EXPECT_DOUBLE_EQ(parallel.reports[i].comfort_error_degree_hours,
+                     sequential.reports[i].comfort_error_degree_hours);
+    EXPECT_DOUBLE_EQ(parallel.reports[i].max_indoor_f, sequential.reports[i].max_indoor_f);
+  }
+  EXPECT_DOUBLE_EQ(parallel.mean_comfort_error_f, sequential.mean_comfort_error_f);
+}
+
+TEST(FleetRunnerTest, HousesDiffer) {
+  const std::vector<SimulationConfig> configs =
+      MakeFleetConfigs(/*houses=*/2, /*start_day_of_year=*/15, /*seed=*/3);
+
+  const FleetReport fleet = FleetRunner(2).Run(configs, kOneDaySeconds);
+
+  EXPECT_EQ(fleet.houses, 2);
+  EXPECT_GT(fleet.total_steps, 0);
+  EXPECT_NE(fleet.reports[0].heat_hours, fleet.reports[1].heat_hours);
+  // Every house should still be heated in the middle of winter.
+  for (const SimulationReport& report : fleet.reports) {
+    EXPECT_GT(report.heat_hours, 0);
+  }
+}
+
+}  // namespace
+}  // namespace simulation
+}  // namespace thermostat
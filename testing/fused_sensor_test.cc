@@ -0,0 +1,112 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "mock_impls.h"
+#include "thermostat/fused_sensor.h"
+
+namespace thermostat {
+namespace {
+
+class FusedSensorTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    clock.SetMillis(10000);
+    primary.SetTemperature(70.0);
+    primary.SetHumidity(40);
+    secondary.SetTemperature(71.0);
+  }
+
+  FakeClock clock;
+  FakeSensor primary;
+  FakeSensor secondary;
+  FusedSource sources[2] = {
+      {&primary, 25, 10000},
+      {&secondary, 4, 10000},
+  };
+  FusedSensor sensor = FusedSensor(&clock, sources, 2);
+};
+
+TEST_F(FusedSensorTest, WeighsByTheInverseVariance) {
+  EXPECT_TRUE(sensor.EndReading());
+
+  // (700 / 25 + 710 / 4) / (1 / 25 + 1 / 4) = 708.6
+  EXPECT_EQ(sensor.GetTemperatureX10(), 709);
+  EXPECT_EQ(sensor.GetHumidity(), 40);
+}
+
+TEST_F(FusedSensorTest, EqualVariancesAverage) {
+  FusedSource equal[2] = {{&primary, 9, 10000}, {&secondary, 9, 10000}};
+  FusedSensor averaging(&clock, equal, 2);
+  secondary.SetTemperature(70.3);
+
+  EXPECT_TRUE(averaging.EndReading());
+  EXPECT_EQ(averaging.GetTemperatureX10(), 702);
+}
+
+TEST_F(FusedSensorTest, KeepsAFailedSourceUntilItIsStale) {
+  EXPECT_TRUE(sensor.EndReading());
+
+  // The secondary's last reading is still used.
+  secondary.SetEndReadingResult(false);
+  secondary.SetTemperature(50.0);
+  clock.Increment(10000);
+  EXPECT_TRUE(sensor.EndReading());
+  EXPECT_EQ(sensor.GetTemperatureX10(), 709);
+  EXPECT_TRUE(sensor.source(1).valid);
+
+  // And then dropped, leaving the primary alone.
+  clock.Increment(1);
+  EXPECT_TRUE(sensor.EndReading());
+  EXPECT_EQ(sensor.GetTemperatureX10(), 700);
+  EXPECT_FALSE(sensor.source(1).valid);
+
+  // Until it reads again.
+  secondary.SetEndReadingResult(true);
+  secondary.SetTemperature(71.0);
+  EXPECT_TRUE(sensor.EndReading());
+  EXPECT_EQ(sensor.GetTemperatureX10(), 709);
+}
+
+// EndReading() returning true is what marks a reading as fresh. A sensor that keeps
+// returning true with a frozen value is never aged out, so a sensor must return false
+// when its read failed, as with the dev board's DHT22 being the only source.
+TEST_F(FusedSensorTest, OnlyAFailedReadAgesOut) {
+  FusedSource frozen_source[1] = {{&primary, 25, 10000}};
+  FusedSensor frozen(&clock, frozen_source, 1);
+  EXPECT_TRUE(frozen.EndReading());
+
+  // Reporting success with the same value keeps the source forever.
+  clock.Increment(60000);
+  EXPECT_TRUE(frozen.EndReading());
+  EXPECT_EQ(frozen.GetTemperatureX10(), 700);
+  EXPECT_TRUE(frozen.source(0).valid);
+
+  // Reporting the failure keeps the last value for the max age, and then fails.
+  primary.SetEndReadingResult(false);
+  clock.Increment(10000);
+  EXPECT_TRUE(frozen.EndReading());
+  EXPECT_EQ(frozen.GetTemperatureX10(), 700);
+  clock.Increment(1);
+  EXPECT_FALSE(frozen.EndReading());
+  EXPECT_FALSE(frozen.source(0).valid);
+}
+
+TEST_F(FusedSensorTest, FailsWhenEverySourceFailed) {
+  primary.SetEndReadingResult(false);
+  secondary.SetEndReadingResult(false);
+
+  EXPECT_FALSE(sensor.EndReading());
+}
+
+TEST_F(FusedSensorTest, ForwardsTheRequests) {
+  primary.EnableAsyncAssert();
+  secondary.EnableAsyncAssert();
+
+  sensor.StartRequestAsync();
+  EXPECT_TRUE(sensor.EndReading());
+  sensor.StartRequestAsync();
+}
+
+}  // namespace
+}  // namespace thermostat
@@ -36,6 +36,7 @@ Settings DefaultSettings() {
   defaults.persisted.cool_setpoints[0].temperature_x10 = 800;
   defaults.persisted.cool_setpoints[1].hour = 21;
   defaults.persisted.cool_setpoints[1].temperature_x10 = 750;
+  CompileSchedules(&defaults);
   return defaults;
 };
 
@@ -62,7 +63,6 @@ class HeatAdvancingThermostatTaskTest : public testing::Test {
 
   FakePrint print;
   
-  uint8_t event_ = 0;
 
   MockThermostatTask wrapper;
   HeatAdvancingThermostatTask task = HeatAdvancingThermostatTask(&wrapper);
@@ -91,6 +91,8 @@ TEST_F(HeatAdvancingThermostatTaskTest, HighHeat) {
   // 7am-9pm -> 70.0° ; 9pm-7am -> 65°
   settings.persisted.heat_setpoints[0].hour = 7;
   settings.persisted.heat_setpoints[0].temperature_x10 = 700;
+  // As the HvacControllerThermostatTask sets it.
+  settings.heat_setpoint_x10 = 700;
   
   // Emulate first run behavior.
   {
@@ -99,9 +101,8 @@ TEST_F(HeatAdvancingThermostatTaskTest, HighHeat) {
     // Start in heating mode
     settings.hvac = HvacMode::IDLE;
     {
-      Event* new_event = &settings.events[event_++];
-      new_event->start_time = clock.Millis();
-      new_event->hvac = settings.hvac;
+      settings.events.Push(settings.hvac, FanMode::OFF,
+                           settings.current_mean_temperature_x10, clock.Millis());
     }
     EXPECT_EQ(task.RunOnce(&settings), Status::kOk); 
     EXPECT_EQ(settings.hvac, HvacMode::IDLE);
@@ -114,9 +115,8 @@ TEST_F(HeatAdvancingThermostatTaskTest, HighHeat) {
   settings.now = clock.Millis();
   settings.hvac = HvacMode::HEAT;
   {
-	  Event* new_event = &settings.events[event_++];
-	  new_event->start_time = clock.Millis();
-	  new_event->hvac = settings.hvac;
+	  settings.events.Push(settings.hvac, FanMode::OFF,
+	                       settings.current_mean_temperature_x10, clock.Millis());
   }
   EXPECT_EQ(task.RunOnce(&settings), Status::kOk);  
   EXPECT_EQ(settings.hvac, HvacMode::HEAT);
@@ -143,4 +143,73 @@ TEST_F(HeatAdvancingThermostatTaskTest, HighHeat) {
   EXPECT_TRUE(settings.heat_high);
 }
 
+class HeatStagingTest : public HeatAdvancingThermostatTaskTest {
+ public:
+  void SetUp() override {
+    HeatAdvancingThermostatTaskTest::SetUp();
+    settings.heat_setpoint_x10 = 700;
+    settings.persisted.tolerance_x10 = 20;
+    // 1.9° per heat event over 9.5 minutes learns 0.2° per minute at low.
+    settings.event_totals.heat_rise_x10 = 19;
+    settings.event_totals.heat_rise_count = 1;
+
+    settings.first_run = true;
+    settings.hvac = HvacMode::IDLE;
+    EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+    settings.first_run = false;
+  }
+
+  // Runs a cycle the given minutes later.
+  void RunAfter(const uint32_t minutes, const int temperature_x10) {
+    clock.Increment(Clock::MinutesToMillis(minutes));
+    settings.now = clock.Millis();
+    settings.current_mean_temperature_x10 = temperature_x10;
+    settings.within_tolerance = temperature_x10 >= settings.heat_setpoint_x10;
+    EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  }
+};
+
+TEST_F(HeatStagingTest, StartsHighWhenLowIsTooSlow) {
+  // 6° takes 30 minutes at low.
+  settings.hvac = HvacMode::HEAT;
+  RunAfter(0, 640);
+  EXPECT_TRUE(settings.heat_high);
+
+  // Stays high until the heat turns off.
+  RunAfter(5, 700);
+  EXPECT_TRUE(settings.heat_high);
+  settings.hvac = HvacMode::IDLE;
+  RunAfter(5, 720);
+  EXPECT_FALSE(settings.heat_high);
+}
+
+TEST_F(HeatStagingTest, StartsLowWhenLowIsFastEnough) {
+  // 3° takes 15 minutes at low.
+  settings.hvac = HvacMode::HEAT;
+  RunAfter(0, 670);
+  EXPECT_FALSE(settings.heat_high);
+
+  // 2° in 12 minutes leaves 1° for another 6 minutes, within the 20.
+  RunAfter(12, 690);
+  EXPECT_FALSE(settings.heat_high);
+}
+
+TEST_F(HeatStagingTest, AdvancesWhenLowFallsBehind) {
+  settings.hvac = HvacMode::HEAT;
+  RunAfter(0, 670);
+  EXPECT_FALSE(settings.heat_high);
+
+  // 1° in 12 minutes leaves 2° for another 24 minutes.
+  RunAfter(12, 680);
+  EXPECT_TRUE(settings.heat_high);
+}
+
+TEST_F(HeatStagingTest, StartsLowWithoutALearnedRate) {
+  settings.event_totals.heat_rise_x10 = 0;
+  settings.event_totals.heat_rise_count = 0;
+  settings.hvac = HvacMode::HEAT;
+  RunAfter(0, 600);
+  EXPECT_FALSE(settings.heat_high);
+}
+
 }  // namespace thermostat
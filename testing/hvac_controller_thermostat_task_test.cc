@@ -35,6 +35,7 @@ Settings DefaultSettings() {
   defaults.persisted.cool_setpoints[0].temperature_x10 = 800;
   defaults.persisted.cool_setpoints[1].hour = 21;
   defaults.persisted.cool_setpoints[1].temperature_x10 = 750;
+  CompileSchedules(&defaults);
   return defaults;
 };
 
@@ -213,4 +214,84 @@ TEST_F(HvacControllerThermostatTaskTest, HeatAndCoolToggling) {
   EXPECT_EQ(settings.hvac, HvacMode::IDLE);
 }
 
+class AdaptiveRecoveryTest : public HvacControllerThermostatTaskTest {
+ public:
+  void SetUp() override {
+    HvacControllerThermostatTaskTest::SetUp();
+    settings.persisted.heat_enabled = true;
+    settings.persisted.cool_enabled = false;
+    settings.persisted.adaptive_recovery = true;
+    // Above the 65° night setpoint, and 4° short of the 70° at 7am.
+    settings.current_mean_temperature_x10 = 660;
+    // 1.9° per heat event over 9.5 minutes learns 0.2° per minute, so 20 minutes to
+    // recover.
+    settings.event_totals.heat_rise_x10 = 19;
+    settings.event_totals.heat_rise_count = 1;
+  }
+
+  void SetTime(const uint8_t hour, const uint8_t minute) {
+    Date d;
+    d.hour = hour;
+    d.minute = minute;
+    d.day_of_week = 3;
+    clock.SetDate(d);
+  }
+};
+
+TEST_F(AdaptiveRecoveryTest, StartsHeatingAheadOfTheSetpoint) {
+  SetTime(6, 30);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.hvac, HvacMode::IDLE);
+
+  SetTime(6, 40);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.hvac, HvacMode::HEAT);
+
+  // Keeps heating as the room warms, rather than waiting on the time left again.
+  settings.current_mean_temperature_x10 = 680;
+  SetTime(6, 42);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.hvac, HvacMode::HEAT);
+
+  // The 7am setpoint takes over.
+  settings.current_mean_temperature_x10 = 720;
+  SetTime(7, 1);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.hvac, HvacMode::IDLE);
+}
+
+TEST_F(AdaptiveRecoveryTest, StartsEarlierWhenColder) {
+  SetTime(6, 35);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.hvac, HvacMode::IDLE);
+
+  // At the night setpoint, 25 minutes short of the next.
+  settings.current_mean_temperature_x10 = 650;
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.hvac, HvacMode::HEAT);
+}
+
+TEST_F(AdaptiveRecoveryTest, WaitsForTheSetpointWhenDisabled) {
+  settings.persisted.adaptive_recovery = false;
+  SetTime(6, 50);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.hvac, HvacMode::IDLE);
+}
+
+TEST_F(AdaptiveRecoveryTest, WaitsForTheSetpointWithoutALearnedRate) {
+  settings.event_totals.heat_rise_x10 = 0;
+  settings.event_totals.heat_rise_count = 0;
+  SetTime(6, 50);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.hvac, HvacMode::IDLE);
+}
+
+TEST_F(AdaptiveRecoveryTest, IgnoresACoolerNextSetpoint) {
+  // 9pm drops to 65°, and the room is above the 70° setpoint.
+  settings.current_mean_temperature_x10 = 710;
+  SetTime(20, 50);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.hvac, HvacMode::IDLE);
+}
+
 }  // namespace thermostat
@@ -0,0 +1,121 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "mock_impls.h"
+#include "thermostat/idle.h"
+#include "thermostat/scheduler.h"
+#include "thermostat/settings.h"
+
+namespace thermostat {
+namespace {
+
+class NullTask : public ThermostatTask {
+ public:
+  Status RunOnce(Settings* settings) override {
+    UNUSED(settings);
+    return Status::kOk;
+  }
+};
+
+// Passes the time on the fake clock instead of sleeping. Spinning leaves the time alone,
+// as the main loop did without the Idler.
+class FakeSleeper : public Sleeper {
+ public:
+  explicit FakeSleeper(FakeClock* clock) : clock_(clock) {}
+
+  void Sleep(const uint32_t duration_us) override {
+    slept_us.push_back(duration_us);
+    if (!spin) {
+      clock_->Increment((duration_us + 999) / 1000);
+    }
+  }
+
+  std::vector<uint32_t> slept_us;
+  bool spin = false;
+
+ private:
+  FakeClock* const clock_;
+};
+
+class IdlerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    clock.SetMillis(10000);
+    scheduler.RunOnce(&settings);
+    // The first pass, which samples the buttons right away.
+    idler.Idle(true);
+  }
+
+  // The main loop, where each pass takes pass_ms.
+  void RunFor(const uint32_t millis, const uint32_t pass_ms) {
+    const uint32_t start = clock.Millis();
+    while (clock.millisSince(start) < millis) {
+      const Status status = scheduler.RunOnce(&settings);
+      clock.Increment(pass_ms);
+      idler.Idle(status != Status::kSkipped);
+    }
+  }
+
+  Settings settings;
+  FakeClock clock;
+  FakePrint print;
+  FakeSleeper sleeper = FakeSleeper(&clock);
+  NullTask task;
+  ScheduledTask tasks[1] = {{"Task", &task, 1000, 100, false}};
+  Scheduler scheduler = Scheduler(&clock, &print, tasks, 1);
+  Idler idler = Idler(&clock, &sleeper, &scheduler, 10);
+};
+
+TEST_F(IdlerTest, SleepsUntilTheNextButtonPoll) {
+  idler.Idle(true);
+  clock.Increment(3);
+  idler.Idle(false);
+
+  ASSERT_EQ(sleeper.slept_us.size(), 2);
+  EXPECT_EQ(sleeper.slept_us[0], 10000);
+  // The poll period counts from when the pass started.
+  EXPECT_EQ(sleeper.slept_us[1], 7000);
+}
+
+TEST_F(IdlerTest, WakesForTheNextTask) {
+  clock.Increment(995);
+  idler.Idle(false);
+  idler.Idle(false);
+
+  ASSERT_EQ(sleeper.slept_us.size(), 1);
+  EXPECT_EQ(sleeper.slept_us[0], 5000);
+}
+
+TEST_F(IdlerTest, DoesNotSleepWhenATaskIsDue) {
+  clock.Increment(1000);
+  idler.Idle(false);
+
+  EXPECT_TRUE(sleeper.slept_us.empty());
+}
+
+TEST_F(IdlerTest, SpinningWastesNearlyEveryPass) {
+  sleeper.spin = true;
+  RunFor(10000, 1);
+
+  EXPECT_EQ(idler.passes(), 1 + 10000);
+  // Only the passes running the task did any work.
+  EXPECT_EQ(idler.wasted(), 10000 - 10);
+}
+
+TEST_F(IdlerTest, SleepingWastesNoPasses) {
+  RunFor(10000, 1);
+
+  // One pass per button poll, plus the task runs between the polls.
+  EXPECT_LE(idler.passes(), 1000 + 10);
+  EXPECT_GE(idler.passes(), 900);
+  EXPECT_EQ(idler.wasted(), 0);
+
+  idler.Reset();
+  EXPECT_EQ(idler.passes(), 0);
+}
+
+}  // namespace
+}  // namespace thermostat
@@ -35,6 +35,7 @@ Settings DefaultSettings() {
   defaults.persisted.cool_setpoints[0].temperature_x10 = 800;
   defaults.persisted.cool_setpoints[1].hour = 21;
   defaults.persisted.cool_setpoints[1].temperature_x10 = 750;
+  CompileSchedules(&defaults);
   return defaults;
 };
 
@@ -91,9 +92,8 @@ TEST_F(LockoutControllingThermostatTaskTest, HeatLockout) {
 
   // Create a cool event starting at 0 min.
   {
-	  Event* new_event = &settings.events[0];
-	  new_event->start_time = clock.Millis();
-	  new_event->hvac = HvacMode::COOL;
+	  settings.events.Push(HvacMode::COOL, FanMode::OFF,
+	                       settings.current_mean_temperature_x10, clock.Millis());
   }
 
   // Try going from cool to heat 20 minutes later, we should see lockout
@@ -108,9 +108,8 @@ TEST_F(LockoutControllingThermostatTaskTest, HeatLockout) {
   
   // Create an idle event startig at 20 min.
   {
-	  Event* new_event = &settings.events[1];
-	  new_event->start_time = clock.Millis();
-	  new_event->hvac = HvacMode::IDLE;
+	  settings.events.Push(HvacMode::IDLE, FanMode::OFF,
+	                       settings.current_mean_temperature_x10, clock.Millis());
   }
   
   // Immediately after havin gthe idle even we should still lockout.
@@ -152,9 +151,8 @@ TEST_F(LockoutControllingThermostatTaskTest, CoolLockout) {
 
   // Create a heat event starting at 0 min.
   {
-	  Event* new_event = &settings.events[0];
-	  new_event->start_time = clock.Millis();
-	  new_event->hvac = HvacMode::HEAT;
+	  settings.events.Push(HvacMode::HEAT, FanMode::OFF,
+	                       settings.current_mean_temperature_x10, clock.Millis());
   }
 
   // Try going from heat to cool 20 minutes later, we should see lockout
@@ -169,9 +167,8 @@ TEST_F(LockoutControllingThermostatTaskTest, CoolLockout) {
   
   // Create an idle event starting at 20 min.
   {
-	  Event* new_event = &settings.events[1];
-	  new_event->start_time = clock.Millis();
-	  new_event->hvac = HvacMode::IDLE;
+	  settings.events.Push(HvacMode::IDLE, FanMode::OFF,
+	                       settings.current_mean_temperature_x10, clock.Millis());
   }
   
   // Immediately after having the idle event we should still lockout.
@@ -0,0 +1,139 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <type_traits>
+
+#include "mock_impls.h"
+#include "thermostat/crc.h"
+#include "thermostat/log_settings_storer.h"
+#include "thermostat/settings.h"
+
+namespace thermostat {
+namespace {
+
+Settings MakeSettings(const int tolerance_x10) {
+  Settings settings;
+  // Zero the unused bits and the uninitialized fields, so equal settings have equal
+  // bytes. The storer copies the record bytewise, which needs it trivially copyable.
+  static_assert(std::is_trivially_copyable<PersistedSettings>::value,
+                "PersistedSettings is stored bytewise");
+  uint8_t* const bytes = reinterpret_cast<uint8_t*>(&settings.persisted);
+  std::fill(bytes, bytes + sizeof(settings.persisted), 0);
+  settings.persisted.version = VERSION;
+  settings.persisted.tolerance_x10 = tolerance_x10;
+  return settings;
+}
+
+int ReadTolerance(Eeprom* eeprom) {
+  // A new storer recovers from the EEPROM contents like after a reboot.
+  LogSettingsStorer storer(eeprom);
+  Settings settings;
+  storer.Read(&settings);
+  return settings.persisted.tolerance_x10;
+}
+
+TEST(Crc16Test, MatchesCheckValue) {
+  const uint8_t data[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  EXPECT_EQ(Crc16(data, sizeof(data)), 0x29B1);
+}
+
+TEST(LogSettingsStorerTest, ReadsBackNewestRecord) {
+  FakeEeprom eeprom;
+  LogSettingsStorer storer(&eeprom);
+  storer.Write(MakeSettings(10));
+  storer.Write(MakeSettings(11));
+  storer.Write(MakeSettings(12));
+
+  EXPECT_EQ(ReadTolerance(&eeprom), 12);
+
+  // Keeps appending after a reboot.
+  LogSettingsStorer rebooted(&eeprom);
+  rebooted.Write(MakeSettings(13));
+  EXPECT_EQ(ReadTolerance(&eeprom), 13);
+}
+
+TEST(LogSettingsStorerTest, SkipsUnchangedSettings) {
+  FakeEeprom eeprom;
+  LogSettingsStorer storer(&eeprom);
+  storer.Write(MakeSettings(10));
+  const uint32_t writes = eeprom.total_writes();
+
+  storer.Write(MakeSettings(10));
+  EXPECT_EQ(eeprom.total_writes(), writes);
+}
+
+TEST(LogSettingsStorerTest, SpreadsWear) {
+  FakeEeprom eeprom;
+  LogSettingsStorer storer(&eeprom);
+  const uint8_t slots = storer.slots();
+  EXPECT_EQ(slots, FakeEeprom::kSize / LogSettingsStorer::kRecordSize);
+
+  // Holding UP and pressing SELECT over and over.
+  constexpr int kWrites = 10000;
+  for (int i = 0; i < kWrites; ++i) {
+    storer.Write(MakeSettings(i % 100));
+  }
+  EXPECT_EQ(ReadTolerance(&eeprom), (kWrites - 1) % 100);
+
+  // Each slot was written at most kWrites / slots + 1 times, instead of every byte of the
+  // single record seeing every write.
+  LOG(INFO) << "Slots: " << static_cast<int>(slots)
+            << ", most writes to one byte: " << eeprom.max_writes();
+  EXPECT_LE(eeprom.max_writes(), kWrites / slots + 1);
+}
+
+TEST(LogSettingsStorerTest, TornRecordFallsBackToPrevious) {
+  FakeEeprom eeprom;
+  LogSettingsStorer storer(&eeprom);
+  storer.Write(MakeSettings(10));
+  storer.Write(MakeSettings(11));
+
+  // Damage the payload of the newest record in the second slot.
+  eeprom.Corrupt(LogSettingsStorer::kRecordSize + LogSettingsStorer::kHeaderSize);
+  EXPECT_EQ(ReadTolerance(&eeprom), 10);
+
+  // The next write replaces the damaged record.
+  LogSettingsStorer rebooted(&eeprom);
+  rebooted.Write(MakeSettings(12));
+  EXPECT_EQ(ReadTolerance(&eeprom), 12);
+}
+
+TEST(LogSettingsStorerTest, SequenceWraps) {
+  FakeEeprom eeprom;
+  // A small region with 3 slots wraps the 16-bit sequence quickly.
+  LogSettingsStorer storer(&eeprom, 0, 3 * LogSettingsStorer::kRecordSize);
+  for (int32_t i = 0; i < 0x10000 + 5; ++i) {
+    storer.Write(MakeSettings(i % 2));
+  }
+  storer.Write(MakeSettings(7));
+
+  LogSettingsStorer rebooted(&eeprom, 0, 3 * LogSettingsStorer::kRecordSize);
+  Settings settings;
+  rebooted.Read(&settings);
+  EXPECT_EQ(settings.persisted.tolerance_x10, 7);
+}
+
+TEST(LogSettingsStorerTest, ReadsSingleRecordLayout) {
+  FakeEeprom eeprom;
+  // Settings written at address 0 by the previous storer.
+  const Settings old = MakeSettings(17);
+  const uint8_t* const bytes = reinterpret_cast<const uint8_t*>(&old.persisted);
+  for (uint16_t i = 0; i < sizeof(PersistedSettings); ++i) {
+    eeprom.Update(i, bytes[i]);
+  }
+
+  EXPECT_EQ(ReadTolerance(&eeprom), 17);
+}
+
+TEST(LogSettingsStorerTest, ErasedEepromHasNoVersion) {
+  FakeEeprom eeprom;
+  LogSettingsStorer storer(&eeprom);
+  Settings settings;
+  storer.Read(&settings);
+  EXPECT_NE(settings.persisted.version, VERSION);
+}
+
+}  // namespace
+}  // namespace thermostat
@@ -0,0 +1,143 @@
+#include <glog/logging.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "mock_impls.h"
+#include "thermostat/interfaces.h"
+#include "thermostat/memory_monitor.h"
+#include "thermostat/settings.h"
+#include "thermostat/thermostat_tasks.h"
+
+namespace thermostat {
+namespace {
+
+namespace t = testing;
+
+TEST(PaintMemoryTest, CountsUpToTheDeepestWrite) {
+  uint8_t ram[64] = {0};
+  PaintMemory(ram + 8, ram + 64);
+  EXPECT_EQ(CountPainted(ram + 8, ram + 64), 56);
+
+  // The stack grows down from the end.
+  ram[63] = 0;
+  ram[40] = 0;
+  EXPECT_EQ(CountPainted(ram + 8, ram + 64), 32);
+
+  // A write further in than any before it.
+  ram[8] = 0;
+  EXPECT_EQ(CountPainted(ram + 8, ram + 64), 0);
+}
+
+TEST(PaintMemoryTest, EmptyRange) {
+  uint8_t ram[4] = {0};
+  PaintMemory(ram, ram);
+  EXPECT_EQ(ram[0], 0);
+  EXPECT_EQ(CountPainted(ram, ram), 0);
+}
+
+class FakeMemory : public Memory {
+ public:
+  uint16_t FreeBytes() override {
+    scans++;
+    return free_bytes;
+  }
+  uint16_t MinFreeBytes() override { return min_free_bytes; }
+
+  uint16_t free_bytes = 2000;
+  uint16_t min_free_bytes = 1000;
+  int scans = 0;
+};
+
+class MemoryMonitoringThermostatTaskTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ON_CALL(wrapper, RunOnce(t::_)).WillByDefault(t::Return(Status::kOk));
+  }
+
+  Status RunAt(const uint32_t millis) {
+    settings.now = millis;
+    const Status status = error_task.RunOnce(&settings);
+    settings.first_run = false;
+    return status;
+  }
+
+ protected:
+  Settings settings;
+  FakeMemory memory;
+  FakePrint print;
+  FakeDisplay display;
+  t::NiceMock<MockThermostatTask> wrapper;
+  MemoryMonitoringThermostatTask task =
+      MemoryMonitoringThermostatTask(&memory, &wrapper, /*low_bytes=*/500);
+  ErrorDisplayingThermostatTask error_task =
+      ErrorDisplayingThermostatTask(&display, &print, &task);
+};
+
+TEST_F(MemoryMonitoringThermostatTaskTest, ScansOnceAMinute) {
+  EXPECT_EQ(RunAt(1000), Status::kOk);
+  EXPECT_EQ(settings.free_memory_bytes, 2000);
+  EXPECT_EQ(settings.min_free_memory_bytes, 1000);
+
+  memory.free_bytes = 1900;
+  RunAt(1000 + Clock::MinutesToMillis(1) - 1);
+  EXPECT_EQ(memory.scans, 1);
+  EXPECT_EQ(settings.free_memory_bytes, 2000);
+
+  RunAt(1000 + Clock::MinutesToMillis(1));
+  EXPECT_EQ(memory.scans, 2);
+  EXPECT_EQ(settings.free_memory_bytes, 1900);
+}
+
+TEST_F(MemoryMonitoringThermostatTaskTest, WarnsOfLowMemory) {
+  EXPECT_EQ(RunAt(1000), Status::kOk);
+  EXPECT_FALSE(settings.low_memory);
+
+  memory.min_free_bytes = 499;
+  EXPECT_EQ(RunAt(1000 + Clock::MinutesToMillis(1)), Status::kOk);
+  EXPECT_TRUE(settings.low_memory);
+  EXPECT_EQ(settings.status, Status::kOk);
+  EXPECT_EQ(display.GetChar(0, 15), 'M');
+
+  // Still shown on every cycle in between the scans.
+  EXPECT_EQ(RunAt(2000 + Clock::MinutesToMillis(1)), Status::kOk);
+  EXPECT_EQ(display.GetChar(0, 15), 'M');
+  EXPECT_EQ(memory.scans, 2);
+}
+
+TEST_F(MemoryMonitoringThermostatTaskTest, KeepsHeatingOnLowMemory) {
+  // The production order, with the relays inside the memory monitor.
+  RelaysStub relays;
+  RelaySettingThermostatTask relay_task(&relays, &print, &wrapper);
+  MemoryMonitoringThermostatTask memory_task(&memory, &relay_task, /*low_bytes=*/500);
+  ErrorDisplayingThermostatTask chain(&display, &print, &memory_task);
+
+  settings.hvac = HvacMode::HEAT;
+  settings.fan = FanMode::ON;
+  memory.min_free_bytes = 100;
+  for (int i = 0; i < 3; ++i) {
+    settings.now = 1000 + i * 1000;
+    EXPECT_EQ(chain.RunOnce(&settings), Status::kOk);
+    settings.first_run = false;
+
+    EXPECT_TRUE(settings.low_memory);
+    EXPECT_EQ(relays.Get(RelayType::kHeat), RelayState::kOn);
+    EXPECT_EQ(relays.Get(RelayType::kFan), RelayState::kOn);
+    EXPECT_EQ(relays.Get(RelayType::kCool), RelayState::kOff);
+  }
+  EXPECT_EQ(display.GetChar(0, 15), 'M');
+}
+
+TEST_F(MemoryMonitoringThermostatTaskTest, KeepsTheWrappedError) {
+  memory.min_free_bytes = 100;
+  EXPECT_CALL(wrapper, RunOnce(t::_)).WillOnce(t::Return(Status::kPrimarySensorFail));
+
+  EXPECT_EQ(RunAt(1000), Status::kPrimarySensorFail);
+  EXPECT_EQ(settings.status, Status::kPrimarySensorFail);
+  EXPECT_TRUE(settings.low_memory);
+  // The latched error takes the display over the memory warning.
+  EXPECT_EQ(display.GetChar(0, 15), 'C');
+}
+
+}  // namespace
+}  // namespace thermostat
@@ -52,6 +52,7 @@ class MenusTest : public testing::Test {
     settings.persisted.cool_setpoints[0].temperature_x10 = 770;
     settings.persisted.cool_setpoints[1].hour = 21;
     settings.persisted.cool_setpoints[1].temperature_x10 = 720;
+    CompileSchedules(&settings);
   };
 
   void TearDown() override{};
@@ -75,9 +76,9 @@ static Button CycleThroughEditSettings(uint32_t timeout) {
     case 0:
       return Button::RIGHT;
     case 1:
-    case 10:
+    case 15:
       EXPECT_STREQ(display.GetString(string, 1, 0, 16), "Fan:OFF         ");
-      if (counter == 10) {
+      if (counter == 15) {
         return Button::LEFT;
       }
       break;
@@ -85,26 +86,42 @@ static Button CycleThroughEditSettings(uint32_t timeout) {
       EXPECT_STREQ(display.GetString(string, 1, 0, 16), "Mode:BOTH       ");
       break;
     case 3:
-      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7 07:00  ");
+      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7" "07:00 **");
       break;
     case 4:
-      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H2:68.0\xA7 21:00  ");
+      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H2:68.0\xA7" "21:00 **");
       break;
     case 5:
-      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "C1:77.0\xA7 07:00  ");
+      // The unused setpoints.
+      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H3:00.0\xA7" "00:00 **");
       break;
     case 6:
-      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "C2:72.0\xA7 21:00  ");
+      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H4:00.0\xA7" "00:00 **");
       break;
     case 7:
-      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "Tolerance: 1.5\xA7 ");
+      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "C1:77.0\xA7" "07:00 **");
       break;
     case 8:
-      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "Date: 10:10 We  ");
+      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "C2:72.0\xA7" "21:00 **");
       break;
     case 9:
+      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "C3:00.0\xA7" "00:00 **");
+      break;
+    case 10:
+      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "C4:00.0\xA7" "00:00 **");
+      break;
+    case 11:
+      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "Tolerance: 1.5\xA7 ");
+      break;
+    case 12:
+      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "Date: 10:10 We  ");
+      break;
+    case 13:
       EXPECT_STREQ(display.GetString(string, 1, 0, 16), "Fan dt:180m 00% ");
       break;
+    case 14:
+      EXPECT_STREQ(display.GetString(string, 1, 0, 16), "Recovery:OFF    ");
+      break;
     default:
       EXPECT_FALSE(true);
       return Button::NONE;
@@ -129,46 +146,55 @@ static Button SetpointEdit(uint32_t timeout) {
   }
   int seq = 3;
   if (counter == seq++) {
-    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7 07:00  ");
+    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7" "07:00 **");
     return Button::SELECT;
   }
   if (counter == seq++) {
-    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:__._\xA7 07:00  ");
+    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:__._\xA7" "07:00 **");
     clock.Increment(600);
     return Button::UP;
   }
   if (counter == seq++) {
-    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.1\xA7 07:00  ");
+    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.1\xA7" "07:00 **");
     return Button::DOWN;
   }
   if (counter == seq++) {
-    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7 07:00  ");
+    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7" "07:00 **");
     // Move to the next field.
     return Button::RIGHT;
   }
   if (counter == seq++) {
-    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7 __:00  ");
+    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7" "__:00 **");
     return Button::UP;
   }
   if (counter == seq++) {
-    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7 08:00  ");
+    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7" "08:00 **");
     return Button::DOWN;
   }
   if (counter == seq++) {
-    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7 07:00  ");
+    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7" "07:00 **");
     // Move to the next field.
     return Button::RIGHT;
   }
   if (counter == seq++) {
-    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7 07:__  ");
+    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7" "07:__ **");
     return Button::UP;
   }
   if (counter == seq++) {
-    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7 07:01  ");
+    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7" "07:01 **");
     return Button::DOWN;
   }
   if (counter == seq++) {
-    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7 07:00  ");
+    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7" "07:00 **");
+    // Move to the next field.
+    return Button::RIGHT;
+  }
+  if (counter == seq++) {
+    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7" "07:00 __");
+    return Button::UP;
+  }
+  if (counter == seq++) {
+    EXPECT_STREQ(display.GetString(string, 1, 0, 16), "H1:70.0\xA7" "07:00 WD");
     return Button::SELECT;
   }
   if (counter == seq++) {
@@ -187,6 +213,88 @@ TEST_F(MenusTest, SetpointEdit) {
 
   Menus menu = Menus(&settings, &SetpointEdit, &clock, &display, &mock_storer);
   menu.EditSettings();
+
+  // Now only on weekdays, so Saturday morning holds Friday night's setpoint.
+  EXPECT_EQ(settings.persisted.heat_setpoints[0].days, kWeekdays);
+  Date saturday;
+  saturday.hour = 10;
+  saturday.day_of_week = 6;
+  EXPECT_EQ(GetSetpointTemp(settings, saturday, HvacMode::HEAT), 680);
+}
+
+static Button ShowTimings(uint32_t timeout) {
+  char string[17];
+  ++counter;
+  // Page through the statuses to the timing page.
+  if (counter < 10) {
+    return Button::LEFT;
+  }
+  EXPECT_STREQ(display.GetString(string, 1, 0, 16), "Loop:5000/5000us");
+  return Button::RIGHT;
+}
+
+TEST_F(MenusTest, ShowTimings) {
+  counter = 0;
+  clock.SetMillis(0);
+
+  Timings timings(&clock, &print, nullptr, 0);
+  timings.Poll();
+  clock.Increment(5);
+  timings.Poll();
+
+  Menus menu = Menus(&settings, &ShowTimings, &clock, &display, &mock_storer, &timings);
+  menu.ShowStatuses();
+  EXPECT_EQ(counter, 10);
+}
+
+static Button ShowJitter(uint32_t timeout) {
+  char string[17];
+  ++counter;
+  // Page through the statuses to the jitter page.
+  if (counter < 11) {
+    return Button::LEFT;
+  }
+  EXPECT_STREQ(display.GetString(string, 1, 0, 16), "Missed:1        ");
+  return Button::RIGHT;
+}
+
+TEST_F(MenusTest, ShowJitter) {
+  counter = 0;
+
+  class NoopTask : public ThermostatTask {
+   public:
+    Status RunOnce(Settings* settings) override { return Status::kOk; }
+  } noop;
+  ScheduledTask tasks[] = {{"Control", &noop, 1000, 100, false}};
+  Scheduler scheduler(&clock, &print, tasks, 1);
+  scheduler.RunOnce(&settings);
+  clock.Increment(1500);
+  scheduler.RunOnce(&settings);
+
+  Menus menu = Menus(&settings, &ShowJitter, &clock, &display, &mock_storer, nullptr, &scheduler);
+  menu.ShowStatuses();
+  EXPECT_EQ(counter, 11);
+}
+
+static Button ShowMemory(uint32_t timeout) {
+  char string[17];
+  ++counter;
+  // Page through the statuses to the memory page.
+  if (counter < 12) {
+    return Button::LEFT;
+  }
+  EXPECT_STREQ(display.GetString(string, 1, 0, 16), "Mem:2048 Lo:512 ");
+  return Button::RIGHT;
+}
+
+TEST_F(MenusTest, ShowMemory) {
+  counter = 0;
+  settings.free_memory_bytes = 2048;
+  settings.min_free_memory_bytes = 512;
+
+  Menus menu = Menus(&settings, &ShowMemory, &clock, &display, &mock_storer);
+  menu.ShowStatuses();
+  EXPECT_EQ(counter, 12);
 }
 
 }  // namespace
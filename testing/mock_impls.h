@@ -1,6 +1,9 @@
 #ifndef MOCK_IMPLS_H_
 #define MOCK_IMPLS_H_
 #include <gtest/gtest.h>
+
+#include <cmath>
+
 #include "gmock/gmock.h"  // Brings in gMock.
 
 #include "settings.h"
@@ -18,14 +21,16 @@ class FakeSensor : public Sensor {
     request_active_ = true;
   };
 
-  float GetTemperature() override {
+  int16_t GetTemperatureX10() override {
     EXPECT_TRUE(enable_async_assert_ == false || request_active_ == true);
     request_active_ = false;
-    return temp_;
+    return std::lround(temp_ * 10);
   };
+  bool EndReading() override { return end_reading_result_; };
+  void SetEndReadingResult(bool result) { end_reading_result_ = result; };
   void EnableGasHeater(const bool enable) override { heater_enabled_ = enable; };
-  float GetHumidity() override { return humidity_; }
-  float GetPressure() override { return 5.432; };
+  uint8_t GetHumidity() override { return humidity_; }
+  uint32_t GetPressure() override { return 101325; };
 
   void SetHumidity(uint32_t humidity) { humidity_ = humidity; }
   uint32_t GetGasResistance() override {
@@ -39,12 +44,20 @@ class FakeSensor : public Sensor {
   uint32_t heater_value_ = 0;
   bool request_active_ = false;
   bool enable_async_assert_ = false;
+  bool end_reading_result_ = true;
 };
 
 class FakeClock : public Clock {
  public:
-  uint32_t Millis() const override { return millis_; };
+  uint32_t Millis() const override {
+    const uint32_t millis = millis_;
+    millis_ += auto_increment_;
+    return millis;
+  };
   void Increment(uint32_t millis) { millis_ += millis; }
+  // Advances the clock on every Millis() read to emulate time passing while code spins on
+  // the clock.
+  void SetAutoIncrement(uint32_t millis) { auto_increment_ = millis; }
   void SetMillis(uint32_t millis) { millis_ = millis; };
   void SetDate(const Date &date) { date_ = date; }
 
@@ -54,7 +67,8 @@ class FakeClock : public Clock {
 
  private:
   Date date_;
-  uint32_t millis_ = 0;
+  mutable uint32_t millis_ = 0;
+  uint32_t auto_increment_ = 0;
 };
 
 class RelaysStub : public Relays {
@@ -95,6 +109,7 @@ class FakeDisplay : public Display {
   };
 
   void write(uint8_t ch) override {
+    ++write_count_;
     if (col_pos_ >= 16) {
       return;
     }
@@ -105,10 +120,15 @@ class FakeDisplay : public Display {
   void SetCursor(const int col, const int row) override {
     // This log statement can be helpful in debugging unit test bugs.
     // LOG(INFO) << "SetCursor: c:" << col << " r:" << row;
+    ++set_cursor_count_;
     row_pos_ = row;
     col_pos_ = col;
   };
 
+  // Bus traffic counters, each of these is a transfer on the real LCD.
+  uint32_t write_count() const { return write_count_; }
+  uint32_t set_cursor_count() const { return set_cursor_count_; }
+
   uint8_t CompareRow(const uint8_t row, char *str_row) { return 0; };
 
   char *GetString(char *str, const uint8_t row, const uint8_t col, const uint8_t length) {
@@ -132,6 +152,9 @@ class FakeDisplay : public Display {
   // Where the next character should be written.
   uint8_t row_pos_;
   uint8_t col_pos_;
+
+  uint32_t write_count_ = 0;
+  uint32_t set_cursor_count_ = 0;
 };
 
 class FakeSettingsStorer : public SettingsStorer {
@@ -142,6 +165,46 @@ class FakeSettingsStorer : public SettingsStorer {
   Settings stored_settings;
 };
 
+// 4KB EEPROM like the Mega's, starting out erased. Counts the writes to each byte.
+class FakeEeprom : public Eeprom {
+ public:
+  static constexpr uint16_t kSize = 4096;
+
+  FakeEeprom() {
+    for (uint16_t i = 0; i < kSize; ++i) {
+      bytes_[i] = 0xFF;
+      writes_[i] = 0;
+    }
+  }
+  uint16_t Size() override { return kSize; };
+  uint8_t Read(const uint16_t address) override { return bytes_[address]; };
+  void Update(const uint16_t address, const uint8_t value) override {
+    EXPECT_LT(address, kSize);
+    if (bytes_[address] != value) {
+      bytes_[address] = value;
+      writes_[address]++;
+      total_writes_++;
+    }
+  };
+  // Flips a bit without counting it as a write, like a torn write would leave behind.
+  void Corrupt(const uint16_t address) { bytes_[address] ^= 0x01; };
+
+  uint32_t writes(const uint16_t address) const { return writes_[address]; };
+  uint32_t total_writes() const { return total_writes_; };
+  uint32_t max_writes() const {
+    uint32_t max = 0;
+    for (uint16_t i = 0; i < kSize; ++i) {
+      max = writes_[i] > max ? writes_[i] : max;
+    }
+    return max;
+  };
+
+ private:
+  uint8_t bytes_[kSize];
+  uint32_t writes_[kSize];
+  uint32_t total_writes_ = 0;
+};
+
 }  // namespace thermostat
 
 #endif  // MOCK_IMPLS_H_
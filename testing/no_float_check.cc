@@ -0,0 +1,107 @@
+// Build check that the periodic control path doesn't use floating point.
+//
+// The AVR has no FPU, so any float in RunOnce pulls in the soft-float library and costs
+// hundreds of cycles per operation. This builds the same tasks as the sketch with
+// -mgeneral-regs-only, where the compiler rejects any floating point code that gets
+// emitted, so a float added to the periodic tasks fails the build.
+//
+// This is a host build, not an AVR soft-float link check. It only covers the code the
+// tasks below instantiate from the headers included here. menus.h is not included, so
+// the status and edit pages aren't checked, and neither is anything only the sketch
+// builds, such as avr_impls.h.
+#include <stdint.h>
+
+#include "thermostat/idle.h"
+#include "thermostat/interfaces.h"
+#include "thermostat/scheduler.h"
+#include "thermostat/settings.h"
+#include "thermostat/thermostat_tasks.h"
+
+namespace thermostat {
+namespace {
+
+class StubClock : public Clock {
+ public:
+  Date Now() override { return date_; }
+  void Set(const Date& date) override { date_ = date; }
+  uint32_t Millis() const override { return millis_; }
+
+  void Advance(const uint32_t millis) { millis_ += millis; }
+
+ private:
+  Date date_;
+  uint32_t millis_ = 0;
+};
+
+class StubSensor : public Sensor {
+ public:
+  int16_t GetTemperatureX10() override { return 685; }
+  uint8_t GetHumidity() override { return 40; }
+  uint32_t GetPressure() override { return 101325; }
+  uint32_t GetGasResistance() override { return 20000; }
+};
+
+class StubDisplay : public Display {
+ public:
+  void write(const uint8_t ch) override { UNUSED(ch); }
+};
+
+class StubSleeper : public Sleeper {
+ public:
+  void Sleep(const uint32_t duration_us) override { UNUSED(duration_us); }
+};
+
+class StubRelays : public Relays {
+ public:
+  void Set(const RelayType relay, const RelayState state) override {
+    UNUSED(relay);
+    UNUSED(state);
+  }
+};
+
+int Run() {
+  Settings settings;
+  StubClock clock;
+  StubSensor sensor;
+  StubDisplay display;
+  StubRelays relays;
+
+  WrapperThermostatTask wrapper;
+  SensorUpdatingThermostatTask sensor_updating(&clock, &sensor, &display, &wrapper);
+  HvacControllerThermostatTask hvac_controller(&clock, &display, &sensor_updating);
+  LockoutControllingThermostatTask lockout_controlling(&hvac_controller);
+  HeatAdvancingThermostatTask heat_advancing(&lockout_controlling);
+  FanControllerThermostatTask fan_controller(&clock, &display, &heat_advancing);
+  RelaySettingThermostatTask relay_setting(&relays, &display, &fan_controller);
+  ErrorDisplayingThermostatTask error_displaying(&display, &display, &relay_setting);
+  HistoryUpdatingThermostatTask history_updating(&error_displaying);
+  TelemetryThermostatTask telemetry(&display, &history_updating);
+  UpdateDisplayThermostatTask update_display(&display, &display, &wrapper);
+  HistoryPruningThermostatTask history_pruning(&wrapper);
+  IaqUpdatingThermostatTask iaq_updating(&sensor, &wrapper);
+  PacingThermostatTask pacing(&clock, &telemetry);
+  PiControllerThermostatTask pi_controller(&clock, &display, &sensor_updating);
+
+  ScheduledTask tasks[] = {
+      {"Control", &telemetry, 1000, 500, true},
+      {"Display", &update_display, 250, 100, true},
+      {"Prune", &history_pruning, 60000, 10000, false},
+      {"IAQ", &iaq_updating, 300000, 60000, false},
+  };
+  Scheduler scheduler(&clock, &display, tasks, 4);
+  StubSleeper sleeper;
+  Idler idler(&clock, &sleeper, &scheduler, 5);
+
+  for (int i = 0; i < 100; ++i) {
+    clock.Advance(Clock::SecondsToMillis(5));
+    idler.Idle(scheduler.RunOnce(&settings) != Status::kSkipped);
+    pacing.RunOnce(&settings);
+    pi_controller.RunOnce(&settings);
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace thermostat
+
+int main() { return thermostat::Run(); }
@@ -0,0 +1,230 @@
+#include <glog/logging.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "mock_impls.h"
+#include "thermostat/interfaces.h"
+#include "thermostat/pi_controller.h"
+#include "thermostat/settings.h"
+#include "thermostat/thermostat_tasks.h"
+
+namespace thermostat {
+namespace {
+
+namespace t = testing;
+
+TEST(PiControllerTest, ProportionalToTheError) {
+  PiController controller(50, 0);
+
+  EXPECT_EQ(controller.Update(10, 0), 500);
+  EXPECT_EQ(controller.Update(2, 0), 100);
+  // Limited to the full duty, and nothing when past the setpoint.
+  EXPECT_EQ(controller.Update(30, 0), 1000);
+  EXPECT_EQ(controller.Update(-5, 0), 0);
+}
+
+TEST(PiControllerTest, IntegratesTheError) {
+  PiController controller(0, 36);
+
+  // 1° for an hour adds 36 for each 0.1°.
+  for (int i = 0; i < 60; ++i) {
+    controller.Update(10, Clock::SecondsToMillis(60));
+  }
+  EXPECT_EQ(controller.IntegralPermille(), 360);
+  EXPECT_EQ(controller.Update(0, 0), 360);
+
+  // And winds back down past the setpoint.
+  for (int i = 0; i < 30; ++i) {
+    controller.Update(-10, Clock::SecondsToMillis(60));
+  }
+  EXPECT_EQ(controller.IntegralPermille(), 180);
+
+  controller.Reset();
+  EXPECT_EQ(controller.IntegralPermille(), 0);
+}
+
+TEST(PiControllerTest, KeepsTheFractionsOfASecond) {
+  PiController controller(0, 36);
+
+  // 0.1° for an hour, in steps of 1.5 seconds.
+  for (int i = 0; i < 2400; ++i) {
+    controller.Update(1, 1500);
+  }
+  EXPECT_EQ(controller.IntegralPermille(), 36);
+}
+
+TEST(PiControllerTest, DoesntWindUpWhileSaturated) {
+  PiController controller(50, 25);
+
+  // Far below the setpoint for hours, at the full duty.
+  for (int i = 0; i < 600; ++i) {
+    EXPECT_EQ(controller.Update(100, Clock::SecondsToMillis(60)), 1000);
+  }
+  EXPECT_EQ(controller.IntegralPermille(), 0);
+
+  // Stops as soon as the setpoint is passed.
+  EXPECT_EQ(controller.Update(-1, Clock::SecondsToMillis(60)), 0);
+}
+
+TEST(PiControllerTest, IntegralLimitedToTheFullDuty) {
+  PiController controller(0, 25);
+
+  for (int i = 0; i < 600; ++i) {
+    controller.Update(10, Clock::SecondsToMillis(60));
+  }
+  EXPECT_EQ(controller.IntegralPermille(), 1000);
+}
+
+TEST(PiControllerTest, LimitsLongGaps) {
+  PiController controller(0, 36);
+
+  // Counts as a minute.
+  controller.Update(10, Clock::HoursToMillis(1));
+  EXPECT_EQ(controller.IntegralPermille(), 6);
+}
+
+class TimeProportionerTest : public testing::Test {
+ public:
+  // How many minutes of the next window the output is on for.
+  int OnMinutes(const int16_t duty_permille) {
+    int on = 0;
+    for (int i = 0; i < 30; ++i) {
+      on += proportioner.Update(duty_permille, Clock::MinutesToMillis(minute++));
+    }
+    return on;
+  }
+
+  uint32_t minute = 0;
+  TimeProportioner proportioner{Clock::MinutesToMillis(30), Clock::MinutesToMillis(5),
+                                Clock::MinutesToMillis(5)};
+};
+
+TEST_F(TimeProportionerTest, OnForTheDutyAtTheStart) {
+  EXPECT_TRUE(proportioner.Update(500, 0));
+  EXPECT_TRUE(proportioner.Update(500, Clock::MinutesToMillis(15) - 1));
+  EXPECT_FALSE(proportioner.Update(500, Clock::MinutesToMillis(15)));
+  EXPECT_FALSE(proportioner.Update(500, Clock::MinutesToMillis(30) - 1));
+  // The next window.
+  EXPECT_TRUE(proportioner.Update(500, Clock::MinutesToMillis(30)));
+}
+
+TEST_F(TimeProportionerTest, TakesTheDutyAtTheStartOfTheWindow) {
+  EXPECT_TRUE(proportioner.Update(500, 0));
+  EXPECT_TRUE(proportioner.Update(0, Clock::MinutesToMillis(10)));
+  EXPECT_FALSE(proportioner.Update(1000, Clock::MinutesToMillis(20)));
+}
+
+TEST_F(TimeProportionerTest, CarriesShortOnTimes) {
+  // 3 minutes is too short, so it's added to the next window.
+  EXPECT_EQ(OnMinutes(100), 0);
+  EXPECT_EQ(OnMinutes(100), 6);
+  EXPECT_EQ(OnMinutes(100), 0);
+}
+
+TEST_F(TimeProportionerTest, CarriesShortOffTimes) {
+  // 3 minutes off is too short, so it's taken from the next window.
+  EXPECT_EQ(OnMinutes(900), 30);
+  EXPECT_EQ(OnMinutes(900), 24);
+  EXPECT_EQ(OnMinutes(0), 0);
+}
+
+TEST_F(TimeProportionerTest, ResetDropsTheCarry) {
+  EXPECT_EQ(OnMinutes(100), 0);
+  proportioner.Reset();
+  EXPECT_EQ(OnMinutes(100), 0);
+}
+
+Settings DefaultSettings() {
+  Settings defaults;
+  defaults.persisted.version = VERSION;
+  defaults.persisted.tolerance_x10 = 20;
+  defaults.persisted.adaptive_recovery = false;
+
+  // 7am-9pm -> 70.0° ; 9pm-7am -> 65°
+  defaults.persisted.heat_setpoints[0].hour = 7;
+  defaults.persisted.heat_setpoints[0].temperature_x10 = 700;
+  defaults.persisted.heat_setpoints[1].hour = 21;
+  defaults.persisted.heat_setpoints[1].temperature_x10 = 650;
+
+  // 7am-9pm -> 80.0° ; 9pm-7am -> 75°
+  defaults.persisted.cool_setpoints[0].hour = 7;
+  defaults.persisted.cool_setpoints[0].temperature_x10 = 800;
+  defaults.persisted.cool_setpoints[1].hour = 21;
+  defaults.persisted.cool_setpoints[1].temperature_x10 = 750;
+  CompileSchedules(&defaults);
+  return defaults;
+}
+
+class PiControllerThermostatTaskTest : public testing::Test {
+ public:
+  void SetUp() override {
+    Date d;
+    d.hour = 10;
+    d.minute = 10;
+    d.day_of_week = 3;
+    clock.SetDate(d);
+
+    // Cover the default case of the wrapper RunOnce being called.
+    EXPECT_CALL(wrapper, RunOnce(t::_)).Times(t::AtLeast(0));
+  }
+
+  void RunAt(const uint32_t minute) {
+    settings.now = Clock::MinutesToMillis(minute);
+    EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  }
+
+  Settings settings = DefaultSettings();
+  FakeClock clock;
+  FakePrint print;
+  MockThermostatTask wrapper;
+  PiControllerThermostatTask task = PiControllerThermostatTask(&clock, &print, &wrapper);
+};
+
+TEST_F(PiControllerThermostatTaskTest, HeatsForTheDuty) {
+  settings.persisted.cool_enabled = false;
+  // 1° below the middle of the 70-72° band.
+  settings.current_mean_temperature_x10 = 700;
+
+  RunAt(0);
+  EXPECT_EQ(settings.hvac, HvacMode::HEAT);
+  EXPECT_EQ(task.duty_permille(), 500);
+  EXPECT_EQ(settings.heat_setpoint_x10, 700);
+  EXPECT_FALSE(settings.within_tolerance);
+
+  RunAt(14);
+  EXPECT_EQ(settings.hvac, HvacMode::HEAT);
+  RunAt(16);
+  EXPECT_EQ(settings.hvac, HvacMode::IDLE);
+}
+
+TEST_F(PiControllerThermostatTaskTest, IdleAtTheMiddleOfTheBand) {
+  settings.persisted.cool_enabled = false;
+  settings.current_mean_temperature_x10 = 710;
+
+  RunAt(0);
+  EXPECT_EQ(settings.hvac, HvacMode::IDLE);
+  EXPECT_TRUE(settings.within_tolerance);
+}
+
+TEST_F(PiControllerThermostatTaskTest, CoolsAboveTheMidpoint) {
+  // Above the middle of the 70° heat and 80° cool setpoints, and 3° above the middle of
+  // the 78-80° band.
+  settings.current_mean_temperature_x10 = 820;
+
+  RunAt(0);
+  EXPECT_EQ(settings.hvac, HvacMode::COOL);
+  EXPECT_EQ(task.duty_permille(), 1000);
+}
+
+TEST_F(PiControllerThermostatTaskTest, IdleWhenDisabled) {
+  settings.persisted.heat_enabled = false;
+  settings.persisted.cool_enabled = false;
+  settings.current_mean_temperature_x10 = 600;
+
+  RunAt(0);
+  EXPECT_EQ(settings.hvac, HvacMode::IDLE);
+}
+
+}  // namespace
+}  // namespace thermostat
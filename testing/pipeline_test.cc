@@ -0,0 +1,149 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "mock_impls.h"
+#include "thermostat/pipeline.h"
+#include "thermostat/settings.h"
+#include "thermostat/thermostat_tasks.h"
+
+namespace thermostat {
+namespace {
+
+template <typename A, typename B>
+struct IsSame {
+  static constexpr bool value = false;
+};
+
+template <typename A>
+struct IsSame<A, A> {
+  static constexpr bool value = true;
+};
+
+typedef Pipeline<WrapperThermostatTask, PacingLayer, HvacControllerLayer, SensorUpdatingLayer>
+    SmallPipeline;
+
+static_assert(IsSame<SmallPipeline::Of<SensorUpdatingLayer>,
+                     SensorUpdatingLayer<WrapperThermostatTask>>::value,
+              "The innermost layer wraps the innermost type");
+static_assert(IsSame<SmallPipeline::Of<HvacControllerLayer>,
+                     HvacControllerLayer<SensorUpdatingLayer<WrapperThermostatTask>>>::value,
+              "Each layer wraps the next one");
+static_assert(IsSame<SmallPipeline::Of<PacingLayer>, SmallPipeline::Outermost>::value,
+              "The first layer is the outermost");
+static_assert(IsSame<SmallPipeline::Of<FanControllerLayer>, void>::value,
+              "Missing layers have no type");
+
+typedef Pipeline<WrapperThermostatTask, PacingLayer, HistoryUpdatingLayer,
+                 ErrorDisplayingLayer, UpdateDisplayLayer, RelaySettingLayer,
+                 FanControllerLayer, HeatAdvancingLayer, LockoutControllingLayer,
+                 HvacControllerLayer, SensorUpdatingLayer>
+    FullPipeline;
+
+// The hardware for one thermostat.
+struct Hardware {
+  FakeClock clock;
+  FakeSensor sensor;
+  FakeDisplay display;
+  RelaysStub relays;
+  NullPrint print;
+  Settings settings;
+};
+
+// The same layers as FullPipeline wired through ThermostatTask pointers.
+struct VirtualChain {
+  explicit VirtualChain(Hardware* hw)
+      : sensor_updating(&hw->clock, &hw->sensor, &hw->print, &wrapper),
+        hvac_controller(&hw->clock, &hw->print, &sensor_updating),
+        lockout_controlling(&hvac_controller),
+        heat_advancing(&lockout_controlling),
+        fan_controller(&hw->clock, &hw->print, &heat_advancing),
+        relay_setting(&hw->relays, &hw->print, &fan_controller),
+        update_display(&hw->display, &hw->print, &relay_setting),
+        error_displaying(&hw->display, &hw->print, &update_display),
+        history_updating(&error_displaying),
+        pacing(&hw->clock, &history_updating) {}
+
+  WrapperThermostatTask wrapper;
+  SensorUpdatingThermostatTask sensor_updating;
+  HvacControllerThermostatTask hvac_controller;
+  LockoutControllingThermostatTask lockout_controlling;
+  HeatAdvancingThermostatTask heat_advancing;
+  FanControllerThermostatTask fan_controller;
+  RelaySettingThermostatTask relay_setting;
+  UpdateDisplayThermostatTask update_display;
+  ErrorDisplayingThermostatTask error_displaying;
+  HistoryUpdatingThermostatTask history_updating;
+  PacingThermostatTask pacing;
+};
+
+struct StaticChain {
+  explicit StaticChain(Hardware* hw)
+      : sensor_updating(&hw->clock, &hw->sensor, &hw->print, &wrapper),
+        hvac_controller(&hw->clock, &hw->print, &sensor_updating),
+        lockout_controlling(&hvac_controller),
+        heat_advancing(&lockout_controlling),
+        fan_controller(&hw->clock, &hw->print, &heat_advancing),
+        relay_setting(&hw->relays, &hw->print, &fan_controller),
+        update_display(&hw->display, &hw->print, &relay_setting),
+        error_displaying(&hw->display, &hw->print, &update_display),
+        history_updating(&error_displaying),
+        pacing(&hw->clock, &history_updating) {}
+
+  WrapperThermostatTask wrapper;
+  FullPipeline::Of<SensorUpdatingLayer> sensor_updating;
+  FullPipeline::Of<HvacControllerLayer> hvac_controller;
+  FullPipeline::Of<LockoutControllingLayer> lockout_controlling;
+  FullPipeline::Of<HeatAdvancingLayer> heat_advancing;
+  FullPipeline::Of<FanControllerLayer> fan_controller;
+  FullPipeline::Of<RelaySettingLayer> relay_setting;
+  FullPipeline::Of<UpdateDisplayLayer> update_display;
+  FullPipeline::Of<ErrorDisplayingLayer> error_displaying;
+  FullPipeline::Of<HistoryUpdatingLayer> history_updating;
+  FullPipeline::Of<PacingLayer> pacing;
+};
+
+TEST(PipelineTest, MatchesVirtualChain) {
+  Hardware virtual_hw;
+  Hardware static_hw;
+  VirtualChain virtual_chain(&virtual_hw);
+  StaticChain static_chain(&static_hw);
+  for (Hardware* hw : {&virtual_hw, &static_hw}) {
+    hw->settings.persisted = DefaultPersistedSettings();
+    hw->settings.persisted.heat_enabled = true;
+    hw->settings.persisted.cool_enabled = true;
+    CompileSchedules(&hw->settings);
+    hw->clock.SetMillis(10000);
+  }
+
+  // Cool down far enough to heat, then warm up far enough to cool.
+  bool heated = false;
+  for (int cycle = 0; cycle < 2000; ++cycle) {
+    const float temperature = 60 + (cycle < 1000 ? 0 : (cycle - 1000) * 0.03);
+    for (Hardware* hw : {&virtual_hw, &static_hw}) {
+      hw->clock.Increment(2000);
+      hw->sensor.SetTemperature(temperature);
+    }
+    ASSERT_EQ(virtual_chain.pacing.RunOnce(&virtual_hw.settings),
+              static_chain.pacing.RunOnce(&static_hw.settings));
+
+    ASSERT_EQ(virtual_hw.settings.hvac, static_hw.settings.hvac) << cycle;
+    heated |= static_hw.settings.hvac == HvacMode::HEAT;
+    ASSERT_EQ(virtual_hw.settings.fan, static_hw.settings.fan) << cycle;
+    ASSERT_EQ(virtual_hw.settings.heat_high, static_hw.settings.heat_high) << cycle;
+    for (uint8_t relay = 0; relay < static_cast<uint8_t>(RelayType::kMax); ++relay) {
+      ASSERT_EQ(virtual_hw.relays.Get(static_cast<RelayType>(relay)),
+                static_hw.relays.Get(static_cast<RelayType>(relay)));
+    }
+    char virtual_row[17];
+    char static_row[17];
+    ASSERT_STREQ(virtual_hw.display.GetString(virtual_row, 0, 0, 16),
+                 static_hw.display.GetString(static_row, 0, 0, 16));
+  }
+  // Both modes should have been reached.
+  EXPECT_TRUE(heated);
+  EXPECT_EQ(static_hw.settings.hvac, HvacMode::COOL);
+}
+
+}  // namespace
+}  // namespace thermostat
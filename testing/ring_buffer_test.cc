@@ -0,0 +1,87 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <thread>
+
+#include "thermostat/ring_buffer.h"
+
+namespace thermostat {
+namespace {
+
+TEST(SpscRingTest, PopsInOrder) {
+  SpscRing<uint16_t, 4> ring;
+  uint16_t item = 0;
+
+  EXPECT_FALSE(ring.Pop(&item));
+  EXPECT_TRUE(ring.Push(1));
+  EXPECT_TRUE(ring.Push(2));
+  EXPECT_EQ(ring.size(), 2);
+
+  EXPECT_TRUE(ring.Pop(&item));
+  EXPECT_EQ(item, 1);
+  EXPECT_TRUE(ring.Pop(&item));
+  EXPECT_EQ(item, 2);
+  EXPECT_FALSE(ring.Pop(&item));
+}
+
+TEST(SpscRingTest, DropsWhenFull) {
+  SpscRing<uint16_t, 4> ring;
+  for (uint16_t i = 0; i < 4; ++i) {
+    EXPECT_TRUE(ring.Push(i));
+  }
+
+  EXPECT_FALSE(ring.Push(4));
+  EXPECT_EQ(ring.dropped(), 1);
+
+  // The oldest items are kept.
+  uint16_t item = 0;
+  EXPECT_TRUE(ring.Pop(&item));
+  EXPECT_EQ(item, 0);
+  EXPECT_TRUE(ring.Push(5));
+}
+
+TEST(SpscRingTest, WrapsTheIndices) {
+  SpscRing<uint16_t, 8> ring;
+  uint16_t item = 0;
+  // More than 256 items, so the byte indices wrap several times.
+  for (uint16_t i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(ring.Push(i));
+    ASSERT_TRUE(ring.Push(i + 1));
+    ASSERT_TRUE(ring.Pop(&item));
+    EXPECT_EQ(item, i);
+    ASSERT_TRUE(ring.Pop(&item));
+    EXPECT_EQ(item, i + 1);
+  }
+  EXPECT_EQ(ring.size(), 0);
+}
+
+TEST(SpscRingTest, ProducerAndConsumerThreads) {
+  SpscRing<uint32_t, 16> ring;
+  constexpr uint32_t kItems = 200000;
+
+  std::thread producer([&ring] {
+    for (uint32_t i = 0; i < kItems;) {
+      if (ring.Push(i)) {
+        ++i;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  uint32_t item = 0;
+  while (expected < kItems) {
+    if (ring.Pop(&item)) {
+      ASSERT_EQ(item, expected);
+      ++expected;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+}
+
+}  // namespace
+}  // namespace thermostat
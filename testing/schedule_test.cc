@@ -0,0 +1,159 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "thermostat/interfaces.h"
+#include "thermostat/schedule.h"
+
+namespace thermostat {
+namespace {
+
+uint16_t At(const uint8_t day_of_week, const uint8_t hour, const uint8_t minute) {
+  Date date;
+  date.day_of_week = day_of_week;
+  date.hour = hour;
+  date.minute = minute;
+  return WeekMinute(date);
+}
+
+class WeeklyScheduleTest : public testing::Test {
+ public:
+  void Set(const uint8_t index, const uint8_t hour, const uint8_t minute, const uint8_t days,
+           const int16_t temperature_x10) {
+    setpoints[index].hour = hour;
+    setpoints[index].minute = minute;
+    setpoints[index].days = days;
+    setpoints[index].temperature_x10 = temperature_x10;
+  }
+
+  int16_t Current(const uint16_t week_minute) {
+    int16_t temperature_x10 = 0;
+    EXPECT_TRUE(schedule.Current(setpoints, week_minute, &temperature_x10));
+    return temperature_x10;
+  }
+
+  Setpoint setpoints[kScheduleSize];
+  WeeklySchedule schedule;
+};
+
+TEST_F(WeeklyScheduleTest, WeekMinute) {
+  EXPECT_EQ(At(0, 0, 0), 0);
+  EXPECT_EQ(At(1, 7, 30), kMinutesPerDay + 450);
+  EXPECT_EQ(At(6, 23, 59), kMinutesPerWeek - 1);
+}
+
+TEST_F(WeeklyScheduleTest, NothingWithoutSetpoints) {
+  schedule.Compile(setpoints);
+
+  int16_t temperature_x10 = 0;
+  uint16_t minutes_until = 0;
+  EXPECT_FALSE(schedule.Current(setpoints, At(3, 10, 0), &temperature_x10));
+  EXPECT_FALSE(schedule.Next(setpoints, At(3, 10, 0), &temperature_x10, &minutes_until));
+}
+
+TEST_F(WeeklyScheduleTest, SwitchesAtTheSetpointsMinute) {
+  Set(0, 7, 0, kEveryDay, 700);
+  Set(1, 21, 0, kEveryDay, 650);
+  schedule.Compile(setpoints);
+
+  EXPECT_EQ(Current(At(1, 6, 59)), 650);
+  EXPECT_EQ(Current(At(1, 7, 0)), 700);
+  EXPECT_EQ(Current(At(1, 20, 59)), 700);
+  EXPECT_EQ(Current(At(1, 21, 0)), 650);
+  // Overnight into the next day.
+  EXPECT_EQ(Current(At(2, 0, 30)), 650);
+}
+
+TEST_F(WeeklyScheduleTest, SortsTheSetpointsAndSkipsTheUnused) {
+  Set(0, 21, 0, kEveryDay, 650);
+  // Turned off, by the temperature or the days.
+  Set(1, 12, 0, kEveryDay, 0);
+  Set(2, 13, 0, 0, 800);
+  Set(3, 7, 0, kEveryDay, 700);
+  schedule.Compile(setpoints);
+
+  EXPECT_EQ(Current(At(4, 6, 0)), 650);
+  EXPECT_EQ(Current(At(4, 12, 30)), 700);
+  EXPECT_EQ(Current(At(4, 13, 30)), 700);
+  EXPECT_EQ(Current(At(4, 22, 0)), 650);
+}
+
+TEST_F(WeeklyScheduleTest, WeekdaysAndTheWeekend) {
+  Set(0, 7, 0, kWeekdays, 700);
+  Set(1, 9, 0, kWeekend, 720);
+  Set(2, 22, 0, kEveryDay, 650);
+  schedule.Compile(setpoints);
+
+  // Friday.
+  EXPECT_EQ(Current(At(5, 8, 0)), 700);
+  // Saturday only warms up at 9.
+  EXPECT_EQ(Current(At(6, 8, 0)), 650);
+  EXPECT_EQ(Current(At(6, 9, 0)), 720);
+  EXPECT_EQ(Current(At(0, 8, 0)), 650);
+  EXPECT_EQ(Current(At(0, 10, 0)), 720);
+  // Monday.
+  EXPECT_EQ(Current(At(1, 8, 0)), 700);
+}
+
+TEST_F(WeeklyScheduleTest, NextSetpoint) {
+  Set(0, 7, 0, kWeekdays, 700);
+  Set(1, 9, 0, kWeekend, 720);
+  Set(2, 22, 0, kEveryDay, 650);
+  schedule.Compile(setpoints);
+
+  int16_t temperature_x10 = 0;
+  uint16_t minutes_until = 0;
+  // Friday night until Saturday at 9.
+  EXPECT_TRUE(schedule.Next(setpoints, At(5, 22, 0), &temperature_x10, &minutes_until));
+  EXPECT_EQ(temperature_x10, 720);
+  EXPECT_EQ(minutes_until, 11 * 60);
+
+  // Sunday night until Monday at 7.
+  EXPECT_TRUE(schedule.Next(setpoints, At(0, 23, 0), &temperature_x10, &minutes_until));
+  EXPECT_EQ(temperature_x10, 700);
+  EXPECT_EQ(minutes_until, 8 * 60);
+}
+
+TEST_F(WeeklyScheduleTest, WrapsAroundTheWeek) {
+  Set(0, 23, 0, 0x40, 680);
+  schedule.Compile(setpoints);
+
+  // Saturday's setpoint holds all week.
+  EXPECT_EQ(Current(At(0, 0, 30)), 680);
+  EXPECT_EQ(Current(At(3, 12, 0)), 680);
+  EXPECT_EQ(Current(At(6, 23, 30)), 680);
+
+  int16_t temperature_x10 = 0;
+  uint16_t minutes_until = 0;
+  EXPECT_TRUE(schedule.Next(setpoints, At(0, 0, 30), &temperature_x10, &minutes_until));
+  EXPECT_EQ(minutes_until, kMinutesPerWeek - 90);
+  // At the setpoint's minute it's a week until it starts again.
+  EXPECT_TRUE(schedule.Next(setpoints, At(6, 23, 0), &temperature_x10, &minutes_until));
+  EXPECT_EQ(minutes_until, kMinutesPerWeek);
+}
+
+TEST_F(WeeklyScheduleTest, FollowsTheClockBackwards) {
+  Set(0, 7, 0, kWeekdays, 700);
+  Set(1, 9, 0, kWeekend, 720);
+  Set(2, 22, 0, kEveryDay, 650);
+  schedule.Compile(setpoints);
+
+  EXPECT_EQ(Current(At(5, 8, 0)), 700);
+  // The clock was set back to Monday.
+  EXPECT_EQ(Current(At(1, 6, 0)), 650);
+  EXPECT_EQ(Current(At(1, 7, 0)), 700);
+}
+
+TEST_F(WeeklyScheduleTest, ReadsTheTemperaturesFromTheSetpoints) {
+  Set(0, 7, 0, kEveryDay, 700);
+  Set(1, 21, 0, kEveryDay, 650);
+  schedule.Compile(setpoints);
+  EXPECT_EQ(Current(At(2, 12, 0)), 700);
+
+  // Only changing the times, the days or which setpoints are used needs a Compile.
+  setpoints[0].temperature_x10 = 710;
+  EXPECT_EQ(Current(At(2, 12, 0)), 710);
+}
+
+}  // namespace
+}  // namespace thermostat
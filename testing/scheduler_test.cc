@@ -0,0 +1,169 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "mock_impls.h"
+#include "thermostat/scheduler.h"
+#include "thermostat/settings.h"
+
+namespace thermostat {
+namespace {
+
+// Counts the runs and remembers what the settings looked like.
+class CountingTask : public ThermostatTask {
+ public:
+  Status RunOnce(Settings* settings) override {
+    ++runs;
+    saw_first_run |= settings->first_run;
+    last_now = settings->now;
+    return status;
+  }
+
+  int runs = 0;
+  bool saw_first_run = false;
+  uint32_t last_now = 0;
+  Status status = Status::kOk;
+};
+
+class SchedulerTest : public testing::Test {
+ protected:
+  void SetUp() override { clock.SetMillis(10000); }
+
+  // Calls the scheduler every step_ms, as the main loop would.
+  void RunFor(const uint32_t millis, const uint32_t step_ms) {
+    for (uint32_t elapsed = 0; elapsed < millis; elapsed += step_ms) {
+      clock.Increment(step_ms);
+      scheduler.RunOnce(&settings);
+    }
+  }
+
+  Settings settings;
+  FakeClock clock;
+  FakePrint print;
+  CountingTask fast;
+  CountingTask slow;
+  ScheduledTask tasks[2] = {
+      {"Fast", &fast, 250, 50, true},
+      {"Slow", &slow, 1000, 100, false},
+  };
+  Scheduler scheduler = Scheduler(&clock, &print, tasks, 2);
+};
+
+TEST_F(SchedulerTest, RunsEverythingFirst) {
+  EXPECT_EQ(scheduler.RunOnce(&settings), Status::kOk);
+
+  EXPECT_EQ(fast.runs, 1);
+  EXPECT_EQ(slow.runs, 1);
+  EXPECT_TRUE(fast.saw_first_run);
+  EXPECT_TRUE(slow.saw_first_run);
+  EXPECT_FALSE(settings.first_run);
+  EXPECT_EQ(fast.last_now, 10000);
+}
+
+TEST_F(SchedulerTest, RunsEachTaskAtItsPeriod) {
+  scheduler.RunOnce(&settings);
+  RunFor(10000, 10);
+
+  EXPECT_EQ(fast.runs, 1 + 40);
+  EXPECT_EQ(slow.runs, 1 + 10);
+  // Calling every 10ms never starts a run late.
+  EXPECT_EQ(scheduler.task(0).jitter.max_late_us(), 0);
+  EXPECT_EQ(scheduler.task(1).jitter.missed(), 0);
+}
+
+TEST_F(SchedulerTest, SkipsWhenNothingIsDue) {
+  scheduler.RunOnce(&settings);
+  clock.Increment(100);
+
+  EXPECT_EQ(scheduler.RunOnce(&settings), Status::kSkipped);
+  EXPECT_EQ(fast.runs, 1);
+}
+
+TEST_F(SchedulerTest, RecordsLateness) {
+  scheduler.RunOnce(&settings);
+  // Both tasks start late, the fast one by more than its deadline.
+  clock.Increment(1060);
+  scheduler.RunOnce(&settings);
+
+  const JitterStats& fast_jitter = scheduler.task(0).jitter;
+  EXPECT_EQ(fast_jitter.runs(), 2);
+  EXPECT_EQ(fast_jitter.max_late_us(), 810000);
+  EXPECT_EQ(fast_jitter.mean_late_us(), 405000);
+  EXPECT_EQ(fast_jitter.missed(), 1);
+  const JitterStats& slow_jitter = scheduler.task(1).jitter;
+  EXPECT_EQ(slow_jitter.max_late_us(), 60000);
+  EXPECT_EQ(slow_jitter.missed(), 0);
+
+  scheduler.Reset();
+  EXPECT_EQ(scheduler.task(0).jitter.runs(), 0);
+}
+
+TEST_F(SchedulerTest, KeepsToThePeriodWhenLate) {
+  scheduler.RunOnce(&settings);
+  // Due at 1000ms, starting at 1040ms.
+  clock.Increment(1040);
+  scheduler.RunOnce(&settings);
+  EXPECT_EQ(slow.runs, 2);
+
+  // The next run is still due at 2000ms rather than 2040ms.
+  clock.Increment(960);
+  scheduler.RunOnce(&settings);
+  EXPECT_EQ(slow.runs, 3);
+}
+
+TEST_F(SchedulerTest, DropsMissedPeriods) {
+  scheduler.RunOnce(&settings);
+  // Blocked for several periods, which only runs the tasks once.
+  clock.Increment(5500);
+  scheduler.RunOnce(&settings);
+  EXPECT_EQ(slow.runs, 2);
+
+  // And the period restarts from the late run.
+  clock.Increment(999);
+  scheduler.RunOnce(&settings);
+  EXPECT_EQ(slow.runs, 2);
+  clock.Increment(1);
+  scheduler.RunOnce(&settings);
+  EXPECT_EQ(slow.runs, 3);
+}
+
+TEST_F(SchedulerTest, RunsChangedTasksRightAway) {
+  scheduler.RunOnce(&settings);
+  clock.Increment(10);
+  settings.changed = true;
+
+  scheduler.RunOnce(&settings);
+  EXPECT_EQ(fast.runs, 2);
+  EXPECT_EQ(slow.runs, 1);
+  // The extra run isn't a late periodic run.
+  EXPECT_EQ(scheduler.task(0).jitter.runs(), 1);
+
+  // The period restarts from the extra run.
+  settings.changed = false;
+  clock.Increment(249);
+  scheduler.RunOnce(&settings);
+  EXPECT_EQ(fast.runs, 2);
+  clock.Increment(1);
+  scheduler.RunOnce(&settings);
+  EXPECT_EQ(fast.runs, 3);
+}
+
+TEST_F(SchedulerTest, TellsWhenTheNextTaskIsDue) {
+  scheduler.RunOnce(&settings);
+
+  EXPECT_EQ(scheduler.MicrosUntilDue(clock.Micros()), 250000);
+  clock.Increment(100);
+  EXPECT_EQ(scheduler.MicrosUntilDue(clock.Micros()), 150000);
+  clock.Increment(200);
+  EXPECT_EQ(scheduler.MicrosUntilDue(clock.Micros()), 0);
+}
+
+TEST_F(SchedulerTest, ReturnsTheFirstError) {
+  slow.status = Status::kPrimarySensorFail;
+  fast.status = Status::kSkipped;
+
+  EXPECT_EQ(scheduler.RunOnce(&settings), Status::kPrimarySensorFail);
+}
+
+}  // namespace
+}  // namespace thermostat
@@ -0,0 +1,131 @@
+#include <glog/logging.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <cmath>
+
+#include "mock_impls.h"
+#include "thermostat/comparison.h"
+#include "thermostat/thermostat_tasks.h"
+#include "thermostat/interfaces.h"
+#include "thermostat/settings.h"
+
+namespace thermostat {
+
+namespace t = testing;
+
+class SensorUpdatingThermostatTaskTest : public testing::Test {
+ public:
+  void SetUp() override {
+    clock.SetMillis(10000);
+    primary.SetTemperature(70.1);
+    primary.SetHumidity(40);
+
+    // Cover the default case of the wrapper RunOnce being called.
+    EXPECT_CALL(wrapper, RunOnce(t::_)).Times(t::AtLeast(0));
+    ON_CALL(wrapper, RunOnce(t::_)).WillByDefault(t::Return(Status::kOk));
+  }
+
+ protected:
+  Settings settings;
+  FakeClock clock;
+  FakePrint print;
+  FakeSensor primary;
+
+  MockThermostatTask wrapper;
+  SensorUpdatingThermostatTask task =
+      SensorUpdatingThermostatTask(&clock, &primary, &print, &wrapper);
+};
+
+TEST_F(SensorUpdatingThermostatTaskTest, FirstPassOnlyStartsRequest) {
+  primary.EnableAsyncAssert();
+
+  // Nothing has been read yet, so the layers above should skip.
+  EXPECT_EQ(task.RunOnce(&settings), Status::kSkipped);
+  EXPECT_EQ(settings.current_temperature_x10, 0);
+
+  // Still converting.
+  clock.Increment(kSensorSettleMillis - 1);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kSkipped);
+  EXPECT_EQ(settings.current_temperature_x10, 0);
+
+  // Collected once the conversion time passed.
+  clock.Increment(1);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.current_temperature_x10, 701);
+  EXPECT_EQ(settings.current_mean_temperature_x10, 701);
+  EXPECT_EQ(settings.current_humidity, 40);
+}
+
+TEST_F(SensorUpdatingThermostatTaskTest, KeepsPreviousValuesWhileConverting) {
+  primary.EnableAsyncAssert();
+
+  EXPECT_EQ(task.RunOnce(&settings), Status::kSkipped);
+  clock.Increment(kRunEveryMillis);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.current_temperature_x10, 701);
+
+  // An early pass (such as a settings change) shouldn't wait on the new reading.
+  primary.SetTemperature(72.0);
+  clock.Increment(10);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.current_temperature_x10, 701);
+
+  clock.Increment(kRunEveryMillis);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.current_temperature_x10, 720);
+}
+
+TEST_F(SensorUpdatingThermostatTaskTest, SensorFailure) {
+  EXPECT_EQ(task.RunOnce(&settings), Status::kSkipped);
+  clock.Increment(kRunEveryMillis);
+
+  primary.SetEndReadingResult(false);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kPrimarySensorFail);
+
+  // Recovers once the sensor does.
+  primary.SetEndReadingResult(true);
+  clock.Increment(kRunEveryMillis);
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.current_temperature_x10, 701);
+}
+
+TEST_F(SensorUpdatingThermostatTaskTest, WorstCaseLatency) {
+  // Every clock read costs 1ms, so any code spinning on the clock shows up as latency.
+  clock.SetAutoIncrement(1);
+
+  uint32_t worst_latency_ms = 0;
+  for (int i = 0; i < 1000; ++i) {
+    // Mix in early passes as happens when the settings change.
+    clock.Increment(i % 3 == 0 ? 5 : kRunEveryMillis);
+
+    const uint32_t start = clock.Millis();
+    task.RunOnce(&settings);
+    worst_latency_ms = cmax(worst_latency_ms, clock.millisSince(start));
+  }
+  LOG(INFO) << "Worst case RunOnce latency: " << worst_latency_ms << "ms";
+
+  // Only the clock reads themselves should be accounted for.
+  EXPECT_LE(worst_latency_ms, 3);
+}
+
+TEST(IaqUpdatingThermostatTaskTest, ScoresTheGasReading) {
+  Settings settings;
+  FakeSensor sensor;
+  t::NiceMock<MockThermostatTask> wrapper;
+  ON_CALL(wrapper, RunOnce(t::_)).WillByDefault(t::Return(Status::kOk));
+  IaqUpdatingThermostatTask task(&sensor, &wrapper);
+  settings.current_humidity = 45;
+
+  // No gas sensor, so the score is left alone.
+  settings.air_quality_score = 7;
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_EQ(settings.air_quality_score, 7);
+
+  sensor.SetHeaterValue(50000);
+  task.RunOnce(&settings);
+  EXPECT_EQ(settings.air_quality_score, CalculateIaqScore(45, 50000));
+}
+
+}  // namespace thermostat
@@ -24,13 +24,5 @@ TEST(SettingsTest, ClearOverrideTemp) {
   // TODO: Fill this in.
 }
 
-TEST(SettingsTest, SettingsPrevEventIndex) {
-  // TODO: Fill this in.
-}
-
-TEST(SettingsTest, SettingsCurrentEventIndex) {
-  // TODO: Fill this in.
-}
-
 }  // namespace
 }  // namespace thermostat
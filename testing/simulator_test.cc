@@ -0,0 +1,107 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "simulation/simulator.h"
+
+namespace thermostat {
+namespace simulation {
+namespace {
+
+constexpr uint64_t kTwoDaysSeconds = 2 * 24 * 60 * 60;
+
+TEST(BuildingModelTest, DriftsTowardsOutdoor) {
+  BuildingParameters params;
+  params.internal_gain_btu_per_hour = 0;
+  BuildingModel building(params, 70);
+
+  for (int i = 0; i < 60 * 60; ++i) {
+    building.Step(1.0, 30, EquipmentState());
+  }
+  EXPECT_LT(building.indoor_f(), 70);
+  EXPECT_GT(building.indoor_f(), 30);
+}
+
+TEST(BuildingModelTest, FurnaceHeats) {
+  BuildingParameters params;
+  BuildingModel building(params, 60);
+  EquipmentState equipment;
+  equipment.heat = true;
+
+  for (int i = 0; i < 60 * 60; ++i) {
+    building.Step(1.0, 30, equipment);
+  }
+  EXPECT_GT(building.indoor_f(), 60);
+}
+
+TEST(SimulatorTest, WinterHoldsHeatSetpoint) {
+  SimulationConfig config;
+  // Mid January.
+  config.start_day_of_year = 15;
+  config.persisted.heat_enabled = true;
+  config.persisted.cool_enabled = false;
+
+  Simulator simulator(config);
+  simulator.Run(kTwoDaysSeconds);
+
+  const SimulationReport& report = simulator.report();
+  LOG(INFO) << "heat hours: " << report.heat_hours << " cycles: " << report.heat_cycles
+            << " comfort error: " << report.comfort_error_degree_hours;
+  EXPECT_GT(report.heat_hours, 1);
+  EXPECT_EQ(report.cool_hours, 0);
+  EXPECT_GT(report.heat_cycles, 5);
+  // The room should stay close to the 68.5-69.5° setpoints.
+  EXPECT_GT(report.min_indoor_f, 66);
+  EXPECT_LT(report.max_indoor_f, 72);
+  EXPECT_LT(report.MeanComfortError(), 0.5);
+}
+
+TEST(SimulatorTest, SummerHoldsCoolSetpoint) {
+  SimulationConfig config;
+  // Late July.
+  config.start_day_of_year = 200;
+  config.initial_indoor_f = 76;
+  config.persisted.heat_enabled = false;
+  config.persisted.cool_enabled = true;
+  // Make sure the A/C needs to run.
+  config.weather.annual_mean_f = 60;
+
+  Simulator simulator(config);
+  simulator.Run(kTwoDaysSeconds);
+
+  const SimulationReport& report = simulator.report();
+  EXPECT_EQ(report.heat_hours, 0);
+  EXPECT_GT(report.cool_hours, 1);
+  EXPECT_GT(report.cool_cycles, 1);
+  EXPECT_LT(report.max_indoor_f, 80);
+  EXPECT_LT(report.MeanComfortError(), 0.5);
+}
+
+TEST(SimulatorTest, Deterministic) {
+  SimulationConfig config;
+  config.start_day_of_year = 40;
+
+  Simulator first(config);
+  first.Run(kTwoDaysSeconds / 4);
+  Simulator second(config);
+  second.Run(kTwoDaysSeconds / 4);
+
+  EXPECT_EQ(first.report().heat_cycles, second.report().heat_cycles);
+  EXPECT_DOUBLE_EQ(first.report().heat_hours, second.report().heat_hours);
+  EXPECT_DOUBLE_EQ(first.indoor_f(), second.indoor_f());
+}
+
+TEST(SimulatedClockTest, DateFollowsSimulatedTime) {
+  SimulatedClock clock(/*start_day_of_year=*/1.5);
+  EXPECT_EQ(clock.Now().hour, 12);
+  EXPECT_EQ(clock.Now().day_of_week, 1);
+
+  clock.Advance(90 * 60 * 1000);
+  EXPECT_EQ(clock.Now().hour, 13);
+  EXPECT_EQ(clock.Now().minute, 30);
+  EXPECT_EQ(clock.Millis(), 90u * 60 * 1000);
+}
+
+}  // namespace
+}  // namespace simulation
+}  // namespace thermostat
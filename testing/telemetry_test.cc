@@ -0,0 +1,179 @@
+#include <glog/logging.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "mock_impls.h"
+#include "thermostat/settings.h"
+#include "thermostat/telemetry.h"
+#include "thermostat/thermostat_tasks.h"
+
+namespace thermostat {
+namespace {
+
+namespace t = testing;
+
+// Keeps everything written to it.
+class CapturingPrint : public Print {
+ public:
+  void write(uint8_t ch) override { bytes.push_back(ch); };
+
+  std::vector<uint8_t> bytes;
+};
+
+// Splits the stream on the zero delimiters.
+std::vector<std::vector<uint8_t>> SplitFrames(const std::vector<uint8_t>& bytes) {
+  std::vector<std::vector<uint8_t>> frames(1);
+  for (const uint8_t byte : bytes) {
+    if (byte == 0) {
+      frames.emplace_back();
+    } else {
+      frames.back().push_back(byte);
+    }
+  }
+  // The stream ends with a delimiter.
+  EXPECT_TRUE(frames.back().empty());
+  frames.pop_back();
+  return frames;
+}
+
+TEST(CobsTest, RoundTrips) {
+  const uint8_t data[] = {0x00, 0x11, 0x00, 0x00, 0x22, 0x33, 0x00};
+  uint8_t encoded[sizeof(data) + 1];
+  uint8_t decoded[sizeof(data)];
+
+  const uint8_t length = CobsEncode(data, sizeof(data), encoded);
+  ASSERT_EQ(length, sizeof(data) + 1);
+  for (uint8_t i = 0; i < length; ++i) {
+    EXPECT_NE(encoded[i], 0);
+  }
+  ASSERT_EQ(CobsDecode(encoded, length, decoded, sizeof(decoded)), sizeof(data));
+  for (uint8_t i = 0; i < sizeof(data); ++i) {
+    EXPECT_EQ(decoded[i], data[i]);
+  }
+}
+
+TEST(CobsTest, RejectsMalformedFrames) {
+  uint8_t decoded[8];
+  // The block claims more bytes than the frame has.
+  const uint8_t truncated[] = {0x05, 0x11, 0x22};
+  EXPECT_EQ(CobsDecode(truncated, sizeof(truncated), decoded, sizeof(decoded)), 0);
+
+  // Doesn't fit in the output.
+  const uint8_t large[] = {0x0A, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  EXPECT_EQ(CobsDecode(large, sizeof(large), decoded, sizeof(decoded)), 0);
+}
+
+class TelemetryThermostatTaskTest : public t::Test {
+ public:
+  void SetUp() override {
+    ON_CALL(wrapper, RunOnce(t::_)).WillByDefault(t::Return(Status::kOk));
+
+    settings.now = 123456;
+    settings.current_temperature_x10 = 705;
+    settings.current_mean_temperature_x10 = -12;
+    settings.current_humidity = 45;
+    settings.hvac = HvacMode::HEAT;
+    settings.fan = FanMode::ON;
+    settings.heat_high = true;
+    settings.within_tolerance = false;
+    settings.min_free_memory_bytes = 1234;
+  }
+
+ protected:
+  Settings settings;
+  CapturingPrint print;
+  t::NiceMock<MockThermostatTask> wrapper;
+  TelemetryThermostatTask task = TelemetryThermostatTask(&print, &wrapper);
+};
+
+TEST_F(TelemetryThermostatTaskTest, WritesDecodableFrames) {
+  EXPECT_EQ(task.RunOnce(&settings), Status::kOk);
+  EXPECT_CALL(wrapper, RunOnce(t::_)).WillOnce(t::Return(Status::kPrimarySensorFail));
+  settings.now += 1500;
+  EXPECT_EQ(task.RunOnce(&settings), Status::kPrimarySensorFail);
+
+  const std::vector<std::vector<uint8_t>> frames = SplitFrames(print.bytes);
+  // The leading delimiter ends anything sent before the first frame.
+  ASSERT_EQ(frames.size(), 3);
+  EXPECT_TRUE(frames[0].empty());
+
+  TelemetryRecord record;
+  ASSERT_TRUE(DecodeTelemetryFrame(frames[1].data(), frames[1].size(), &record));
+  EXPECT_EQ(record.now_ms, 123456);
+  EXPECT_EQ(record.temperature_x10, 705);
+  EXPECT_EQ(record.mean_temperature_x10, -12);
+  EXPECT_EQ(record.humidity, 45);
+  EXPECT_EQ(static_cast<HvacMode>(record.modes & 0x0F), HvacMode::HEAT);
+  EXPECT_EQ(static_cast<FanMode>(record.modes >> 4), FanMode::ON);
+  EXPECT_EQ(static_cast<Status>(record.status), Status::kOk);
+  EXPECT_EQ(record.flags, kTelemetryHeatHigh);
+  EXPECT_EQ(record.min_free_memory_bytes, 1234);
+
+  ASSERT_TRUE(DecodeTelemetryFrame(frames[2].data(), frames[2].size(), &record));
+  EXPECT_EQ(record.now_ms, 123456 + 1500);
+  EXPECT_EQ(static_cast<Status>(record.status), Status::kPrimarySensorFail);
+}
+
+TEST_F(TelemetryThermostatTaskTest, RejectsDamagedFrames) {
+  task.RunOnce(&settings);
+  std::vector<std::vector<uint8_t>> frames = SplitFrames(print.bytes);
+  ASSERT_EQ(frames.size(), 2);
+
+  TelemetryRecord record;
+  std::vector<uint8_t> frame = frames[1];
+  frame[5] ^= 0x40;
+  EXPECT_FALSE(DecodeTelemetryFrame(frame.data(), frame.size(), &record));
+
+  frame = frames[1];
+  frame.pop_back();
+  EXPECT_FALSE(DecodeTelemetryFrame(frame.data(), frame.size(), &record));
+}
+
+// Counts the bytes written.
+class CountingPrint : public Print {
+ public:
+  void write(uint8_t ch) override { count++; };
+
+  uint32_t count = 0;
+};
+
+TEST(TelemetryTest, SerialBytesPerCycle) {
+  constexpr int kCycles = 100;
+  FakeClock clock;
+  Settings settings;
+  settings.persisted = DefaultPersistedSettings();
+  settings.current_temperature_x10 = 705;
+  settings.current_mean_temperature_x10 = 705;
+  settings.current_humidity = 45;
+
+  t::NiceMock<MockThermostatTask> wrapper;
+  ON_CALL(wrapper, RunOnce(t::_)).WillByDefault(t::Return(Status::kOk));
+
+  // The text logging of the previous default wiring.
+  CountingPrint text;
+  HvacControllerThermostatTask text_hvac(&clock, &text, &wrapper);
+  LoggingThermostatTask logging(&text, &text_hvac);
+
+  // The telemetry with the debugging text discarded.
+  CountingPrint binary;
+  NullPrint debug;
+  HvacControllerThermostatTask binary_hvac(&clock, &debug, &wrapper);
+  TelemetryThermostatTask telemetry(&binary, &binary_hvac);
+
+  for (int i = 0; i < kCycles; ++i) {
+    settings.now += kRunEveryMillis;
+    logging.RunOnce(&settings);
+    telemetry.RunOnce(&settings);
+  }
+
+  LOG(INFO) << "Bytes per cycle, text: " << text.count / kCycles
+            << " telemetry: " << binary.count / kCycles;
+  EXPECT_EQ(binary.count, kCycles * kTelemetryFrameSize + 1);
+  EXPECT_GE(text.count, binary.count * 5);
+}
+
+}  // namespace
+}  // namespace thermostat
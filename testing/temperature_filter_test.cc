@@ -0,0 +1,69 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "thermostat/temperature_filter.h"
+
+namespace thermostat {
+namespace {
+
+TEST(MovingAverageFilterTest, AveragesTheWindow) {
+  MovingAverageFilter<4> filter;
+
+  // The mean of what's there until the window fills.
+  EXPECT_EQ(filter.Add(700), 700);
+  EXPECT_EQ(filter.Add(710), 705);
+  EXPECT_EQ(filter.Add(720), 710);
+  EXPECT_EQ(filter.Add(730), 715);
+  // The oldest reading drops out.
+  EXPECT_EQ(filter.Add(740), 725);
+}
+
+TEST(ExponentialFilterTest, StartsFromTheFirstReading) {
+  ExponentialFilter<2> filter;
+
+  EXPECT_EQ(filter.Add(700), 700);
+  EXPECT_EQ(filter.Add(700), 700);
+}
+
+TEST(ExponentialFilterTest, MovesAQuarterOfTheWayEachReading) {
+  ExponentialFilter<2> filter;
+  filter.Add(700);
+
+  EXPECT_EQ(filter.Add(740), 710);
+  EXPECT_EQ(filter.Add(740), 718);
+  // The fraction below a tenth is kept, so the output still reaches the reading.
+  for (int i = 0; i < 40; ++i) {
+    filter.Add(740);
+  }
+  EXPECT_EQ(filter.Add(740), 740);
+}
+
+TEST(ExponentialFilterTest, HandlesBelowZero) {
+  ExponentialFilter<2> filter;
+  filter.Add(-100);
+
+  EXPECT_EQ(filter.Add(-140), -110);
+}
+
+TEST(MedianOf5FilterTest, IgnoresASpike) {
+  MedianOf5Filter filter;
+  for (int i = 0; i < 5; ++i) {
+    filter.Add(700);
+  }
+
+  EXPECT_EQ(filter.Add(900), 700);
+  EXPECT_EQ(filter.Add(701), 700);
+  EXPECT_EQ(filter.Add(702), 701);
+}
+
+TEST(MedianOf5FilterTest, UsesTheReadingsSoFar) {
+  MedianOf5Filter filter;
+
+  EXPECT_EQ(filter.Add(720), 720);
+  EXPECT_EQ(filter.Add(700), 720);
+  EXPECT_EQ(filter.Add(710), 710);
+}
+
+}  // namespace
+}  // namespace thermostat
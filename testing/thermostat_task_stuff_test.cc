@@ -5,6 +5,7 @@
 
 #include <cmath>
 
+#include "event_scans.h"
 #include "mock_impls.h"
 #include "thermostat/comparison.h"
 #include "thermostat/interfaces.h"
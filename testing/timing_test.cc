@@ -0,0 +1,148 @@
+#include <glog/logging.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "mock_impls.h"
+#include "thermostat/settings.h"
+#include "thermostat/timing.h"
+
+namespace thermostat {
+namespace {
+
+namespace t = testing;
+
+// Keeps everything written to it.
+class StringPrint : public Print {
+ public:
+  void write(uint8_t ch) override { text.push_back(ch); };
+
+  std::string text;
+};
+
+TEST(TimingStatsTest, Empty) {
+  TimingStats stats;
+  EXPECT_EQ(stats.count(), 0);
+  EXPECT_EQ(stats.min_us(), 0);
+  EXPECT_EQ(stats.max_us(), 0);
+  EXPECT_EQ(stats.mean_us(), 0);
+}
+
+TEST(TimingStatsTest, RecordsMinMaxMean) {
+  TimingStats stats;
+  stats.Record(100);
+  stats.Record(300);
+  stats.Record(20);
+
+  EXPECT_EQ(stats.count(), 3);
+  EXPECT_EQ(stats.min_us(), 20);
+  EXPECT_EQ(stats.max_us(), 300);
+  EXPECT_EQ(stats.mean_us(), 140);
+}
+
+TEST(TimingStatsTest, Log2Buckets) {
+  EXPECT_EQ(TimingStats::Bucket(0), 0);
+  EXPECT_EQ(TimingStats::Bucket(1), 0);
+  EXPECT_EQ(TimingStats::Bucket(2), 1);
+  EXPECT_EQ(TimingStats::Bucket(3), 1);
+  EXPECT_EQ(TimingStats::Bucket(1000), 9);
+  EXPECT_EQ(TimingStats::Bucket(32767), 14);
+  EXPECT_EQ(TimingStats::Bucket(32768), 15);
+  EXPECT_EQ(TimingStats::Bucket(0xFFFFFFFF), 15);
+
+  TimingStats stats;
+  stats.Record(1000);
+  stats.Record(1023);
+  stats.Record(5);
+  EXPECT_EQ(stats.bucket(9), 2);
+  EXPECT_EQ(stats.bucket(2), 1);
+}
+
+TEST(TimingStatsTest, HalvesInsteadOfOverflowing) {
+  TimingStats stats;
+  for (uint32_t i = 0; i < 100000; ++i) {
+    stats.Record(50000);
+  }
+  EXPECT_LT(stats.count(), 0xFFFF);
+  EXPECT_EQ(stats.mean_us(), 50000);
+  // The histogram saturates.
+  EXPECT_EQ(stats.bucket(15), 0xFFFF);
+}
+
+class TimingThermostatTaskTest : public t::Test {
+ public:
+  void SetUp() override {
+    // The inner layer takes 2ms and the outer one 1ms on top of it.
+    ON_CALL(inner, RunOnce(t::_)).WillByDefault(t::Invoke([this](Settings*) {
+      clock.Increment(2);
+      return Status::kOk;
+    }));
+    ON_CALL(outer, RunOnce(t::_)).WillByDefault(t::Invoke([this](Settings* settings) {
+      clock.Increment(1);
+      return inner_timing.RunOnce(settings);
+    }));
+  }
+
+ protected:
+  Settings settings;
+  FakeClock clock;
+  StringPrint print;
+  t::NiceMock<MockThermostatTask> inner;
+  t::NiceMock<MockThermostatTask> outer;
+  TimingThermostatTask inner_timing = TimingThermostatTask(&clock, "Inner", &inner);
+  TimingThermostatTask outer_timing = TimingThermostatTask(&clock, "Outer", &outer);
+  TimingThermostatTask* const layers[2] = {&inner_timing, &outer_timing};
+  Timings timings = Timings(&clock, &print, layers, 2);
+};
+
+TEST_F(TimingThermostatTaskTest, TimesWrappedLayers) {
+  EXPECT_CALL(inner, RunOnce(t::_))
+      .WillOnce(t::Return(Status::kSkipped))
+      .WillRepeatedly(t::DoDefault());
+  EXPECT_EQ(inner_timing.RunOnce(&settings), Status::kSkipped);
+  EXPECT_EQ(inner_timing.stats().max_us(), 0);
+
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(outer_timing.RunOnce(&settings), Status::kOk);
+  }
+  EXPECT_EQ(outer_timing.stats().count(), 3);
+  EXPECT_EQ(outer_timing.stats().mean_us(), 3000);
+  EXPECT_EQ(inner_timing.stats().count(), 4);
+  EXPECT_EQ(inner_timing.stats().max_us(), 2000);
+
+  // The outer layer itself takes 1ms of the 3ms.
+  EXPECT_EQ(timings.SelfMeanMicros(1), 3000 - inner_timing.stats().mean_us());
+}
+
+TEST_F(TimingThermostatTaskTest, TimesLoop) {
+  for (int i = 0; i < 4; ++i) {
+    timings.Poll();
+    outer_timing.RunOnce(&settings);
+  }
+  // Three periods between the four polls.
+  EXPECT_EQ(timings.loop().count(), 3);
+  EXPECT_EQ(timings.loop().mean_us(), 3000);
+
+  timings.Reset();
+  EXPECT_EQ(timings.loop().count(), 0);
+  EXPECT_EQ(outer_timing.stats().count(), 0);
+}
+
+TEST_F(TimingThermostatTaskTest, Dump) {
+  timings.Poll();
+  outer_timing.RunOnce(&settings);
+  timings.Poll();
+  timings.Dump();
+
+  EXPECT_EQ(print.text,
+            std::string("name count min mean max self 2^0..2^15us\r\n"
+                        "loop 1 3000 3000 3000 3000 0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0\r\n"
+                        "Inner 1 2000 2000 2000 2000 0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0\r\n"
+                        "Outer 1 3000 3000 3000 1000 0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0\r\n") +
+                '\0');
+}
+
+}  // namespace
+}  // namespace thermostat
@@ -2,10 +2,14 @@
 #ifndef AVR_IMPLS_H_
 #define AVR_IMPLS_H_
 
+#include <avr/sleep.h>
 #include <LiquidCrystal.h>
 #include <Adafruit_BME680.h>
 #include <DallasTemperature.h>
+#include "comparison.h"
+#include "ds18b20.h"
 #include "interfaces.h"
+#include "memory_monitor.h"
 #include "uRTCLib.h"
 #include "print.h"
 #include "DHT.h"
@@ -19,18 +23,18 @@ class CannedSensor : public Sensor {
     CannedSensor(Print *print) : print_(print) {};
     void SetUp() {};
     void StartRequestAsync() override {};
-    float GetTemperature() override {
-      if (temp_ > 85.0 || temp_ < 60.0) {
-        temp_ = 60.0;
+    int16_t GetTemperatureX10() override {
+      if (temperature_x10_ > 850 || temperature_x10_ < 600) {
+        temperature_x10_ = 600;
       }
-      temp_ += .1;
-      return temp_;
+      temperature_x10_ += 1;
+      return temperature_x10_;
     };
-    float GetHumidity() override {
-      return temp_;
+    uint8_t GetHumidity() override {
+      return temperature_x10_ / 10;
     }
   private:
-    float temp_;
+    int16_t temperature_x10_ = 600;
     Print *print_;
 };
 
@@ -108,40 +112,19 @@ class CannedDisplay : public Display {
 
 #endif
 
-class DallasSensor : public Sensor {
-  static constexpr uint8_t kOneWirePin = 33; 
+// The DS18B20 on the OneWire bus. Lower resolutions trade accuracy for a shorter
+// conversion, from 750ms at 12 bits down to 94ms at 9 bits.
+class DallasSensor : public Ds18b20<DallasTemperature> {
+  static constexpr uint8_t kOneWirePin = 33;
   public:
-    DallasSensor(Print *print) : print_(print) {
-      sensor_.begin();
-
-      // We only have one dallas temperature sensor on the bus. Store this to avoid needing to
-      // scan the bus on each read.
-      sensor_.getAddress(temperature_address_, static_cast<uint8_t>(0));
-
-      // When requesting a conversion, don't wait for the data, we'll collect the metrics
-      // later.
-      sensor_.setWaitForConversion(false);
-    };
-    // TODO: Finish filling this in.
-    void StartRequestAsync() override {
-      sensor_.requestTemperatures();
-    };
-    float GetTemperature() override {
-      return sensor_.getTempF(temperature_address_);
-    };
-    void EnableGasHeater(const bool ) override { };
-    uint32_t GetGasResistance() override {
-      return 0;
-    };
+    // The base only stores the bus pointer when constructed, so the bus can be
+    // constructed after it.
+    DallasSensor(Clock *clock, const Ds18b20Resolution resolution) :
+      Ds18b20<DallasTemperature>(&bus_, clock, resolution) {};
 
   private:
-    DeviceAddress temperature_address_;
-    OneWire temperature_one_wire_ = OneWire(kOneWirePin);
-
-    DallasTemperature sensor_ = DallasTemperature(&temperature_one_wire_);
-    Print *print_;
-
-
+    OneWire one_wire_ = OneWire(kOneWirePin);
+    DallasTemperature bus_ = DallasTemperature(&one_wire_);
 };
 
 
@@ -213,35 +196,43 @@ class Dht22Sensor: public Sensor {
 
     void SetUp() override {
       dht_.begin();
-      temperature_ = dht_.readTemperature(true);
-      humidity_ = dht_.readHumidity();
-    };
-    void StartRequestAsync() override {
-      // Compute heat index in Fahrenheit (the default)
-      //float hif = dht_.computeHeatIndex(f, h);
     };
 
-    float GetHumidity() override {
-      humidity_ = dht_.readHumidity();
-      
-      print_->print("Feel: ");
-      print_->print(dht_.computeHeatIndex(temperature_,humidity_));
-      print_->print("F\r\n");
-      return dht_.readHumidity();
-    }
+    // The DHT22 has no asynchronous mode, the single wire transfer is bit-banged when the
+    // values are read. Read once per collection so the getters never touch the bus.
+    //
+    // The DHT library only reports floats, so they are converted to integers here once
+    // per reading.
+    //
+    // Returns false when this transfer failed, such as a bad checksum or no response, so
+    // the FusedSensor ages the reading out. The getters keep the last good values.
+    bool EndReading() override {
+      const float temperature = dht_.readTemperature(true);
+      const float humidity = dht_.readHumidity();
 
-    float GetTemperature() override {
-      temperature_ = dht_.readTemperature(true);
+      if (isnan(temperature) || isnan(humidity)) {
+        print_->print("DHT22: failed\r\n");
+        return false;
+      }
+      temperature_x10_ = cmax(cmin(static_cast<int16_t>(temperature * 10), 999), -200);
+      humidity_ = humidity;
       print_->print("DHT22: ");
-      print_->print(temperature_);
+      print_->print(temperature_x10_);
       print_->print("F\r\n");
-      return fmax(fmin(temperature_, 99.9), -20.0);
-      //return fmin(fmax(temperature_, 99.9), -17.7) * 1.8 + 32.0;
+      return true;
+    }
+
+    uint8_t GetHumidity() override {
+      return humidity_;
+    }
+
+    int16_t GetTemperatureX10() override {
+      return temperature_x10_;
     };
   private:
     DHT dht_;
-    float humidity_;
-    float temperature_;
+    uint8_t humidity_ = 0;
+    int16_t temperature_x10_ = 0;
     Print *print_;
     static constexpr int ON = LOW;
     static constexpr int OFF = HIGH;
@@ -270,10 +261,12 @@ class BmeSensor : public Sensor {
     bool EndReading() override {
       return bme_.endReading();
     }
-    float GetHumidity() override {
+    // The Adafruit library only reports the temperature and humidity as floats, so these
+    // convert once per reading.
+    uint8_t GetHumidity() override {
       return bme_.humidity;
     }
-    float GetPressure() override {
+    uint32_t GetPressure() override {
       return bme_.pressure;
     }
 
@@ -294,8 +287,8 @@ class BmeSensor : public Sensor {
     void StartRequestAsync() override {
       bme_.beginReading();
     };
-    float GetTemperature() override {
-      return bme_.temperature * 1.8 + 32.0;
+    int16_t GetTemperatureX10() override {
+      return bme_.temperature * 18 + 320;
     };
 
   private:
@@ -312,6 +305,10 @@ class RealClock : public Clock {
       return millis();
     };
 
+    uint32_t Micros() const override {
+      return micros();
+    };
+
     static Date SanitizeDate(Date date) {
       if (date.hour >= 24) {
         date.hour = 0;
@@ -346,6 +343,54 @@ class RealClock : public Clock {
 
 };
 
+// Idles the CPU between the main loop passes. The timers, ADC and Serial keep running in
+// the idle mode, and the Timer0 interrupts wake it every millisecond to check the time.
+class IdleSleeper : public Sleeper {
+  public:
+    void Sleep(const uint32_t duration_us) override {
+      const uint32_t start = micros();
+      set_sleep_mode(SLEEP_MODE_IDLE);
+      // An interrupt between the check and the sleep only delays the wake up until the
+      // next Timer0 tick.
+      while (micros() - start < duration_us) {
+        sleep_mode();
+      }
+    }
+};
+
+// The end of the static data, where the heap starts, and the top of the heap, which stays
+// null until the first malloc.
+extern "C" char __heap_start;
+extern "C" char* __brkval;
+
+// Paints the free RAM right after the stack pointer is set up, before the static data is
+// copied in and the constructors run, so even their stack use is counted. The section
+// falls through to the next one, so this is never called and has nothing on the stack.
+static void PaintStack() __attribute__((naked, used, section(".init3")));
+static void PaintStack() {
+  PaintMemory(reinterpret_cast<uint8_t*>(&__heap_start), reinterpret_cast<uint8_t*>(SP));
+}
+
+class AvrMemory : public Memory {
+  public:
+    uint16_t FreeBytes() override {
+      // A local is at about the stack pointer.
+      uint8_t top;
+      return &top - HeapTop();
+    }
+
+    // Scans up from the heap to the first byte the stack has written, which takes about
+    // 1ms per KB free.
+    uint16_t MinFreeBytes() override {
+      return CountPainted(HeapTop(), reinterpret_cast<const uint8_t*>(SP));
+    }
+
+  private:
+    static uint8_t* HeapTop() {
+      return reinterpret_cast<uint8_t*>(__brkval == nullptr ? &__heap_start : __brkval);
+    }
+};
+
 class SsdRelays: public Relays {
   public:
     void SetUp() {
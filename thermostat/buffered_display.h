@@ -0,0 +1,85 @@
+#ifndef BUFFERED_DISPLAY_H_
+#define BUFFERED_DISPLAY_H_
+// Display decorator which keeps a shadow copy of the 1602 LCD contents and only sends the
+// changed characters to the real display.
+//
+// Every character on the LiquidCrystal 4-bit bus takes 40+ us, and the status line and
+// menus rewrite the same text every loop. Writes only update the framebuffer here, and
+// Flush() sends the cells that changed since the last flush, moving the cursor only when
+// a run of changed cells is broken.
+
+#include "interfaces.h"
+
+namespace thermostat {
+
+class BufferedDisplay : public Display {
+  public:
+    static constexpr uint8_t kColumns = 16;
+    static constexpr uint8_t kRows = 2;
+
+    explicit BufferedDisplay(Display* const display) : display_(display) {
+      // The LCD starts out cleared.
+      for (uint8_t row = 0; row < kRows; ++row) {
+        for (uint8_t column = 0; column < kColumns; ++column) {
+          cells_[row][column] = ' ';
+        }
+      }
+    }
+
+    void write(const uint8_t ch) override {
+      // Like the LCD, text past the end of the row isn't visible.
+      if (column_ >= kColumns || row_ >= kRows) {
+        return;
+      }
+      if (cells_[row_][column_] != ch) {
+        cells_[row_][column_] = ch;
+        dirty_[row_] |= static_cast<uint16_t>(1) << column_;
+      }
+      ++column_;
+    }
+
+    void SetCursor(const int column, const int row) override {
+      column_ = column;
+      row_ = row;
+    }
+
+    // Sends the changed cells to the display. This should be called once per loop.
+    void Flush() {
+      for (uint8_t row = 0; row < kRows; ++row) {
+        if (dirty_[row] == 0) {
+          continue;
+        }
+        // Where the display's cursor is after the previous write in this row.
+        uint8_t cursor = kColumns;
+        for (uint8_t column = 0; column < kColumns; ++column) {
+          if ((dirty_[row] & (static_cast<uint16_t>(1) << column)) == 0) {
+            continue;
+          }
+          if (cursor != column) {
+            display_->SetCursor(column, row);
+          }
+          display_->write(cells_[row][column]);
+          cursor = column + 1;
+        }
+        dirty_[row] = 0;
+      }
+    }
+
+    // Returns the buffered character, mainly for testing.
+    uint8_t GetChar(const uint8_t row, const uint8_t column) const {
+      return cells_[row][column];
+    }
+
+  private:
+    Display* const display_;
+
+    uint8_t cells_[kRows][kColumns];
+    // Bit per column of the cells changed since the last flush.
+    uint16_t dirty_[kRows] = {0, 0};
+
+    uint8_t column_ = 0;
+    uint8_t row_ = 0;
+};
+
+}  // namespace thermostat
+#endif  // BUFFERED_DISPLAY_H_
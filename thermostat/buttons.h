@@ -11,6 +11,9 @@ enum class Button { NONE, SELECT, RIGHT, LEFT, UP, DOWN, TIMEOUT };
 // Helper for managing the 1602 shield analog buttons. This performs button debouncing and
 // enables two levels of automatic button presses when a button is held longer than a few
 // seconds to allow quicker cycling through the values.
+//
+// The debouncing and auto-press state is per instance so that each set of buttons (and
+// each thermostat in a host process) is tracked independently.
 class Buttons {
   public:
     // Returns the button associated with the analog input specified based on the resistive level.
@@ -34,55 +37,52 @@ class Buttons {
     }
 
     // Stabilizes the current pressed button with a debouncing window.
-    static Button StabilizedButtonPressed(const Button button) {
-      static Button window[3];
-      static int8_t index = 0;
-      static Button active = Button::NONE;
-
+    Button StabilizedButtonPressed(const Button button) {
       // Round robin through the debouncing window .
-      index = (index + 1) % 3;
-      window[index] = button;
+      window_index_ = (window_index_ + 1) % 3;
+      window_[window_index_] = button;
 
       // When all the hysteresis values align, we record the press.
-      if (window[0] != window[1]) {
-        return active;
+      if (window_[0] != window_[1]) {
+        return stabilized_;
       }
-      if (window[1] != window[2]) {
-        return active;
+      if (window_[1] != window_[2]) {
+        return stabilized_;
       }
 
-      if (window[0] != active) {
-        active = window[0];
+      if (window_[0] != stabilized_) {
+        stabilized_ = window_[0];
       }
 
-      return active;
+      return stabilized_;
     }
 
     // Returns a single press event per button down and starts 4Hz auto-presses after
     // holding 1 second and excalates to 40Hz auto-presses after 5 seconds.
     //
     // The user specified button argument should be stabilized with hysteresis.
-    static Button GetSinglePress(const Button button, const uint32_t now) {
-      static Button active = Button::NONE;
-      static uint32_t started_at_ms = now;
-      static uint32_t held_counter = 0;
-
+    Button GetSinglePress(const Button button, const uint32_t now) {
       // The active button has changed.
-      if (button != active) {
-        started_at_ms = now;
-        held_counter = 0;
-        active = button;
-        return active;
+      if (button != active_) {
+        started_at_ms_ = now;
+        held_counter_ = 0;
+        active_ = button;
+        return active_;
+      }
+
+      // Nothing held, so there is nothing to auto-press.
+      if (active_ == Button::NONE) {
+        return Button::NONE;
       }
 
       // Return a button press at 40Hz it's held after 5 seconds.
-      const uint32_t fourth_counts = Clock::MillisDiff(started_at_ms, now) / 250;
+      const uint32_t fourth_counts = Clock::MillisDiff(started_at_ms_, now) / 250;
       // Auto press at a 25ms rate after holding for 5 seconds.
       if (fourth_counts >= 4 /*counts per second*/ * 5) {
-        const uint32_t fortieth_counts = Clock::MillisDiff(started_at_ms, now) / 25;
-        if (fortieth_counts > held_counter) {
-          held_counter = fortieth_counts;
-          return active;
+        const uint32_t fortieth_counts = Clock::MillisDiff(started_at_ms_, now) / 25;
+        if (fortieth_counts > held_counter_) {
+          held_counter_ = fortieth_counts;
+          return active_;
         }
         // Return, we shouldn't fall into the slower auto-press mode.
         return Button::NONE;
@@ -90,9 +90,9 @@ class Buttons {
 
       // Auto press at 4 Hz after holding for 1 second.
       if (fourth_counts >= 4 /*counts per second*/ * 1) {
-        if (fourth_counts > held_counter) {
-          held_counter = fourth_counts;
-          return active;
+        if (fourth_counts > held_counter_) {
+          held_counter_ = fourth_counts;
+          return active_;
         }
         return Button::NONE;
       }
@@ -118,6 +118,46 @@ class Buttons {
       }
     }
 
+  private:
+    // StabilizedButtonPressed debouncing window.
+    Button window_[3] = {Button::NONE, Button::NONE, Button::NONE};
+    int8_t window_index_ = 0;
+    Button stabilized_ = Button::NONE;
+
+    // GetSinglePress auto-press tracking.
+    Button active_ = Button::NONE;
+    uint32_t started_at_ms_ = 0;
+    uint32_t held_counter_ = 0;
+};
+
+// Runs the debouncing and auto-presses on analog readings taken at a fixed rate, such as
+// by the ADC interrupt. The time comes from counting the readings rather than from when
+// the main loop gets to them, so a press is seen after the same number of readings
+// whatever the thermostat tasks are doing.
+class SampledButtons {
+  public:
+    explicit SampledButtons(const uint16_t sample_period_us) :
+      sample_period_us_(sample_period_us) {};
+
+    // Takes the next reading. Returns a press as GetSinglePress does.
+    Button Add(const int16_t analog_value) {
+      remainder_us_ += sample_period_us_;
+      now_ms_ += remainder_us_ / 1000;
+      remainder_us_ %= 1000;
+      return buttons_.GetSinglePress(buttons_.StabilizedButtonPressed(Buttons::GetButton(analog_value)),
+                                     now_ms_);
+    }
+
+    // Milliseconds of readings taken so far.
+    uint32_t now_ms() const {
+      return now_ms_;
+    }
+
+  private:
+    const uint16_t sample_period_us_;
+    Buttons buttons_;
+    uint32_t now_ms_ = 0;
+    uint16_t remainder_us_ = 0;
 };
 
 }
@@ -3,41 +3,71 @@
 #define CALCULATE_IAQ_SCORE_H_
 
 #include "comparison.h"
+#include "progmem.h"
 
 namespace thermostat {
 
+// The gas score 100 * log10(R / 5000) in Q8 (x256) for R = 5000 + i * 1024 ohms, covering
+// the 5000 - 50000 ohm range used for the score. Linear interpolation between the entries
+// is within 0.25 of the exact score.
+constexpr uint8_t kGasScoreShift = 10;
+static const uint16_t kGasScoreQ8[] PROGMEM = {
+  0, 2071, 3817, 5325, 6653, 7839, 8911, 9888, 10786,
+  11617, 12391, 13114, 13793, 14432, 15037, 15611, 16157, 16677,
+  17173, 17649, 18105, 18543, 18965, 19371, 19762, 20141, 20507,
+  20861, 21204, 21538, 21861, 22175, 22481, 22778, 23068, 23350,
+  23625, 23894, 24156, 24413, 24663, 24908, 25148, 25383, 25612,
+};
+
 // I hand rolled this implementation, but I am aware of another IAQ implementation at
 // https://github.com/G6EJD/BME680-Example that this could be compared against.
-float CalculateIaqScore(const float bme680_humidity, const uint32_t bme680_resistance) {
+//
+// Fixed point version without any floating point, which the AVR only has as slow
+// software routines. Takes the humidity in Q8 (RH% * 256) and returns the score in Q8,
+// where 100 = excellent and 0 = bad air quality. Within 0.5 of the floating point score.
+//
+// A humidity reading above 100% is scored as 100%.
+static int16_t CalculateIaqScoreQ8(const uint16_t humidity_q8, const uint32_t resistance) {
   // The ideal relative humidity for health and comfort is about 40–50%
   //
   // Shift the gas humidity of 45% to be the zero point, and calculate how far away from
-  // that we are for the quality.
-  float shifted_gas_humidity = abs(bme680_humidity - 45);
+  // that we are for the quality. Clamping to 100% keeps the scaling below within the 16
+  // bit int of the AVR.
+  const uint16_t clamped_humidity_q8 = cmin(humidity_q8, static_cast<uint16_t>(100 * 256));
+  int16_t shifted_humidity_q8 = clamped_humidity_q8 - 45 * 256;
+  if (shifted_humidity_q8 < 0) {
+    shifted_humidity_q8 = -shifted_humidity_q8;
+  }
 
   // Next, subtract 5 for the ideal range being 45-5 45+5. Therefore 0 = ideal, and +40 to
   // +50 is the worst depending on low humidity or high humidity.
-  shifted_gas_humidity = shifted_gas_humidity - 5;
+  shifted_humidity_q8 -= 5 * 256;
 
   // Invert and scale so 100 = ideal air quality, and 0 = worst air quality.
-  const float humidity_quality = 100 - (shifted_gas_humidity * 2);
-
-  // Get a bounded gas resisance from the sensor.
-  float gas_resistance = cmin(cmax(bme680_resistance, 5000UL /*bad air quality*/),
-                              50000UL /*excellent air quality*/);
+  const int16_t humidity_quality_q8 = 100 * 256 - shifted_humidity_q8 * 2;
 
-  // The gas resistance is now in the range 3.69 - 4.69 and by subtracting 3.69, we're now
-  // in the range of 0-1 where 0 is bad, and 1 is excellent air quality.
-  gas_resistance = log10(gas_resistance) - log10(5000);
+  // Get a bounded gas resisance from the sensor, as an offset into the log table.
+  const uint16_t offset = cmin(cmax(resistance, 5000UL /*bad air quality*/),
+                               50000UL /*excellent air quality*/) - 5000;
 
-  // Scale by 100, so 0 = bad and 100 = excellent.
-  gas_resistance = gas_resistance * 100.0;
+  // Interpolate the log table, 0 = bad and 100 = excellent.
+  const uint8_t index = offset >> kGasScoreShift;
+  const uint16_t fraction = offset & ((1 << kGasScoreShift) - 1);
+  const uint16_t low = pgm_read_word(&kGasScoreQ8[index]);
+  const uint16_t high = pgm_read_word(&kGasScoreQ8[index + 1]);
+  const int16_t gas_quality_q8 =
+    low + ((static_cast<uint32_t>(high - low) * fraction) >> kGasScoreShift);
 
   // Returns the Indoor Air Quality partially based on resistance (volatiles) and humidity
-  // (RH%). Returns a value of 100 = excellent, and 0 = bad.
-  constexpr float resistance_weight = 0.75;
-  constexpr float humidity_weight = (1.0 - resistance_weight);
-  return (resistance_weight * gas_resistance) + humidity_weight * humidity_quality;
+  // (RH%), weighted 3/4 and 1/4.
+  return gas_quality_q8 - gas_quality_q8 / 4 + humidity_quality_q8 / 4;
+}
+
+// Returns the rounded score from 0 = bad to 100 = excellent for the humidity in RH%.
+static uint8_t CalculateIaqScore(const uint8_t humidity, const uint32_t resistance) {
+  const int16_t score_q8 = CalculateIaqScoreQ8(static_cast<uint16_t>(humidity) << 8,
+                                               resistance);
+  return cmin(cmax((score_q8 + 128) >> 8, 0), 100);
 }
 
 }
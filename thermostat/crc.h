@@ -0,0 +1,30 @@
+#ifndef CRC_H_
+#define CRC_H_
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF) used to validate records
+// stored in EEPROM.
+
+#include "interfaces.h"
+
+namespace thermostat {
+
+constexpr uint16_t kCrc16Init = 0xFFFF;
+
+// Adds a byte to the running crc. Bitwise, since a 512 byte table would take a quarter
+// of the RAM.
+static uint16_t Crc16Update(uint16_t crc, const uint8_t data) {
+  crc ^= static_cast<uint16_t>(data) << 8;
+  for (uint8_t bit = 0; bit < 8; ++bit) {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+static uint16_t Crc16(const uint8_t* data, uint16_t length, uint16_t crc = kCrc16Init) {
+  while (length-- > 0) {
+    crc = Crc16Update(crc, *data++);
+  }
+  return crc;
+}
+
+}  // namespace thermostat
+#endif  // CRC_H_
@@ -0,0 +1,117 @@
+#ifndef DS18B20_H_
+#define DS18B20_H_
+// Non-blocking DS18B20 temperature sensor driver.
+//
+// A conversion takes from 94ms at 9 bits up to 750ms at 12 bits, during which the sensor
+// can't be read. The driver issues the conversion and returns right away, only reads the
+// scratchpad once the conversion time for the resolution passed, and keeps the last valid
+// reading with when it was taken. The getters return that reading without touching the
+// bus, so the OneWire traffic is one read per conversion however often they're called.
+
+#include "interfaces.h"
+
+namespace thermostat {
+
+// The bits of resolution, from 0.5°C to 0.0625°C.
+enum class Ds18b20Resolution : uint8_t { k9Bit = 9, k10Bit = 10, k11Bit = 11, k12Bit = 12 };
+
+// The datasheet maximum conversion time, rounded up: 94, 188, 375 and 750ms.
+constexpr uint16_t Ds18b20ConversionMillis(const Ds18b20Resolution resolution) {
+  return (750 + (1 << (12 - static_cast<uint8_t>(resolution))) - 1) >>
+         (12 - static_cast<uint8_t>(resolution));
+}
+
+// The Bus has the DallasTemperature interface, with the raw readings in 1/128°C. Only the
+// first sensor on the bus is used.
+template <typename Bus>
+class Ds18b20 : public Sensor {
+  public:
+    // What the bus reads when the sensor didn't answer, DEVICE_DISCONNECTED_RAW.
+    static constexpr int16_t kDisconnectedRaw = -7040;
+
+    Ds18b20(Bus* const bus, Clock* const clock, const Ds18b20Resolution resolution) :
+      bus_(bus),
+      clock_(clock),
+      resolution_(resolution) {};
+
+    void SetUp() override {
+      bus_->begin();
+      // Store the address to avoid scanning the bus on each read.
+      found_ = bus_->getAddress(address_, static_cast<uint8_t>(0));
+      // Return from the requests right away, the conversion time is tracked here.
+      bus_->setWaitForConversion(false);
+      if (found_) {
+        bus_->setResolution(address_, static_cast<uint8_t>(resolution_));
+      }
+    }
+
+    // Starts a conversion, unless one is still running.
+    void StartRequestAsync() override {
+      Collect();
+      if (converting_ || !found_) {
+        return;
+      }
+      bus_->requestTemperaturesByAddress(address_);
+      requested_ms_ = clock_->Millis();
+      converting_ = true;
+    }
+
+    // Collects a finished conversion. Returns whether the last conversion gave a valid
+    // reading, which is still the case while the next one is running. After a failed
+    // conversion the getters keep returning the last valid reading, and the caller, such
+    // as a FusedSensor, decides how long to trust it.
+    bool EndReading() override {
+      Collect();
+      return valid_;
+    }
+
+    int16_t GetTemperatureX10() override {
+      // Raw readings are in 1/128 °C, and 1/128 °C = 9/64 °F x10.
+      return static_cast<int32_t>(raw_) * 9 / 64 + 320;
+    }
+
+    // Whether the last conversion gave a valid reading.
+    bool valid() const {
+      return valid_;
+    }
+
+    // When the conversion of the current reading finished, from Clock::Millis().
+    uint32_t reading_ms() const {
+      return reading_ms_;
+    }
+
+  private:
+    void Collect() {
+      if (!converting_ ||
+          clock_->millisSince(requested_ms_) < Ds18b20ConversionMillis(resolution_)) {
+        return;
+      }
+      converting_ = false;
+
+      const int16_t raw = bus_->getTemp(address_);
+      if (raw == kDisconnectedRaw) {
+        valid_ = false;
+        return;
+      }
+      // The bits below the resolution are undefined, so clear them.
+      raw_ = raw & ~((1 << (12 - static_cast<uint8_t>(resolution_) + 3)) - 1);
+      reading_ms_ = requested_ms_ + Ds18b20ConversionMillis(resolution_);
+      valid_ = true;
+    }
+
+    Bus* const bus_;
+    Clock* const clock_;
+    const Ds18b20Resolution resolution_;
+
+    uint8_t address_[8] = {0};
+    bool found_ = false;
+    bool converting_ = false;
+    uint32_t requested_ms_ = 0;
+
+    bool valid_ = false;
+    int16_t raw_ = 0;
+    uint32_t reading_ms_ = 0;
+};
+
+}  // namespace thermostat
+#endif  // DS18B20_H_
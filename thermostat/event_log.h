@@ -0,0 +1,225 @@
+#ifndef EVENT_LOG_H_
+#define EVENT_LOG_H_
+// Compact history of the hvac and fan changes used for the runtime statistics and the
+// heat/cool lockout.
+
+#include "interfaces.h"
+
+namespace thermostat {
+
+enum class HvacMode : uint8_t {EMPTY, IDLE, HEAT, COOL, HEAT_LOCKOUT, COOL_LOCKOUT};
+enum class FanMode : uint8_t {EMPTY, ON, OFF};
+
+// Marks a packed event without a 10 minute heat rise.
+constexpr int8_t kNoHeatRise = -128;
+
+// The longest time between two events that the packed format can store. Longer events
+// get split by the HistoryUpdatingThermostatTask.
+constexpr uint32_t kMaxEventMillis = 0xFFFFUL * 1000;
+
+// Unpacked copy of an event.
+struct Event {
+  bool empty() const {
+    return hvac == HvacMode::EMPTY && fan == FanMode::EMPTY;
+  }
+
+  HvacMode hvac = HvacMode::EMPTY;
+  FanMode fan = FanMode::EMPTY;
+
+  // The temperature when the event occurred.
+  int16_t temperature_x10 = 0;
+  // The temperature after heating for 10 minutes, 0 when not available.
+  int16_t temperature_10min_x10 = 0;
+  uint32_t start_time = 0;
+};
+
+// How an event is stored, 5 bytes instead of the 12 an Event takes on AVR.
+struct PackedEvent {
+  // Seconds since the previous event started.
+  uint16_t start_delta_s;
+  // HvacMode in the low nibble and FanMode in the high nibble.
+  uint8_t modes;
+  // Start temperature relative to the previous event's, saturated to +/-12.7°.
+  int8_t temperature_delta_x10;
+  // Temperature rise after heating for 10 minutes or kNoHeatRise.
+  int8_t heat_rise_x10;
+} __attribute__((packed));
+
+static int8_t SaturateInt8(const int16_t value) {
+  if (value > 127) {
+    return 127;
+  }
+  if (value < -127) {
+    return -127;
+  }
+  return value;
+}
+
+// Ring buffer of the last N events, addressed by age where 0 is the newest (still open)
+// event. Only the newest start time and temperature are stored in full, the older ones
+// are deltas from the event after them.
+template <uint8_t N>
+class EventLog {
+  public:
+    static constexpr uint8_t kCapacity = N;
+
+    uint8_t size() const {
+      return size_;
+    }
+
+    bool empty() const {
+      return size_ == 0;
+    }
+
+    void Clear() {
+      size_ = 0;
+      span_s_ = 0;
+    }
+
+    // Opens a new event, which ends the current one. When the log is full the oldest
+    // event is dropped.
+    //
+    // Start times are kept on whole seconds from the previous event so the deltas don't
+    // accumulate rounding errors. The returned start time can be up to a second before now.
+    uint32_t Push(const HvacMode hvac, const FanMode fan, const int16_t temperature_x10,
+                  const uint32_t now) {
+      if (size_ == N) {
+        DropOldest();
+      }
+
+      uint32_t delta_s = 0;
+      int16_t temperature_delta_x10 = 0;
+      if (size_ > 0) {
+        delta_s = Clock::MillisDiff(newest_start_, now) / 1000;
+        temperature_delta_x10 = temperature_x10 - newest_temperature_x10_;
+      }
+
+      newest_ = (newest_ + 1) % N;
+      PackedEvent* const event = &events_[newest_];
+      event->start_delta_s = delta_s > 0xFFFF ? 0xFFFF : delta_s;
+      event->modes = static_cast<uint8_t>(hvac) | (static_cast<uint8_t>(fan) << 4);
+      event->temperature_delta_x10 = SaturateInt8(temperature_delta_x10);
+      event->heat_rise_x10 = kNoHeatRise;
+
+      if (size_ > 0) {
+        span_s_ += event->start_delta_s;
+      }
+      if (size_ == 0 || delta_s > 0xFFFF) {
+        // The older start times are off by the excess, which only happens if the caller
+        // didn't split a long event.
+        newest_start_ = now;
+      } else {
+        newest_start_ += delta_s * 1000;
+      }
+      newest_temperature_x10_ = temperature_x10;
+      size_++;
+      return newest_start_;
+    }
+
+    void DropOldest() {
+      if (size_ == 0) {
+        return;
+      }
+      size_--;
+      // The new oldest event's delta pointed to the dropped event.
+      span_s_ = size_ == 0 ? 0 : span_s_ - At(size_ - 1).start_delta_s;
+    }
+
+    HvacMode hvac(const uint8_t age) const {
+      if (age >= size_) {
+        return HvacMode::EMPTY;
+      }
+      return static_cast<HvacMode>(At(age).modes & 0x0F);
+    }
+
+    FanMode fan(const uint8_t age) const {
+      if (age >= size_) {
+        return FanMode::EMPTY;
+      }
+      return static_cast<FanMode>(At(age).modes >> 4);
+    }
+
+    uint32_t newest_start() const {
+      return newest_start_;
+    }
+
+    int16_t newest_temperature_x10() const {
+      return newest_temperature_x10_;
+    }
+
+    uint32_t oldest_start() const {
+      return newest_start_ - span_s_ * 1000;
+    }
+
+    // Time between the start of the previous event and this one.
+    uint32_t StartDeltaMillis(const uint8_t age) const {
+      if (age + 1 >= size_) {
+        return 0;
+      }
+      return At(age).start_delta_s * 1000UL;
+    }
+
+    // Returns zero when empty, otherwise the length of time for the event. The open event
+    // lasts until now.
+    uint32_t DurationMillis(const uint8_t age, const uint32_t now) const {
+      if (age >= size_) {
+        return 0;
+      }
+      if (age == 0) {
+        return Clock::MillisDiff(newest_start_, now);
+      }
+      return At(age - 1).start_delta_s * 1000UL;
+    }
+
+    // Records the temperature rise after heating 10 minutes for the open event.
+    void SetHeatRise(const int16_t rise_x10) {
+      if (size_ > 0) {
+        events_[newest_].heat_rise_x10 = SaturateInt8(rise_x10);
+      }
+    }
+
+    bool GetHeatRise(const uint8_t age, int16_t* const rise_x10) const {
+      if (age >= size_ || At(age).heat_rise_x10 == kNoHeatRise) {
+        return false;
+      }
+      *rise_x10 = At(age).heat_rise_x10;
+      return true;
+    }
+
+    // Unpacks an event, which walks the deltas of the newer events.
+    Event Get(const uint8_t age) const {
+      Event event;
+      if (age >= size_) {
+        return event;
+      }
+      event.start_time = newest_start_;
+      event.temperature_x10 = newest_temperature_x10_;
+      for (uint8_t i = 0; i < age; ++i) {
+        event.start_time -= At(i).start_delta_s * 1000UL;
+        event.temperature_x10 -= At(i).temperature_delta_x10;
+      }
+      event.hvac = hvac(age);
+      event.fan = fan(age);
+      int16_t rise_x10;
+      if (GetHeatRise(age, &rise_x10)) {
+        event.temperature_10min_x10 = event.temperature_x10 + rise_x10;
+      }
+      return event;
+    }
+
+  private:
+    const PackedEvent& At(const uint8_t age) const {
+      return events_[(newest_ + N - age) % N];
+    }
+
+    PackedEvent events_[N];
+    uint32_t newest_start_ = 0;
+    // Sum of the start deltas of all but the oldest event.
+    uint32_t span_s_ = 0;
+    int16_t newest_temperature_x10_ = 0;
+    uint8_t newest_ = 0;
+    uint8_t size_ = 0;
+};
+
+}  // namespace thermostat
+#endif  // EVENT_LOG_H_
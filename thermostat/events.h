@@ -1,13 +1,14 @@
 #ifndef EVENTS_H_
 #define EVENTS_H_
-// Helpers to manage the Events struct for performing calculations and creating new events
+// Helpers to manage the EventLog for performing calculations and creating new events
 // whena applicable.
 
 #include "settings.h"
 
 namespace thermostat {
 
-constexpr float kTenMinuteAdjustmentMins = 9.5;
+// The heat rise is measured over 10 minutes, minus about 30 seconds of heater warmup.
+constexpr uint8_t kTenMinuteAdjustmentMinsX10 = 95;
 constexpr uint32_t kEventHorizon = Clock::DaysToMillis(1);
 
 static HvacMode Sanitize(const HvacMode mode) {
@@ -24,148 +25,49 @@ static FanMode Sanitize(const FanMode mode) {
   return FanMode::OFF;
 }
 
-static float GetHeatTempPerMin(const Settings& settings, const Clock& clock) {
-  const uint32_t now = clock.Millis();
-  // Find the average 10 minute temperature difference when heating (in the last 2 days).
-  uint8_t count = 0;
-  uint32_t sum = 0;
-  // Find any events in the last 2 days that have heat and 10 minute run time temperature.
-  for (uint8_t i = 0; i < EVENT_SIZE; ++i) {
-    const Event* const event = &settings.events[i];
-
-    if (event->empty()) {
-      continue;
-    }
-
-    if (Clock::MillisDiff(event->start_time, now) > kEventHorizon) {
-      continue;
-    }
-
-    if (event->hvac != HvacMode::HEAT) {
-      continue;
-    }
-    if (event->temperature_10min_x10 == 0) {
-      continue;
-    }
-    count++;
-    sum += (event->temperature_10min_x10 - event->temperature_x10);
-  }
-
-  // Use this heat/time as the basis for the temperature.
-  // Complete guesses atm.
-  // if ~ 1*/min set to 15%
-  // if ~ 2*/min set to 25%
-  // if ~ 3*/min set to 35%
-
-  return static_cast<float>(sum) / /*x10*/ 10.0 / count /
-         kTenMinuteAdjustmentMins /*mins (30 seconds? for heater warmup)*/;
-}
-
-// Returns Zero when empty, otherwise the length of time for the event.
-static uint32_t GetEventDuration(const uint8_t index, const Settings& settings,
+// Returns Zero when empty, otherwise the length of time for the event. Age 0 is the
+// newest event.
+static uint32_t GetEventDuration(const uint8_t age, const Settings& settings,
                                  const uint32_t now) {
-
-  // If the event is empty, we don't have a duration.
-  if (index >= EVENT_SIZE) {
-    return 0;
-  }
-
-  if (settings.events[index].empty()) {
-    return 0;
-  }
-
-  const uint8_t next_index = (index + 1) % EVENT_SIZE;
-  // When we don't have an event after this, then we use the current time.
-  if (settings.events[next_index].empty()) {
-    return Clock::MillisDiff(settings.events[index].start_time, now);
-  }
-  return Clock::MillisDiff(settings.events[index].start_time,
-                           settings.events[next_index].start_time);
+  return settings.events.DurationMillis(age, now);
 }
 
 // This checks if we should be in a 5 minute lockout when switching from cooling to
 // heating or heating to cooling.
-static bool IsInLockoutMode(const HvacMode mode, const Event* events, const uint32_t now) {
+static bool IsInLockoutMode(const HvacMode mode, const EventLog<EVENT_SIZE>& events,
+                            const uint32_t now) {
   // Lockout can only happen with heating or cooling.
   if (mode != HvacMode::COOL && mode != HvacMode::HEAT) {
     return false;
   }
-  
-  constexpr uint32_t kLockoutMs = 5UL * 60UL * 1000UL;
-  uint8_t index = 0;
-  uint32_t millis_since = 0xFFFFFFFF;  // some big number
 
-  // Find the newest event.
-  for (int i = 0; i < EVENT_SIZE; ++i) {
-    if (events[i].empty()) {
-      continue;
-    }
-    if (Clock::MillisDiff(events[i].start_time, now) < millis_since) {
-      millis_since = Clock::MillisDiff(events[i].start_time, now);
-      index = i;
-    }
-  }
-
-  // Are there any events found?
-  if (millis_since == 0xFFFFFFFF) {
-    return false;
-  }
-
-  // Are we actively heating or cooling?
-  if (mode == HvacMode::COOL && millis_since < kLockoutMs &&
-      events[index].hvac == HvacMode::HEAT) {
-    return true;
-  }
-  if (mode == HvacMode::HEAT && millis_since < kLockoutMs &&
-      events[index].hvac == HvacMode::COOL) {
-    return true;
-  }
+  constexpr uint32_t kLockoutMs = 5UL * 60UL * 1000UL;
 
-  // Try the current event, and keep looking back until we're beyond the
+  // Try the newest event, and keep looking back until we're beyond the
   // lockout window.
-  while (true) {
+  uint32_t start_time = events.newest_start();
+  for (uint8_t age = 0; age < events.size(); ++age) {
+    if (age > 0) {
+      start_time -= events.StartDeltaMillis(age - 1);
+    }
 
     // We use the started time of the newer event to know when it stopped.
-    if (mode == HvacMode::COOL && events[index].hvac == HvacMode::HEAT) {
+    if (mode == HvacMode::COOL && events.hvac(age) == HvacMode::HEAT) {
       return true;
     }
 
-    if (mode == HvacMode::HEAT && events[index].hvac == HvacMode::COOL) {
+    if (mode == HvacMode::HEAT && events.hvac(age) == HvacMode::COOL) {
       return true;
     }
 
     // use the start time for the next previous event as it's stop time.
-    millis_since = Clock::MillisDiff(events[index].start_time, now);
-
-    if (millis_since > kLockoutMs) {
+    if (Clock::MillisDiff(start_time, now) > kLockoutMs) {
       return false;
     }
-    
-    // Move to the previous event.
-    index = (index - 1) % EVENT_SIZE;
-    // The previous event is empty.
-    if (events[index].empty()) {
-     return false;
-    }
   }
   return false;
 }
 
-static uint32_t OldestEventStart(const Settings& settings, const Clock& clock) {
-  // Loop through all the stored events.
-  const uint32_t now = clock.Millis();
-
-  uint32_t oldest_start_time;
-  uint32_t oldest_diff = 0;
-  for (int idx = 0; idx < EVENT_SIZE; ++idx) {
-    // Account for wrap around by using MillisDiff.
-    if (Clock::MillisDiff(settings.events[idx].start_time, now) > oldest_diff) {
-      oldest_start_time = settings.events[idx].start_time;
-    }
-  }
-  return oldest_start_time;
-}
-
 static uint32_t CalculateDurationSinceTime(const uint32_t history_start, const uint32_t event_start, const uint32_t duration) {
   const uint32_t event_end = event_start + duration;
 
@@ -179,119 +81,220 @@ static uint32_t CalculateDurationSinceTime(const uint32_t history_start, const u
   return duration;
 }
 
-// Returns how long the system has been either running or not running.
-static uint32_t CalculateSeconds(const FanMode fan, const Settings& settings,
-                                 const uint32_t history_window_ms, const Clock& clock) {
-  uint32_t total_seconds = 0;
-  const uint32_t now = clock.Millis();
+// The functions below keep Settings::event_totals in sync with the events, which lets the
+// status queries run in constant time instead of scanning the history. The scanning
+// versions are in testing/event_scans.h, where the tests check the totals against them.
+
+// Adds (sign = 1) or removes (sign = -1) a closed event from the totals.
+static void ApplyToEventTotals(Settings* const settings, const uint8_t age,
+                               const int8_t sign) {
+  const EventLog<EVENT_SIZE>& events = settings->events;
+  EventTotals* const totals = &settings->event_totals;
+  const uint32_t duration = events.StartDeltaMillis(age - 1);
+  if (events.hvac(age) == HvacMode::HEAT) {
+    totals->heat_ms += sign * duration;
+  }
+  if (events.hvac(age) == HvacMode::COOL) {
+    totals->cool_ms += sign * duration;
+  }
+  if (events.fan(age) == FanMode::ON) {
+    totals->fan_ms += sign * duration;
+  }
+  int16_t rise_x10;
+  if (events.GetHeatRise(age, &rise_x10)) {
+    totals->heat_rise_x10 += sign * rise_x10;
+    totals->heat_rise_count += sign;
+  }
+}
 
-  // Loop through all the stored events.
-  for (int idx = 0; idx < EVENT_SIZE; ++idx) {
-    const uint32_t duration_ms = CalculateDurationSinceTime(
-                                   now - history_window_ms,
-                                   settings.events[idx].start_time,
-                                   GetEventDuration(idx, settings, now));
-    //
-    //    LOG(INFO) << "idx:" << idx
-    //              << " start: " << settings.events[idx].start_time / 60 / 1000
-    //              << " duration:" << duration_ms / 60 / 1000
-    //              << " fan:" << ((settings.events[idx].fan == FanMode::ON) ? "ON" : "OFF");
-
-    // Only sum events that have a duration.
-    if (duration_ms == 0) {
-      continue;
-    }
+// Drops the oldest closed event from the totals.
+static void RemoveEventTotalsTail(Settings* const settings) {
+  EventTotals* const totals = &settings->event_totals;
+  if (totals->tail_age == 0) {
+    return;
+  }
+  ApplyToEventTotals(settings, totals->tail_age, -1);
+  totals->tail_start += settings->events.StartDeltaMillis(totals->tail_age - 1);
+  totals->tail_age--;
+}
 
-    // Only sum events that match the desired running state.
-    if (settings.events[idx].fan != fan) {
-      continue;
-    }
+// Opens a new event in the log and adds the event it closed to the totals.
+static void PushEvent(Settings* const settings, const HvacMode hvac, const FanMode fan) {
+  EventLog<EVENT_SIZE>* const events = &settings->events;
+  EventTotals* const totals = &settings->event_totals;
 
-    //LOG(INFO) << "Total:" << total_seconds / 60 << " Summing " << duration_ms / 1000 / 60 << " for fan:" << (settings.events[idx].fan == FanMode::ON);
-    total_seconds += duration_ms / 1000;
+  // The oldest event is about to be dropped from the log.
+  if (events->size() == EventLog<EVENT_SIZE>::kCapacity &&
+      totals->tail_age == events->size() - 1) {
+    RemoveEventTotalsTail(settings);
   }
 
-  return total_seconds;
-};
+  const bool had_event = !events->empty();
+  const uint32_t closed_start = events->newest_start();
+  events->Push(hvac, fan, settings->current_mean_temperature_x10, settings->now);
+  if (!had_event) {
+    return;
+  }
 
-// Returns how long the system has been either running or not running.
-static uint32_t CalculateSeconds(const HvacMode hvac, const Settings& settings,
-                                 const uint32_t history_window_ms, const Clock& clock) {
-  uint32_t total_seconds = 0;
-  const uint32_t now = clock.Millis();
+  // The previous event now has an end time.
+  if (totals->tail_age == 0) {
+    totals->tail_start = closed_start;
+  }
+  totals->tail_age++;
+  ApplyToEventTotals(settings, 1, 1);
+}
 
-  // Loop through all the stored events.
-  for (int idx = 0; idx < EVENT_SIZE; ++idx) {
-    uint32_t duration_ms = GetEventDuration(idx, settings, now);
-
-    // Clip to the amount during the history window.
-    //
-    // TODO: Fix the millis wrap around issue if this is used for more
-    // than simple user output.
-    if (now - history_window_ms < settings.events[idx].start_time + duration_ms &&
-        now - history_window_ms >= settings.events[idx].start_time) {
-      duration_ms =
-        (settings.events[idx].start_time + duration_ms) - (now - history_window_ms);
-    }
+// Drops the oldest event from the log and the totals.
+static void DropOldestEvent(Settings* const settings) {
+  EventTotals* const totals = &settings->event_totals;
+  if (totals->tail_age > 0 && totals->tail_age == settings->events.size() - 1) {
+    RemoveEventTotalsTail(settings);
+  }
+  settings->events.DropOldest();
+}
 
-    // Only sum events that valid and have a duration.
-    if (duration_ms == 0) {
-      continue;
-    }
+// Removes the closed events which ended before the last day. Each event is only removed
+// once, so this is constant time when amortized over the calls.
+static void ExpireEventTotals(Settings* const settings) {
+  EventTotals* const totals = &settings->event_totals;
+  while (totals->tail_age > 0 &&
+         Clock::MillisDiff(totals->tail_start +
+                               settings->events.StartDeltaMillis(totals->tail_age - 1),
+                           settings->now) >= kEventHorizon) {
+    RemoveEventTotalsTail(settings);
+  }
+}
 
-    // Only sum events that match the desired running state.
-    if (settings.events[idx].hvac != hvac) {
-      continue;
+// How much of the last day is covered by the event history.
+static uint32_t RecentHistoryMillis(const Settings& settings, const uint32_t now) {
+  if (settings.events.empty()) {
+    return 0;
+  }
+  const uint32_t oldest_start = settings.event_totals.tail_age > 0
+                                    ? settings.event_totals.tail_start
+                                    : settings.events.newest_start();
+  return cmin(Clock::MillisDiff(oldest_start, now), kEventHorizon);
+}
+
+// Sums the time in the last day from the closed totals and the open event.
+static uint32_t RecentMillis(const Settings& settings, const uint32_t now,
+                             const uint32_t closed_ms, const bool tail_matches,
+                             const bool open_matches) {
+  uint32_t total_ms = closed_ms;
+  const EventTotals& totals = settings.event_totals;
+
+  // The oldest closed event can straddle the start of the window.
+  if (totals.tail_age > 0 && tail_matches) {
+    const uint32_t age_ms = Clock::MillisDiff(totals.tail_start, now);
+    if (age_ms > kEventHorizon) {
+      total_ms -= cmin(age_ms - kEventHorizon, total_ms);
     }
+  }
+  if (open_matches && !settings.events.empty()) {
+    total_ms += cmin(Clock::MillisDiff(settings.events.newest_start(), now), kEventHorizon);
+  }
+  return total_ms;
+}
+
+// Returns how long the hvac mode was active in the last day.
+static uint32_t RecentSeconds(const HvacMode hvac, const Settings& settings,
+                              const Clock& clock) {
+  const uint32_t now = clock.Millis();
+  const EventTotals& totals = settings.event_totals;
+  const HvacMode tail = settings.events.hvac(totals.tail_age);
+  const HvacMode open = settings.events.hvac(0);
 
-    total_seconds += duration_ms / 1000;
+  if (hvac == HvacMode::HEAT) {
+    return RecentMillis(settings, now, totals.heat_ms, tail == hvac, open == hvac) / 1000;
   }
+  if (hvac == HvacMode::COOL) {
+    return RecentMillis(settings, now, totals.cool_ms, tail == hvac, open == hvac) / 1000;
+  }
+  if (hvac == HvacMode::IDLE) {
+    const uint32_t window = RecentHistoryMillis(settings, now);
+    const uint32_t active = RecentSeconds(HvacMode::HEAT, settings, clock) +
+                            RecentSeconds(HvacMode::COOL, settings, clock);
+    return window / 1000 - cmin(active, window / 1000);
+  }
+  // Lockouts are recorded as idle.
+  return 0;
+}
+
+// Returns how long the fan was in the fan mode in the last day.
+static uint32_t RecentSeconds(const FanMode fan, const Settings& settings,
+                              const Clock& clock) {
+  const uint32_t now = clock.Millis();
+  const EventTotals& totals = settings.event_totals;
+  const uint32_t on_seconds =
+      RecentMillis(settings, now, totals.fan_ms,
+                   settings.events.fan(totals.tail_age) == FanMode::ON,
+                   settings.events.fan(0) == FanMode::ON) / 1000;
+  if (fan == FanMode::ON) {
+    return on_seconds;
+  }
+  if (fan == FanMode::OFF) {
+    const uint32_t window = RecentHistoryMillis(settings, now) / 1000;
+    return window - cmin(on_seconds, window);
+  }
+  return 0;
+}
 
-  return total_seconds;
-};
+// Returns the average heating temperature change per minute over the last day in
+// degrees x100.
+static int16_t RecentHeatTempPerMinX100(const Settings& settings) {
+  int32_t sum = settings.event_totals.heat_rise_x10;
+  uint8_t count = settings.event_totals.heat_rise_count;
+
+  int16_t rise_x10;
+  if (settings.events.GetHeatRise(0, &rise_x10)) {
+    sum += rise_x10;
+    count++;
+  }
+  if (count == 0) {
+    return 0;
+  }
+  return sum * 100 / (static_cast<int32_t>(count) * kTenMinuteAdjustmentMinsX10);
+}
 
 static uint32_t HeatRise(const Settings& settings, const Clock& clock) {
-  uint32_t now = clock.Millis();
+  const uint32_t now = clock.Millis();
   // Iterate backward for the latest two heat events or up to 12 hours.
   uint8_t heatrate_count = 0;
   int32_t heatrate = 0;
-  uint8_t last_idx = (settings.event_index - 1) % EVENT_SIZE;
-  for (uint8_t idx = settings.event_index; idx != last_idx; --idx) { 
-    if (settings.events[idx].empty()) {
-      break;
+  uint32_t start_time = settings.events.newest_start();
+  for (uint8_t age = 0; age < settings.events.size(); ++age) {
+    if (age > 0) {
+      start_time -= settings.events.StartDeltaMillis(age - 1);
     }
-    if (Clock::MillisDiff(settings.events[idx].start_time, now) >
-        Clock::DaysToMillis(24)) {
+    if (Clock::MillisDiff(start_time, now) > Clock::DaysToMillis(24)) {
       break;
     }
 
-    if (settings.events[idx].hvac == HvacMode::HEAT &&
-        settings.events[idx].temperature_10min_x10 != 0) {
-      const int16_t rate = settings.events[idx].temperature_10min_x10 - settings.events[idx].temperature_x10;
-      if (rate > 0) {
-        heatrate += rate;
-        ++heatrate_count;
-      }
+    int16_t rate;
+    if (settings.events.GetHeatRise(age, &rate) && rate > 0) {
+      heatrate += rate;
+      ++heatrate_count;
     }
 
     if (heatrate_count >= 2) {
       break;
     }
-    
-    idx = (idx - 1) % EVENT_SIZE;
   }
-  
+
   if (heatrate_count == 0) {
 	  return 0;
   }
 
-  return heatrate/heatrate_count;  
+  return heatrate/heatrate_count;
 }
 
 static int16_t OutdoorTemperatureEstimate(const Settings& settings, const Clock& clock) {
-  const uint32_t oldest_start_time = cmin(OldestEventStart(settings, clock), Clock::HoursToMillis(24));
-  const uint32_t heat_seconds = CalculateSeconds(HvacMode::HEAT, settings, Clock::HoursToMillis(24), clock);
-  const float heat_ratio = heat_seconds / Clock::MillisToSeconds(oldest_start_time);
+  const uint32_t window_seconds = RecentHistoryMillis(settings, clock.Millis()) / 1000;
+  if (window_seconds == 0) {
+    return 200;  // 20F
+  }
+  // Percentage of the last day spent heating.
+  const uint32_t heat_ratio = RecentSeconds(HvacMode::HEAT, settings, clock) * 100 / window_seconds;
 
   // Focus on 20F to -20F since this is where humidity control needs to change.
   if (heat_ratio < 20) {
@@ -0,0 +1,122 @@
+#ifndef FUSED_SENSOR_H_
+#define FUSED_SENSOR_H_
+// Combines the temperature of several sensors into one reading.
+//
+// Each source has the variance of its readings, and the fused temperature is the mean
+// weighted by the inverse variances, which is what a Kalman update of independent
+// readings gives. The noise of each sensor is averaged down instead of reaching the HVAC
+// control directly. A source that fails keeps its last reading until it's older than
+// the source's max age, and is then dropped, so the thermostat only fails when every
+// sensor did.
+
+#include "interfaces.h"
+
+namespace thermostat {
+
+struct FusedSource {
+  // The variance is of the temperature x10 readings, so 25 for a standard deviation of
+  // 0.5°F. A source without a valid reading for max_age_ms is left out until it reads
+  // again.
+  FusedSource(Sensor* const sensor, const uint16_t variance, const uint32_t max_age_ms) :
+    sensor(sensor),
+    variance(variance),
+    max_age_ms(max_age_ms) {};
+
+  Sensor* const sensor;
+  const uint16_t variance;
+  const uint32_t max_age_ms;
+
+  // The last valid reading, and whether it's recent enough to use.
+  int16_t temperature_x10 = 0;
+  uint32_t reading_ms = 0;
+  bool valid = false;
+};
+
+// The first source is the primary, which also gives the humidity, pressure and gas
+// readings.
+class FusedSensor : public Sensor {
+  public:
+    FusedSensor(Clock* const clock, FusedSource* const sources, const uint8_t source_count) :
+      clock_(clock),
+      sources_(sources),
+      source_count_(source_count) {};
+
+    void SetUp() override {
+      for (uint8_t i = 0; i < source_count_; ++i) {
+        sources_[i].sensor->SetUp();
+      }
+    }
+
+    void StartRequestAsync() override {
+      for (uint8_t i = 0; i < source_count_; ++i) {
+        sources_[i].sensor->StartRequestAsync();
+      }
+    }
+
+    // Returns false when no source has a recent reading.
+    bool EndReading() override {
+      int32_t weighted_sum = 0;
+      int32_t total_weight = 0;
+      for (uint8_t i = 0; i < source_count_; ++i) {
+        FusedSource* const source = &sources_[i];
+        if (source->sensor->EndReading()) {
+          source->temperature_x10 = source->sensor->GetTemperatureX10();
+          source->reading_ms = clock_->Millis();
+          source->valid = true;
+        } else if (clock_->millisSince(source->reading_ms) > source->max_age_ms) {
+          source->valid = false;
+        }
+        if (!source->valid) {
+          continue;
+        }
+        const int32_t weight = 0xFFFF / (source->variance == 0 ? 1 : source->variance);
+        weighted_sum += weight * source->temperature_x10;
+        total_weight += weight;
+      }
+
+      if (total_weight == 0) {
+        return false;
+      }
+      // Round to the nearest rather than towards zero.
+      const int32_t half = weighted_sum < 0 ? -total_weight / 2 : total_weight / 2;
+      temperature_x10_ = (weighted_sum + half) / total_weight;
+      return true;
+    }
+
+    int16_t GetTemperatureX10() override {
+      return temperature_x10_;
+    }
+
+    uint8_t GetHumidity() override {
+      return sources_[0].sensor->GetHumidity();
+    }
+
+    uint32_t GetPressure() override {
+      return sources_[0].sensor->GetPressure();
+    }
+
+    void EnableGasHeater(const bool enable) override {
+      sources_[0].sensor->EnableGasHeater(enable);
+    }
+
+    uint32_t GetGasResistance() override {
+      return sources_[0].sensor->GetGasResistance();
+    }
+
+    uint8_t source_count() const {
+      return source_count_;
+    }
+
+    const FusedSource& source(const uint8_t index) const {
+      return sources_[index];
+    }
+
+  private:
+    Clock* const clock_;
+    FusedSource* const sources_;
+    const uint8_t source_count_;
+    int16_t temperature_x10_ = 0;
+};
+
+}  // namespace thermostat
+#endif  // FUSED_SENSOR_H_
@@ -0,0 +1,81 @@
+#ifndef IDLE_H_
+#define IDLE_H_
+// Sleeps between the main loop passes instead of spinning.
+//
+// The main loop runs the scheduler and samples the buttons, and without a wait nearly
+// every pass finds no task due and the same button reading as the last one. The Idler
+// sleeps until the next task is due or the buttons need sampling again, whichever comes
+// first, so each pass has work to do. The button readings still need taking every poll
+// period, which bounds the press latency.
+
+#include "interfaces.h"
+#include "scheduler.h"
+
+namespace thermostat {
+
+class Idler {
+  public:
+    // The buttons are checked every poll_ms.
+    Idler(Clock* const clock, Sleeper* const sleeper, const Scheduler* const scheduler,
+          const uint16_t poll_ms) :
+      clock_(clock),
+      sleeper_(sleeper),
+      scheduler_(scheduler),
+      poll_us_(static_cast<uint32_t>(poll_ms) * 1000) {};
+
+    // Called at the end of every main loop pass, where ran is whether the scheduler ran
+    // any task. Returns once the next pass has something to do.
+    void Idle(const bool ran) {
+      uint32_t now_us = clock_->Micros();
+      // Nothing ran and the buttons were sampled again sooner than needed.
+      if (!ran && last_interval_us_ < poll_us_ && wasted_ < 0xFFFFFFFF) {
+        wasted_++;
+      }
+      if (passes_ < 0xFFFFFFFF) {
+        passes_++;
+      }
+
+      const uint32_t poll_left_us = now_us - pass_start_us_ < poll_us_
+                                        ? poll_us_ - (now_us - pass_start_us_)
+                                        : 0;
+      const uint32_t due_us = scheduler_->MicrosUntilDue(now_us);
+      const uint32_t sleep_us = due_us < poll_left_us ? due_us : poll_left_us;
+      if (sleep_us > 0) {
+        sleeper_->Sleep(sleep_us);
+        now_us = clock_->Micros();
+      }
+
+      last_interval_us_ = now_us - pass_start_us_;
+      pass_start_us_ = now_us;
+    }
+
+    // Main loop passes so far.
+    uint32_t passes() const {
+      return passes_;
+    }
+
+    // Passes which ran no task and came sooner than the button poll period.
+    uint32_t wasted() const {
+      return wasted_;
+    }
+
+    void Reset() {
+      passes_ = 0;
+      wasted_ = 0;
+    }
+
+  private:
+    Clock* const clock_;
+    Sleeper* const sleeper_;
+    const Scheduler* const scheduler_;
+    const uint32_t poll_us_;
+
+    // When the current pass started, and how long after the previous one.
+    uint32_t pass_start_us_ = 0;
+    uint32_t last_interval_us_ = 0xFFFFFFFF;
+    uint32_t passes_ = 0;
+    uint32_t wasted_ = 0;
+};
+
+}  // namespace thermostat
+#endif  // IDLE_H_
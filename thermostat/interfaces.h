@@ -13,11 +13,11 @@ namespace thermostat {
 // Forward declare settings.
 class Settings;
 
-enum class Status {kOk, kSkipped,
-                   kPrimarySensorFail,
-                   kHeatAndCool,
-                   kMenuDisplayArg, kError
-                  };
+enum class Status : uint8_t {kOk, kSkipped,
+                             kPrimarySensorFail,
+                             kHeatAndCool,
+                             kMenuDisplayArg, kError
+                            };
 
 class ThermostatTask {
   public:
@@ -44,6 +44,12 @@ class Clock {
 
     virtual uint32_t Millis() const = 0;
 
+    // Microseconds for timing short work, wrapping every ~71 minutes. Defaults to the
+    // millisecond resolution.
+    virtual uint32_t Micros() const {
+      return Millis() * 1000;
+    }
+
     // Calculate the millis since the previous time accounting for wrap around.
     uint32_t millisSince(const uint32_t previous) {
       return MillisDiff(previous, Millis());
@@ -159,28 +165,27 @@ class Sensor {
   public:
     virtual void SetUp() {};
 
-    // Most sensors implement this.
+    // Starts a new reading without waiting for it. Most sensors implement this.
     virtual void StartRequestAsync() {};
 
-    // Returns temperature in fehrenheit utilizing the temp and humidity for calculating the heat index.
-    virtual float GetTemperatureIndex() {
-      return 0;
-    };
-
-    virtual float GetTemperature() {
+    // Returns the temperature in fahrenheit x10. The readings are integers so the periodic
+    // path never needs the AVR's software floating point.
+    virtual int16_t GetTemperatureX10() {
       return 0;
     };
 
     // Returns relative humidity in %.
-    virtual float GetHumidity() {
+    virtual uint8_t GetHumidity() {
       return 0;
     };
 
-    virtual float GetPressure() {
+    // Returns the pressure in Pa.
+    virtual uint32_t GetPressure() {
       return 0;
     };
 
-    // Ensures the reading completed.
+    // Collects the reading started by StartRequestAsync. The getters return the collected
+    // values afterwards. Returns false when no valid reading is available.
     virtual bool EndReading() {
       return true;
     };
@@ -202,6 +207,16 @@ class SettingsStorer {
     virtual void Read(Settings *settings) = 0;
 };
 
+// Byte addressed non-volatile memory.
+class Eeprom {
+  public:
+    virtual uint16_t Size() = 0;
+    virtual uint8_t Read(const uint16_t address) = 0;
+    // Writes the byte only if it differs from the stored value, since every write wears
+    // the cell.
+    virtual void Update(const uint16_t address, const uint8_t value) = 0;
+};
+
 enum class RelayType {
   kHeat, kCool, kFan, kHeatHigh, kMax
 };
@@ -215,5 +230,22 @@ class Relays {
     virtual void Set(const RelayType relay, const RelayState state) = 0;
 };
 
+// Low power wait between the main loop passes.
+class Sleeper {
+  public:
+    // Waits for about duration_us, or returns sooner when an interrupt needs the main loop.
+    virtual void Sleep(const uint32_t duration_us) = 0;
+};
+
+// The RAM left between the heap and the stack.
+class Memory {
+  public:
+    // Bytes between the top of the heap and the stack now.
+    virtual uint16_t FreeBytes() = 0;
+
+    // The fewest free bytes there have been since boot.
+    virtual uint16_t MinFreeBytes() = 0;
+};
+
 }
 #endif
@@ -0,0 +1,142 @@
+#ifndef LOG_SETTINGS_STORER_H_
+#define LOG_SETTINGS_STORER_H_
+// Wear-leveled SettingsStorer which appends the persisted settings as records rotating
+// through the EEPROM.
+//
+// The EEPROM is split into fixed size slots, each holding:
+//   [sequence (2 bytes)] [crc16 of the sequence and payload (2 bytes)] [PersistedSettings]
+// Every write goes to the slot after the newest one, so wear is spread across all the
+// slots instead of hitting address 0 each time. Bytes are written with Eeprom::Update, so
+// only the bytes that differ from the slot's old record are rewritten, and a write with
+// no changed settings doesn't touch the EEPROM at all.
+//
+// The crc is written last, so a record torn by a power loss fails validation and the
+// previous record in the slot before it is used instead.
+
+#include "crc.h"
+#include "interfaces.h"
+#include "settings.h"
+
+namespace thermostat {
+
+class LogSettingsStorer : public SettingsStorer {
+  public:
+    static constexpr uint8_t kHeaderSize = 4;
+    static constexpr uint16_t kRecordSize = kHeaderSize + sizeof(PersistedSettings);
+
+    // Uses length bytes from start, or the rest of the EEPROM when length is 0.
+    explicit LogSettingsStorer(Eeprom* const eeprom, const uint16_t start = 0,
+                               const uint16_t length = 0)
+      : eeprom_(eeprom), start_(start), length_(length) {};
+
+    void Write(const Settings& settings) override {
+      Recover();
+      const uint8_t* const payload = reinterpret_cast<const uint8_t*>(&settings.persisted);
+      if (slots_ == 0 || (found_ && PayloadMatches(newest_slot_, payload))) {
+        return;
+      }
+
+      const uint8_t slot = found_ ? (newest_slot_ + 1) % slots_ : 0;
+      const uint16_t sequence = found_ ? newest_sequence_ + 1 : 0;
+      const uint16_t address = SlotAddress(slot);
+
+      uint16_t crc = Crc16Update(kCrc16Init, sequence & 0xFF);
+      crc = Crc16Update(crc, sequence >> 8);
+      crc = Crc16(payload, sizeof(PersistedSettings), crc);
+
+      // The crc goes last so the record only becomes valid once complete.
+      for (uint16_t i = 0; i < sizeof(PersistedSettings); ++i) {
+        eeprom_->Update(address + kHeaderSize + i, payload[i]);
+      }
+      eeprom_->Update(address, sequence & 0xFF);
+      eeprom_->Update(address + 1, sequence >> 8);
+      eeprom_->Update(address + 2, crc & 0xFF);
+      eeprom_->Update(address + 3, crc >> 8);
+
+      found_ = true;
+      newest_slot_ = slot;
+      newest_sequence_ = sequence;
+    };
+
+    // Reads the newest valid record. Without one (such as the first boot after switching
+    // from the single record layout), reads the settings stored at the start instead and
+    // leaves it to the version check to reject them.
+    void Read(Settings *settings) override {
+      Recover();
+      uint8_t* const payload = reinterpret_cast<uint8_t*>(&settings->persisted);
+      const uint16_t address = found_ ? SlotAddress(newest_slot_) + kHeaderSize : start_;
+      for (uint16_t i = 0; i < sizeof(PersistedSettings); ++i) {
+        payload[i] = eeprom_->Read(address + i);
+      }
+    };
+
+    uint8_t slots() {
+      Recover();
+      return slots_;
+    }
+
+  private:
+    // Finds the newest valid record. Every byte is read once, so this takes the same time
+    // (about 4K reads on the Mega) whatever the contents are.
+    void Recover() {
+      if (recovered_) {
+        return;
+      }
+      recovered_ = true;
+      if (length_ == 0) {
+        length_ = eeprom_->Size() - start_;
+      }
+      const uint16_t slots = length_ / kRecordSize;
+      slots_ = slots > 255 ? 255 : slots;
+
+      for (uint8_t slot = 0; slot < slots_; ++slot) {
+        const uint16_t address = SlotAddress(slot);
+        const uint16_t sequence = eeprom_->Read(address) | (eeprom_->Read(address + 1) << 8);
+        const uint16_t stored_crc =
+          eeprom_->Read(address + 2) | (eeprom_->Read(address + 3) << 8);
+
+        uint16_t crc = Crc16Update(kCrc16Init, sequence & 0xFF);
+        crc = Crc16Update(crc, sequence >> 8);
+        for (uint16_t i = 0; i < sizeof(PersistedSettings); ++i) {
+          crc = Crc16Update(crc, eeprom_->Read(address + kHeaderSize + i));
+        }
+        if (crc != stored_crc) {
+          continue;
+        }
+        // Live sequences are within the slot count of each other, so the wrapped
+        // difference orders them across the 16-bit overflow.
+        if (!found_ || static_cast<int16_t>(sequence - newest_sequence_) > 0) {
+          found_ = true;
+          newest_slot_ = slot;
+          newest_sequence_ = sequence;
+        }
+      }
+    }
+
+    bool PayloadMatches(const uint8_t slot, const uint8_t* const payload) {
+      const uint16_t address = SlotAddress(slot) + kHeaderSize;
+      for (uint16_t i = 0; i < sizeof(PersistedSettings); ++i) {
+        if (eeprom_->Read(address + i) != payload[i]) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    uint16_t SlotAddress(const uint8_t slot) const {
+      return start_ + slot * kRecordSize;
+    }
+
+    Eeprom* const eeprom_;
+    const uint16_t start_;
+    uint16_t length_;
+
+    bool recovered_ = false;
+    uint8_t slots_ = 0;
+    bool found_ = false;
+    uint8_t newest_slot_ = 0;
+    uint16_t newest_sequence_ = 0;
+};
+
+}  // namespace thermostat
+#endif  // LOG_SETTINGS_STORER_H_
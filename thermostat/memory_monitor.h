@@ -0,0 +1,42 @@
+#ifndef MEMORY_MONITOR_H_
+#define MEMORY_MONITOR_H_
+// Stack painting to find how close the stack has come to the heap.
+//
+// The free RAM between the heap and the stack is filled with a known byte at boot. The
+// stack grows down into it, so counting the painted bytes left above the heap gives the
+// fewest free bytes there have ever been, including the deepest interrupt nesting, which
+// sampling the stack pointer would miss.
+
+#include "interfaces.h"
+
+namespace thermostat {
+
+// Unlikely to be a return address or a small number on the stack.
+constexpr uint8_t kStackPaint = 0xC5;
+
+// The control chain warns of low memory below this many never used bytes.
+constexpr uint16_t kLowMemoryBytes = 256;
+
+// How often the MemoryMonitoringLayer scans for the painted bytes.
+constexpr uint32_t kMemoryScanMillis = Clock::MinutesToMillis(1);
+
+// Fills [begin, end) with the paint. Always inlined, since a call would push its return
+// address into the range when painting up to the stack pointer.
+static inline __attribute__((always_inline)) void PaintMemory(uint8_t* begin,
+                                                              uint8_t* const end) {
+  while (begin < end) {
+    *begin++ = kStackPaint;
+  }
+}
+
+// Counts the painted bytes from begin up to the first one overwritten, or up to end.
+static uint16_t CountPainted(const uint8_t* const begin, const uint8_t* const end) {
+  const uint8_t* p = begin;
+  while (p < end && *p == kStackPaint) {
+    p++;
+  }
+  return p - begin;
+}
+
+}  // namespace thermostat
+#endif  // MEMORY_MONITOR_H_
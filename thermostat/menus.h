@@ -6,6 +6,8 @@
 #include "events.h"
 #include "settings.h"
 #include "interfaces.h"
+#include "scheduler.h"
+#include "timing.h"
 //
 //  Each [R] press takes the user through editable settings.
 //       Pressing [U] or [D] causes edit mode to be enabled.
@@ -15,12 +17,12 @@
 //
 //  Each [L] Takes the user through status information.
 //
-//  Main -> [R][R] Setpoint 1 -> [U][D] Edits HH:MM *F -> [Up] Increase item selected
-//                                                  -> [Dn] Decrease item selected
-//                                                  -> [L] ABORT and return to Home
-//                                                  status.
-//                                                  -> [R] Move item selected to right
-//                                                  -> [Sel] Save
+//  Main -> [R][R] Setpoint 1 -> [U][D] Edits *F HH:MM DD -> [Up] Increase item selected
+//                                                     -> [Dn] Decrease item selected
+//                                                     -> [L] ABORT and return to Home
+//                                                     status.
+//                                                     -> [R] Move item selected to right
+//                                                     -> [Sel] Save
 //
 
 namespace thermostat {
@@ -30,12 +32,48 @@ using WaitForButtonPressFn = Button (*)(uint32_t timeout);
 using SettingFn = Button (*)();
 using GetDateFn = Date (*)();
 
+// The days a setpoint can start on, in the order the setpoint page cycles through them:
+// none, which turns the setpoint off, every day, weekdays, the weekend, then each day.
+constexpr uint8_t kSetpointDays[] = {0, kEveryDay, kWeekdays, kWeekend,
+                                     0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40};
+constexpr uint8_t kSetpointDaysOptions = sizeof(kSetpointDays);
+// The labels of the options before the single days, which use daysOfTheWeek.
+constexpr char kSetpointDaysLabel[][3] = {"--", "**", "WD", "WE"};
+constexpr uint8_t kSetpointDaysLabels = sizeof(kSetpointDaysLabel) / sizeof(kSetpointDaysLabel[0]);
+
+// The setpoint pages show a single digit setpoint number.
+static_assert(kScheduleSize <= 9, "Too many setpoints for the setpoint pages");
+
+// The kSetpointDays option for a setpoint's days. Days set some other way show as every day.
+static uint8_t SetpointDaysOption(const uint8_t days) {
+  for (uint8_t i = 0; i < kSetpointDaysOptions; ++i) {
+    if (kSetpointDays[i] == days) {
+      return i;
+    }
+  }
+  return 1;
+}
+
 // Set changed, and update the EEPROM.
 static void SetChangedAndPersist(Settings *settings, SettingsStorer *writer) {
   settings->changed = true;
   writer->Write(*settings);
 };
 
+// Prints a x100 fixed point value with two decimals.
+static void PrintX100(Print* print, int16_t value_x100) {
+  if (value_x100 < 0) {
+    print->write('-');
+    value_x100 = -value_x100;
+  }
+  print->print(value_x100 / 100);
+  print->write('.');
+  if (value_x100 % 100 < 10) {
+    print->write('0');
+  }
+  print->print(value_x100 % 100);
+}
+
 // Set changed, but don't update the EEPROM.
 static void SetChanged(Settings* settings) {
   settings->changed = true;
@@ -206,17 +244,21 @@ class Waiter {
 // the HVAC and first row of the LCD.
 class Menus {
   public:
+    // The timings and scheduler are optional, see timing.h and scheduler.h.
     Menus(Settings *settings, WaitForButtonPressFn wait_for_button_press, Clock *clock,
-          Display *display, SettingsStorer *storer)
+          Display *display, SettingsStorer *storer, const Timings *timings = nullptr,
+          const Scheduler *scheduler = nullptr)
       : settings_(settings),
         storer_(storer),
         wait_for_button_press_(wait_for_button_press),
         clock_(clock),
-        display_(display) {}
+        display_(display),
+        timings_(timings),
+        scheduler_(scheduler) {}
 
     void ShowStatuses() {
       uint8_t menu_index = 0;
-      constexpr uint8_t MENU_MAX = 9;
+      constexpr uint8_t MENU_MAX = 12;
 
       while (true) {
         ResetLine();
@@ -228,9 +270,9 @@ class Menus {
             //H:00 C:00 F:00 %
             {
               display_->print("H:");
-              const uint32_t window = cmin(OldestEventStart(*settings_, *clock_), Clock::HoursToMillis(24));
-              const uint32_t heat = CalculateSeconds(HvacMode::HEAT, *settings_, window, *clock_);
-              const int ratio = cmin(heat * 100 / Clock::MillisToSeconds(window), 99UL);
+              const uint32_t window = cmax(Clock::MillisToSeconds(RecentHistoryMillis(*settings_, clock_->Millis())), 1UL);
+              const uint32_t heat = RecentSeconds(HvacMode::HEAT, *settings_, *clock_);
+              const int ratio = cmin(heat * 100 / window, 99UL);
               if (ratio < 10) {
                 display_->write('0');
               }
@@ -238,9 +280,9 @@ class Menus {
             }
             {
               display_->print(" C:");
-              const uint32_t window = cmin(OldestEventStart(*settings_, *clock_), Clock::HoursToMillis(24));
-              const uint32_t cool = CalculateSeconds(HvacMode::COOL, *settings_, window, *clock_);
-              const int ratio = cmin(cool * 100 / Clock::MillisToSeconds(window), 99UL);
+              const uint32_t window = cmax(Clock::MillisToSeconds(RecentHistoryMillis(*settings_, clock_->Millis())), 1UL);
+              const uint32_t cool = RecentSeconds(HvacMode::COOL, *settings_, *clock_);
+              const int ratio = cmin(cool * 100 / window, 99UL);
               if (ratio < 10) {
                 display_->write('0');
               }
@@ -248,9 +290,9 @@ class Menus {
             }
             {
               display_->print(" F:");
-              const uint32_t window = cmin(OldestEventStart(*settings_, *clock_), Clock::HoursToMillis(24));
-              const uint32_t fan = CalculateSeconds(FanMode::ON, *settings_, window, *clock_);
-              const int ratio = cmin(fan * 100 / Clock::MillisToSeconds(window), 99UL);
+              const uint32_t window = cmax(Clock::MillisToSeconds(RecentHistoryMillis(*settings_, clock_->Millis())), 1UL);
+              const uint32_t fan = RecentSeconds(FanMode::ON, *settings_, *clock_);
+              const int ratio = cmin(fan * 100 / window, 99UL);
               if (ratio < 10) {
                 display_->write('0');
               }
@@ -269,26 +311,32 @@ class Menus {
               // c du:XXXXXm SF
               const uint32_t now = clock_->Millis();
 
-              // Loop through all the stored events.
-              for (int idx = 0; idx < EVENT_SIZE; ++idx) {
+              // Loop through all the stored events from the oldest.
+              const EventLog<EVENT_SIZE>& events = settings_->events;
+              uint32_t start_time = events.oldest_start();
+              for (uint8_t idx = 0; idx < events.size(); ++idx) {
+                const uint8_t age = events.size() - 1 - idx;
+                start_time += events.StartDeltaMillis(age);
                 const uint32_t duration_ms = CalculateDurationSinceTime(
                                                now - Clock::HoursToMillis(24),
-                                               settings_->events[idx].start_time,
-                                               GetEventDuration(idx, *settings_, now));
+                                               start_time,
+                                               GetEventDuration(age, *settings_, now));
 
                 // Only sum events that valid and have a duration.
                 if (duration_ms == 0) {
                   continue;
                 }
 
+                const char fan = events.fan(age) == FanMode::ON ? 'F' : 'I';
+                const char hvac = events.hvac(age) == HvacMode::COOL ? 'C' : events.hvac(age) == HvacMode::HEAT ? 'H' : 'I';
                 ResetLine();
                 display_->SetCursor(0, 1);
                 display_->write('A' + idx);
                 display_->print(" st:");
-                display_->print(settings_->events[idx].start_time / 1000 / 60);
+                display_->print(start_time / 1000 / 60);
                 display_->print("m ");
-                display_->print(settings_->events[idx].fan == FanMode::ON ? "F" : "I");
-                display_->print(settings_->events[idx].hvac == HvacMode::COOL ? "C" : settings_->events[idx].hvac == HvacMode::HEAT ? "H" : "I");
+                display_->print(fan);
+                display_->print(hvac);
                 wait_for_button_press_(1000);
                 ResetLine();
                 display_->SetCursor(0, 1);
@@ -296,37 +344,37 @@ class Menus {
                 display_->print(" du:");
                 display_->print(duration_ms / 1000 / 60);
                 display_->print("m ");
-                display_->print(settings_->events[idx].fan == FanMode::ON ? "F" : "I");
-                display_->print(settings_->events[idx].hvac == HvacMode::COOL ? "C" : settings_->events[idx].hvac == HvacMode::HEAT ? "H" : "I");
+                display_->print(fan);
+                display_->print(hvac);
                 wait_for_button_press_(1000);
               }
             }
             break;
           case 1:
-            display_->print("BME Temp: ");
-            display_->print(settings_->current_bme_temperature_x10);
+            display_->print("Mean Temp: ");
+            display_->print(settings_->current_mean_temperature_x10);
             button = wait_for_button_press_(10000);
             break;
           case 2:
-            display_->print("Dal Temp: ");
+            display_->print("Raw Temp: ");
             display_->print(settings_->current_temperature_x10);
             button = wait_for_button_press_(10000);
             break;
           case 3:
             display_->print("IAQ: ");
-            display_->print(settings_->air_quality_score);
+            display_->print(static_cast<int>(settings_->air_quality_score));
             button = wait_for_button_press_(10000);
             break;
           case 4:
             display_->print("Heat T/m: ");
 
-            display_->print(GetHeatTempPerMin(*settings_, *clock_));
+            PrintX100(display_, RecentHeatTempPerMinX100(*settings_));
             button = wait_for_button_press_(10000);
             break;
           case 5:
             {
               display_->print("H s: ");
-              const uint32_t heat = CalculateSeconds(HvacMode::HEAT, *settings_, Clock::HoursToMillis(24), *clock_);
+              const uint32_t heat = RecentSeconds(HvacMode::HEAT, *settings_, *clock_);
               display_->print(heat);
               button = wait_for_button_press_(10000);
               break;
@@ -334,7 +382,7 @@ class Menus {
           case 6:
             {
               display_->print("F s.: ");
-              const uint32_t fan = CalculateSeconds(FanMode::ON, *settings_, Clock::HoursToMillis(24), *clock_);
+              const uint32_t fan = RecentSeconds(FanMode::ON, *settings_, *clock_);
 
               display_->print(fan);
               button = wait_for_button_press_(10000);
@@ -356,6 +404,89 @@ class Menus {
               button = wait_for_button_press_(10000);
               break;
             }
+          case 9:
+            {
+              if (timings_ == nullptr) {
+                display_->print("Timing off");
+                button = wait_for_button_press_(10000);
+                break;
+              }
+              //1234567890123456
+              //Loop:MEAN/MAXus
+              display_->print("Loop:");
+              display_->print(timings_->loop().mean_us());
+              display_->write('/');
+              display_->print(timings_->loop().max_us());
+              display_->print("us");
+
+              button = wait_for_button_press_(10000);
+              if (button == Button::UP) {
+                // Walk through the timed layers from the outermost one.
+                for (uint8_t i = timings_->layer_count(); i-- > 0;) {
+                  const TimingStats& stats = timings_->layer(i).stats();
+                  ResetLine();
+                  display_->SetCursor(0, 1);
+                  display_->print(timings_->layer(i).name());
+                  display_->write(' ');
+                  display_->print(stats.mean_us());
+                  display_->write('/');
+                  display_->print(stats.max_us());
+                  wait_for_button_press_(2000);
+                }
+              }
+              if (button == Button::SELECT) {
+                timings_->Dump();
+              }
+              break;
+            }
+          case 10:
+            {
+              if (scheduler_ == nullptr) {
+                display_->print("No scheduler");
+                button = wait_for_button_press_(10000);
+                break;
+              }
+              //1234567890123456
+              //Missed:COUNT
+              unsigned int missed = 0;
+              for (uint8_t i = 0; i < scheduler_->task_count(); ++i) {
+                missed += scheduler_->task(i).jitter.missed();
+              }
+              display_->print("Missed:");
+              display_->print(missed);
+
+              button = wait_for_button_press_(10000);
+              if (button == Button::UP) {
+                // Walk through the tasks showing how late they started.
+                for (uint8_t i = 0; i < scheduler_->task_count(); ++i) {
+                  const JitterStats& jitter = scheduler_->task(i).jitter;
+                  ResetLine();
+                  display_->SetCursor(0, 1);
+                  display_->print(scheduler_->task(i).name);
+                  display_->write(' ');
+                  display_->print(jitter.mean_late_us() / 1000);
+                  display_->write('/');
+                  display_->print(jitter.max_late_us() / 1000);
+                  display_->print("ms");
+                  wait_for_button_press_(2000);
+                }
+              }
+              if (button == Button::SELECT) {
+                scheduler_->Dump();
+              }
+              break;
+            }
+          case 11:
+            {
+              //1234567890123456
+              //Mem:FREE Lo:MIN
+              display_->print("Mem:");
+              display_->print(settings_->free_memory_bytes);
+              display_->print(" Lo:");
+              display_->print(settings_->min_free_memory_bytes);
+              button = wait_for_button_press_(10000);
+              break;
+            }
         }
 
         ResetLine();
@@ -377,40 +508,37 @@ class Menus {
       ResetLine();
 
       uint8_t menu_index = 0;
-      constexpr uint8_t kMenuMax = 9;
+      // A page for each heat then each cool setpoint, after the fan and mode.
+      constexpr uint8_t kSetpointPages = 2 * kScheduleSize;
+      constexpr uint8_t kMenuMax = 6 + kSetpointPages;
 
       while (true) {
-        Button button;
-        switch (menu_index) {
-          case 0:
-            button = SetFan();
-            break;
-          case 1:
-            button = SetMode();
-            break;
-          case 2:
-            button = SetSetpoint(0, HvacMode::HEAT);
-            break;
-          case 3:
-            button = SetSetpoint(1, HvacMode::HEAT);
-            break;
-          case 4:
-            button = SetSetpoint(0, HvacMode::COOL);
-            break;
-          case 5:
-            button = SetSetpoint(1, HvacMode::COOL);
-            break;
-          case 6:
-            button = SetTolerance();
-            break;
-          case 7:
-            button = SetDate();
-            break;
-          case 8:
-            button = SetFanCycle();
-            break;
-          case kMenuMax:
-            break;
+        Button button = Button::NONE;
+        const uint8_t setpoint = menu_index - 2;
+        if (menu_index >= 2 && setpoint < kSetpointPages) {
+          button = SetSetpoint(setpoint % kScheduleSize,
+                               setpoint < kScheduleSize ? HvacMode::HEAT : HvacMode::COOL);
+        } else {
+          switch (menu_index < 2 ? menu_index : menu_index - kSetpointPages) {
+            case 0:
+              button = SetFan();
+              break;
+            case 1:
+              button = SetMode();
+              break;
+            case 2:
+              button = SetTolerance();
+              break;
+            case 3:
+              button = SetDate();
+              break;
+            case 4:
+              button = SetFanCycle();
+              break;
+            case 5:
+              button = SetRecovery();
+              break;
+          }
         }
         switch (button) {
           case Button::LEFT:
@@ -684,6 +812,60 @@ class Menus {
       }
     }
 
+    Button SetRecovery() {
+      Flasher flasher(clock_);
+      Waiter waiter(&wait_for_button_press_);
+      Digit recovery = Digit(settings_->persisted.adaptive_recovery, 0, 1, false, "", display_,
+                             &flasher);
+
+      // Setup the display
+      // "Recovery:ON     "
+      ResetLine();
+      display_->print("Recovery:");
+      // Draw the value.
+      auto update = [&]() {
+        display_->SetCursor(9, 1);
+        if (flasher.State()) {
+          display_->print("___");
+          return;
+        }
+        display_->print(recovery.Value() ? "ON " : "OFF");
+      };
+
+      // First see if the user wants to change this item.
+      update();
+      Button button = WaitBeforeEdit();
+      if (button != Button::SELECT) {
+        return button;
+      }
+
+      while (true) {
+        Button button = waiter.Wait();
+
+        int increment = 1;
+        switch (button) {
+          case Button::DOWN:
+            increment = -1;
+          /* FALLTHRU */
+          case Button::UP:
+            recovery.Increment(true, increment);
+            break;
+          case Button::SELECT:
+            settings_->persisted.adaptive_recovery = recovery.Value() ? true : false;
+            SetChangedAndPersist(settings_, storer_);
+
+            PrintUpdatedAndWait();
+            return Button::NONE;
+          case Button::NONE:
+            // Do nothing.
+            break;
+          default:
+            return button;
+        }
+        update();
+      }
+    }
+
     Button SetDate() {
       uint8_t field = 0;
 
@@ -762,25 +944,24 @@ class Menus {
       }
     }
 
-    Button SetSetpoint(const uint8_t setpoint, const HvacMode mode) {
-      constexpr uint8_t kMaxFields = 3;
+    Button SetSetpoint(const uint8_t index, const HvacMode mode) {
+      constexpr uint8_t kMaxFields = 4;
       uint8_t field = 0;
       // 1234567890123456
-      // H1: XX.X° XX:XX
+      // H1:XX.X°XX:XX DD
+      Setpoint& setpoint = (mode == HvacMode::HEAT) ? settings_->persisted.heat_setpoints[index]
+                                                    : settings_->persisted.cool_setpoints[index];
       Flasher flasher(clock_);
       Waiter waiter(&wait_for_button_press_);
-      Digit temp = Digit((mode == HvacMode::HEAT)
-                         ? settings_->persisted.heat_setpoints[setpoint].temperature_x10
-                         : settings_->persisted.cool_setpoints[setpoint].temperature_x10, 0, 999, true, "", display_, &flasher);
-      Digit hrs = Digit((mode == HvacMode::HEAT) ? settings_->persisted.heat_setpoints[setpoint].hour
-                        : settings_->persisted.cool_setpoints[setpoint].hour, 0, 23, false, ":", display_, &flasher);
-      Digit mins = Digit((mode == HvacMode::HEAT)
-                         ? settings_->persisted.heat_setpoints[setpoint].minute
-                         : settings_->persisted.cool_setpoints[setpoint].minute, 0, 59, false, "", display_, &flasher);
+      Digit temp = Digit(setpoint.temperature_x10, 0, 999, true, "", display_, &flasher);
+      Digit hrs = Digit(setpoint.hour, 0, 23, false, ":", display_, &flasher);
+      Digit mins = Digit(setpoint.minute, 0, 59, false, "", display_, &flasher);
+      Digit days = Digit(SetpointDaysOption(setpoint.days), 0, kSetpointDaysOptions - 1, false,
+                         "", display_, &flasher);
 
       ResetLine();
       display_->print((mode == HvacMode::HEAT) ? "H" : "C");
-      display_->print(setpoint + 1);
+      display_->print(index + 1);
       display_->print(":");
       auto update = [&]() {
         display_->SetCursor(3, 1);
@@ -789,10 +970,16 @@ class Menus {
         // Print custom degree symbol.
         display_->write(uint8_t(0));
 
-        display_->write(' ');
         hrs.Print(field == 2);
-        //display_->print(":");
         mins.Print(field == 3);
+
+        display_->write(' ');
+
+        if (field == 4 && flasher.State()) {
+          display_->print("__");
+        } else {
+          PrintSetpointDays(days.Value());
+        }
       };
 
       // First see if the user wants to change this item.
@@ -833,19 +1020,14 @@ class Menus {
             temp.Increment(field == 1, increment);
             hrs.Increment(field == 2, increment);
             mins.Increment(field == 3, increment);
+            days.Increment(field == 4, increment);
             break;
           case Button::SELECT:
-            if (mode == HvacMode::HEAT) {
-              settings_->persisted.heat_setpoints[setpoint].temperature_x10 =
-                temp.Value();
-              settings_->persisted.heat_setpoints[setpoint].hour = hrs.Value();
-              settings_->persisted.heat_setpoints[setpoint].minute = mins.Value();
-            } else {
-              settings_->persisted.cool_setpoints[setpoint].temperature_x10 =
-                temp.Value();
-              settings_->persisted.cool_setpoints[setpoint].hour = hrs.Value();
-              settings_->persisted.cool_setpoints[setpoint].minute = mins.Value();
-            }
+            setpoint.temperature_x10 = temp.Value();
+            setpoint.hour = hrs.Value();
+            setpoint.minute = mins.Value();
+            setpoint.days = kSetpointDays[days.Value()];
+            CompileSchedules(settings_);
             // Update the settings data.
             SetChangedAndPersist(settings_, storer_);
             PrintUpdatedAndWait();
@@ -860,6 +1042,15 @@ class Menus {
       }
     }
 
+    // Prints the two letter label of a kSetpointDays option.
+    void PrintSetpointDays(const uint8_t option) {
+      if (option < kSetpointDaysLabels) {
+        display_->print(kSetpointDaysLabel[option]);
+      } else {
+        display_->print(daysOfTheWeek[option - kSetpointDaysLabels]);
+      }
+    }
+
 
     Button SetTolerance() {
       Flasher flasher(clock_);
@@ -1040,6 +1231,8 @@ class Menus {
     WaitForButtonPressFn wait_for_button_press_;
     Clock *clock_;
     Display *display_;
+    const Timings *timings_;
+    const Scheduler *scheduler_;
 };
 
 }
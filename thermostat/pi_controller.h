@@ -0,0 +1,139 @@
+#ifndef PI_CONTROLLER_H_
+#define PI_CONTROLLER_H_
+// Proportional-integral control of the heat or cool with a time proportioned output.
+//
+// The tolerance band turns the equipment on below the setpoint and off above the setpoint
+// plus the tolerance, so the room swings through the whole band. The PiController instead
+// works out how much of the time the equipment should run to hold the setpoint, and the
+// TimeProportioner runs it for that share of each cycle window, with minimum on and off
+// times to protect the equipment.
+
+#include "comparison.h"
+#include "interfaces.h"
+
+namespace thermostat {
+
+// Duty cycles are in permille of the cycle window.
+constexpr int16_t kMaxDutyPermille = 1000;
+
+struct PiControlConfig {
+  // Duty per 0.1° below the heat setpoint (above the cool setpoint).
+  uint8_t kp_permille = 50;
+  // Duty added per hour the temperature stays 0.1° from the setpoint.
+  uint8_t ki_permille_per_hour = 25;
+
+  // The window must fit the minimum on and off times.
+  uint8_t cycle_minutes = 30;
+  uint8_t min_on_minutes = 5;
+  uint8_t min_off_minutes = 5;
+};
+
+// The error is how far the temperature is from the setpoint in the direction the
+// equipment moves it, so positive when the heat (cool) needs to run. The integral only
+// winds while the output isn't saturated in the direction of the error, and never past
+// what a full duty needs.
+class PiController {
+  public:
+    PiController(const uint8_t kp_permille, const uint8_t ki_permille_per_hour) :
+      kp_permille_(kp_permille),
+      ki_permille_per_hour_(ki_permille_per_hour) {};
+
+    // Returns the duty in permille for the error, dt_ms after the previous update.
+    int16_t Update(const int16_t error_x10, uint32_t dt_ms) {
+      // Don't let a long gap between the updates, such as a sensor failure, wind it up.
+      dt_ms = cmin(dt_ms, Clock::SecondsToMillis(60));
+
+      const int32_t proportional = static_cast<int32_t>(kp_permille_) * error_x10;
+      const int32_t output = proportional + IntegralPermille();
+      if ((output < kMaxDutyPermille || error_x10 < 0) && (output > 0 || error_x10 > 0)) {
+        remainder_x10_ms_ += static_cast<int32_t>(error_x10) * static_cast<int32_t>(dt_ms);
+        integral_x10_s_ += remainder_x10_ms_ / 1000;
+        remainder_x10_ms_ %= 1000;
+        integral_x10_s_ = cmax(static_cast<int32_t>(0), cmin(MaxIntegral(), integral_x10_s_));
+      }
+      const int32_t duty = proportional + IntegralPermille();
+      return cmax(static_cast<int32_t>(0), cmin(static_cast<int32_t>(kMaxDutyPermille), duty));
+    }
+
+    void Reset() {
+      integral_x10_s_ = 0;
+      remainder_x10_ms_ = 0;
+    }
+
+    // The integral part of the duty.
+    int16_t IntegralPermille() const {
+      return integral_x10_s_ * ki_permille_per_hour_ / 3600;
+    }
+
+  private:
+    // The integral which gives the full duty.
+    int32_t MaxIntegral() const {
+      return ki_permille_per_hour_ == 0
+                 ? 0
+                 : static_cast<int32_t>(kMaxDutyPermille) * 3600 / ki_permille_per_hour_;
+    }
+
+    const uint8_t kp_permille_;
+    const uint8_t ki_permille_per_hour_;
+
+    // Error x10 seconds, with the part of a second not added yet.
+    int32_t integral_x10_s_ = 0;
+    int32_t remainder_x10_ms_ = 0;
+};
+
+// Turns a duty into on and off times over a fixed window, running the equipment at the
+// start of each window. The duty is taken at the start of the window. An on time shorter
+// than the minimum is skipped, and an off time shorter than the minimum is run through,
+// with the difference carried into the next window so the duty averages out.
+class TimeProportioner {
+  public:
+    TimeProportioner(const uint32_t window_ms, const uint32_t min_on_ms,
+                     const uint32_t min_off_ms) :
+      window_ms_(window_ms),
+      min_on_ms_(min_on_ms),
+      min_off_ms_(min_off_ms) {};
+
+    // Returns whether the equipment should be on.
+    bool Update(const int16_t duty_permille, const uint32_t now_ms) {
+      if (!started_ || Clock::MillisDiff(window_start_ms_, now_ms) >= window_ms_) {
+        StartWindow(duty_permille, now_ms);
+      }
+      return Clock::MillisDiff(window_start_ms_, now_ms) < on_ms_;
+    }
+
+    // Starts a new window on the next update.
+    void Reset() {
+      started_ = false;
+      carry_ms_ = 0;
+    }
+
+  private:
+    void StartWindow(const int16_t duty_permille, const uint32_t now_ms) {
+      started_ = true;
+      window_start_ms_ = now_ms;
+
+      const int32_t window_ms = window_ms_;
+      const int32_t wanted_ms = window_ms / kMaxDutyPermille * duty_permille + carry_ms_;
+      int32_t on_ms = cmax(static_cast<int32_t>(0), cmin(window_ms, wanted_ms));
+      if (on_ms < static_cast<int32_t>(min_on_ms_)) {
+        on_ms = 0;
+      } else if (window_ms - on_ms < static_cast<int32_t>(min_off_ms_)) {
+        on_ms = window_ms;
+      }
+      carry_ms_ = cmax(-window_ms, cmin(window_ms, wanted_ms - on_ms));
+      on_ms_ = on_ms;
+    }
+
+    const uint32_t window_ms_;
+    const uint32_t min_on_ms_;
+    const uint32_t min_off_ms_;
+
+    bool started_ = false;
+    uint32_t window_start_ms_ = 0;
+    uint32_t on_ms_ = 0;
+    // On time owed to (or by) the next windows.
+    int32_t carry_ms_ = 0;
+};
+
+}  // namespace thermostat
+#endif  // PI_CONTROLLER_H_
@@ -0,0 +1,101 @@
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+// Composes the ThermostatTask decorator layers at compile time.
+//
+// Wired through ThermostatTask pointers, every layer calls the next one through the
+// virtual RunOnce, which the compiler can't inline. A Pipeline names the concrete type of
+// each layer instead, so each RunOnce calls the next one directly and the whole chain
+// can be inlined into the outermost RunOnce. These layers have no vtables either, which
+// would otherwise keep a copy of every partially inlined chain in flash:
+//
+//   typedef Pipeline<WrapperThermostatTask, PacingLayer, HvacControllerLayer> Chain;
+//
+//   WrapperThermostatTask wrapper;
+//   Chain::Of<HvacControllerLayer> hvac(&clock, &print, &wrapper);
+//   Chain::Of<PacingLayer> pacing(&clock, &hvac);
+//   pacing.RunOnce(&settings);
+//
+// The layers are listed from the outermost to the innermost, each template taking the
+// type of the layer it wraps. Each layer can only appear once.
+
+#include "interfaces.h"
+
+namespace thermostat {
+
+// Base class of the decorator layers. A layer wrapping any ThermostatTask is a
+// ThermostatTask itself, so it can be wrapped the same way. A layer wrapping a concrete
+// type is a plain class, and its RunOnce isn't virtual.
+template <typename Next>
+class LayerBase {};
+
+template <>
+class LayerBase<ThermostatTask> : public ThermostatTask {};
+
+// Picks one of the types, since the AVR has no <type_traits>.
+template <bool kFirst, typename First, typename Second>
+struct SelectType {
+  typedef First Type;
+};
+
+template <typename First, typename Second>
+struct SelectType<false, First, Second> {
+  typedef Second Type;
+};
+
+template <template <typename> class A, template <typename> class B>
+struct IsSameLayer {
+  static constexpr bool value = false;
+};
+
+template <template <typename> class A>
+struct IsSameLayer<A, A> {
+  static constexpr bool value = true;
+};
+
+template <typename Innermost, template <typename> class... Layers>
+class Pipeline;
+
+template <typename Innermost>
+class Pipeline<Innermost> {
+  public:
+    typedef Innermost Outermost;
+
+    // Not in the pipeline.
+    template <template <typename> class Layer>
+    using Of = void;
+};
+
+template <typename Innermost, template <typename> class Outer,
+          template <typename> class... Inner>
+class Pipeline<Innermost, Outer, Inner...> {
+  private:
+    typedef Pipeline<Innermost, Inner...> Rest;
+
+  public:
+    // The type of the first layer, which wraps all the others.
+    typedef Outer<typename Rest::Outermost> Outermost;
+
+    // The type of the given layer wrapping the layers after it.
+    template <template <typename> class Layer>
+    using Of = typename SelectType<IsSameLayer<Layer, Outer>::value, Outermost,
+                                   typename Rest::template Of<Layer>>::Type;
+};
+
+// Runs a statically composed chain through the ThermostatTask interface, for callers
+// such as the Scheduler which hold several different chains.
+template <typename Chain>
+class ChainTask final : public ThermostatTask {
+  public:
+    explicit ChainTask(Chain* const chain) :
+      chain_(chain) {};
+
+    Status RunOnce(Settings* settings) override {
+      return chain_->RunOnce(settings);
+    }
+
+  private:
+    Chain* const chain_;
+};
+
+}  // namespace thermostat
+#endif  // PIPELINE_H_
@@ -49,6 +49,7 @@ class Print {
     void print(unsigned long value);
     void println(unsigned long value);
 
+    // Inline so the floating point code is only built into callers that use it.
     void print(double value);
     void println(double value);
 
@@ -82,7 +83,7 @@ void Print::println(const char* chars) {
   println();
 }
 
-void Print::print(double value) {
+inline void Print::print(double value) {
   // Negative values.
   if (value < 0.0) {
     print('-');
@@ -102,7 +103,7 @@ void Print::print(double value) {
   print(remainder);
 }
 
-void Print::println(double value) {
+inline void Print::println(double value) {
   print(value);
   println();
 }
@@ -134,6 +135,13 @@ void Print::println(unsigned long value) {
   println();
 }
 
+// Discards everything, for the debugging text that would otherwise be mixed into the
+// telemetry stream.
+class NullPrint : public Print {
+  public:
+    void write(uint8_t) override {};
+};
+
 } // namespace thermostat
 
 #endif // PRINT_H_
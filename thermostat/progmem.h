@@ -0,0 +1,20 @@
+#ifndef PROGMEM_H_
+#define PROGMEM_H_
+// Constant tables kept in flash on AVR, where RAM is scarce. Reading them needs the
+// pgm_read_* helpers, which become plain reads on the host.
+
+#ifdef ARDUINO
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+
+static uint8_t pgm_read_byte(const void* const address) {
+  return *static_cast<const uint8_t*>(address);
+}
+
+static uint16_t pgm_read_word(const void* const address) {
+  return *static_cast<const uint16_t*>(address);
+}
+#endif
+
+#endif  // PROGMEM_H_
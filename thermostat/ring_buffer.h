@@ -0,0 +1,69 @@
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+// Lock-free queue between one producer and one consumer, such as an interrupt handler
+// and the main loop.
+//
+// Each index is only written by one side. The item is stored before the producer
+// publishes the new head, and read before the consumer publishes the new tail, with
+// release/acquire ordering so neither side sees a half written item. The indices are
+// single bytes, which the AVR loads and stores atomically, so no interrupts need to be
+// disabled.
+
+namespace thermostat {
+
+// The capacity must be a power of two, up to 128, so the free running byte indices wrap
+// around on an item boundary.
+template <typename T, uint8_t kCapacity>
+class SpscRing {
+  static_assert(kCapacity > 0 && kCapacity <= 128 && (kCapacity & (kCapacity - 1)) == 0,
+                "The capacity must be a power of two up to 128");
+
+  public:
+    // Called only by the producer. Returns false and drops the item when full.
+    bool Push(const T& item) {
+      const uint8_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+      const uint8_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+      if (static_cast<uint8_t>(head - tail) == kCapacity) {
+        const uint8_t dropped = __atomic_load_n(&dropped_, __ATOMIC_RELAXED);
+        if (dropped < 0xFF) {
+          __atomic_store_n(&dropped_, static_cast<uint8_t>(dropped + 1), __ATOMIC_RELAXED);
+        }
+        return false;
+      }
+      items_[head & (kCapacity - 1)] = item;
+      __atomic_store_n(&head_, static_cast<uint8_t>(head + 1), __ATOMIC_RELEASE);
+      return true;
+    }
+
+    // Called only by the consumer. Returns false when empty.
+    bool Pop(T* const item) {
+      const uint8_t tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+      const uint8_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+      if (head == tail) {
+        return false;
+      }
+      *item = items_[tail & (kCapacity - 1)];
+      __atomic_store_n(&tail_, static_cast<uint8_t>(tail + 1), __ATOMIC_RELEASE);
+      return true;
+    }
+
+    // Items waiting, which can only grow while the consumer looks.
+    uint8_t size() const {
+      return __atomic_load_n(&head_, __ATOMIC_ACQUIRE) -
+             __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+    }
+
+    // Items dropped because the consumer fell behind, saturating at 255.
+    uint8_t dropped() const {
+      return __atomic_load_n(&dropped_, __ATOMIC_RELAXED);
+    }
+
+  private:
+    T items_[kCapacity] = {};
+    uint8_t head_ = 0;
+    uint8_t tail_ = 0;
+    uint8_t dropped_ = 0;
+};
+
+}  // namespace thermostat
+#endif  // RING_BUFFER_H_
@@ -0,0 +1,169 @@
+#ifndef SCHEDULE_H_
+#define SCHEDULE_H_
+// Weekly setpoint schedule.
+//
+// Each setpoint applies on a set of days, so a weekday and a weekend pattern take one
+// setpoint per change rather than one per day. WeeklySchedule::Compile sorts the
+// setpoints by their time of day whenever they change. The lookups keep a cursor on the
+// setpoint in effect and the one after it, so each control cycle only compares the time
+// against the next start, and the cursor only moves once the time crosses it.
+
+#include "interfaces.h"
+
+namespace thermostat {
+
+// How many setpoints each of the heat and cool schedules holds. Overridable at build
+// time. 4 fit a weekday and a weekend pattern with two changes a day each.
+#ifndef THERMOSTAT_SCHEDULE_SIZE
+#define THERMOSTAT_SCHEDULE_SIZE 4
+#endif
+constexpr uint8_t kScheduleSize = THERMOSTAT_SCHEDULE_SIZE;
+static_assert(kScheduleSize > 0 && kScheduleSize <= 36,
+              "The week of transitions must fit a uint8_t position");
+
+constexpr uint16_t kMinutesPerDay = 24 * 60;
+constexpr uint16_t kMinutesPerWeek = 7 * kMinutesPerDay;
+
+// Day masks, with bit 0 for Sunday like Date::day_of_week.
+constexpr uint8_t kEveryDay = 0x7F;
+constexpr uint8_t kWeekdays = 0x3E;
+constexpr uint8_t kWeekend = 0x41;
+
+struct Setpoint {
+  // 0 when the setpoint isn't used.
+  int16_t temperature_x10 = 0;
+  uint8_t hour = 0;
+  uint8_t minute = 0;
+  // The days the setpoint starts on, none when it isn't used.
+  uint8_t days = kEveryDay;
+
+  bool used() const {
+    return days != 0 && temperature_x10 != 0;
+  }
+
+  uint16_t minute_of_day() const {
+    return hour * 60 + minute;
+  }
+};
+
+// Minutes since Sunday midnight.
+static uint16_t WeekMinute(const Date& date) {
+  return date.day_of_week * kMinutesPerDay + date.hour * 60 + date.minute;
+}
+
+// The used setpoints in the order they start in a day, with a cursor on the week's
+// transitions. A transition is a position day * kScheduleSize + index into the order.
+//
+// The schedule only keeps indexes, so the lookups take the setpoints it was compiled
+// from. The cursor is a cache, so the lookups are const.
+class WeeklySchedule {
+  public:
+    // Sorts the used setpoints. Call after loading or changing them.
+    void Compile(const Setpoint* const setpoints) {
+      count_ = 0;
+      for (uint8_t i = 0; i < kScheduleSize; ++i) {
+        if (!setpoints[i].used()) {
+          continue;
+        }
+        uint8_t j = count_++;
+        for (; j > 0 && setpoints[order_[j - 1]].minute_of_day() > setpoints[i].minute_of_day();
+             --j) {
+          order_[j] = order_[j - 1];
+        }
+        order_[j] = i;
+      }
+      if (count_ == 0) {
+        return;
+      }
+      // Start on the week's first transition, the first lookup moves on from there.
+      current_ = Following(setpoints, kPositions - 1);
+      next_ = Following(setpoints, current_);
+    }
+
+    // The temperature of the setpoint in effect at week_minute. Returns false without
+    // any used setpoints.
+    bool Current(const Setpoint* const setpoints, const uint16_t week_minute,
+                 int16_t* const temperature_x10) const {
+      if (!Seek(setpoints, week_minute)) {
+        return false;
+      }
+      *temperature_x10 = At(setpoints, current_).temperature_x10;
+      return true;
+    }
+
+    // The setpoint after the one in effect at week_minute, and the minutes until it
+    // starts. Returns false without any used setpoints.
+    bool Next(const Setpoint* const setpoints, const uint16_t week_minute,
+              int16_t* const temperature_x10, uint16_t* const minutes_until) const {
+      if (!Seek(setpoints, week_minute)) {
+        return false;
+      }
+      *temperature_x10 = At(setpoints, next_).temperature_x10;
+      // A single transition a week is next again a week later.
+      const uint16_t until = MinutesBetween(week_minute, Start(setpoints, next_));
+      *minutes_until = until == 0 ? kMinutesPerWeek : until;
+      return true;
+    }
+
+  private:
+    static constexpr uint8_t kPositions = 7 * kScheduleSize;
+
+    static uint16_t MinutesBetween(const uint16_t from, const uint16_t to) {
+      return (to + kMinutesPerWeek - from) % kMinutesPerWeek;
+    }
+
+    const Setpoint& At(const Setpoint* const setpoints, const uint8_t position) const {
+      return setpoints[order_[position % kScheduleSize]];
+    }
+
+    uint16_t Start(const Setpoint* const setpoints, const uint8_t position) const {
+      return (position / kScheduleSize) * kMinutesPerDay + At(setpoints, position).minute_of_day();
+    }
+
+    bool Active(const Setpoint* const setpoints, const uint8_t position) const {
+      return position % kScheduleSize < count_ &&
+             (At(setpoints, position).days >> (position / kScheduleSize)) & 1;
+    }
+
+    // The transition after position. Stays put if there is none, which only happens if
+    // the setpoints changed without a Compile.
+    uint8_t Following(const Setpoint* const setpoints, const uint8_t position) const {
+      uint8_t next = position;
+      for (uint8_t i = 0; i < kPositions; ++i) {
+        next = (next + 1) % kPositions;
+        if (Active(setpoints, next)) {
+          return next;
+        }
+      }
+      return position;
+    }
+
+    // Moves the cursor up to week_minute. Between two transitions this is a single
+    // comparison. After a clock change it walks at most a week of transitions.
+    bool Seek(const Setpoint* const setpoints, const uint16_t week_minute) const {
+      if (count_ == 0) {
+        return false;
+      }
+      for (uint8_t i = 0; i <= kPositions; ++i) {
+        const uint16_t start = Start(setpoints, current_);
+        uint16_t span = MinutesBetween(start, Start(setpoints, next_));
+        if (span == 0) {
+          span = kMinutesPerWeek;
+        }
+        if (MinutesBetween(start, week_minute) < span) {
+          break;
+        }
+        current_ = next_;
+        next_ = Following(setpoints, next_);
+      }
+      return true;
+    }
+
+    uint8_t order_[kScheduleSize] = {0};
+    uint8_t count_ = 0;
+    mutable uint8_t current_ = 0;
+    mutable uint8_t next_ = 0;
+};
+
+}  // namespace thermostat
+#endif  // SCHEDULE_H_
@@ -0,0 +1,200 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+// Cooperative scheduler which runs each thermostat task at its own period.
+//
+// Instead of running the whole decorator chain on one cadence, the chain is split into
+// tasks such as the relay control, the display refresh and the history pruning, and each
+// one only runs when its period elapsed. The tasks run from the main loop in the order
+// given, so nothing preempts and a task starts late by however long the loop took since
+// it became due. That lateness is recorded per task to show the scheduling jitter.
+
+#include "interfaces.h"
+#include "print.h"
+#include "settings.h"
+#include "timing.h"
+
+namespace thermostat {
+
+// How late the runs of a task started, in microseconds.
+class JitterStats {
+  public:
+    void Record(const uint32_t late_us, const bool missed) {
+      late_.Record(late_us);
+      max_late_us_ = late_us > max_late_us_ ? late_us : max_late_us_;
+      if (missed && missed_ < 0xFFFF) {
+        missed_++;
+      }
+    }
+
+    void Reset() {
+      *this = JitterStats();
+    }
+
+    uint16_t runs() const {
+      return late_.count();
+    }
+
+    // Runs which started later than the deadline.
+    uint16_t missed() const {
+      return missed_;
+    }
+
+    uint32_t mean_late_us() const {
+      return late_.mean_us();
+    }
+
+    uint32_t max_late_us() const {
+      return max_late_us_;
+    }
+
+  private:
+    // Only the mean and max. The min and histogram of a TimingStats would cost 36 more
+    // bytes of RAM per task.
+    RunningMean late_;
+    uint32_t max_late_us_ = 0;
+    uint16_t missed_ = 0;
+};
+
+// A task and when it should run.
+struct ScheduledTask {
+  // The name starts the task's line on the jitter status page, ahead of its mean/max
+  // lateness, so a short one keeps that line on the display.
+  //
+  // A run starting more than deadline_ms after the task became due counts as missed.
+  // With run_on_change the task also runs right away when the settings changed, such as
+  // the fan being turned on from the menu.
+  ScheduledTask(const char* const name, ThermostatTask* const task, const uint32_t period_ms,
+                const uint32_t deadline_ms, const bool run_on_change) :
+    name(name),
+    task(task),
+    period_ms(period_ms),
+    deadline_ms(deadline_ms),
+    run_on_change(run_on_change) {};
+
+  const char* const name;
+  ThermostatTask* const task;
+  const uint32_t period_ms;
+  const uint32_t deadline_ms;
+  const bool run_on_change;
+
+  // When the next periodic run is due, from Clock::Micros().
+  uint32_t due_us = 0;
+  JitterStats jitter;
+};
+
+// Runs the scheduled tasks that are due. This replaces the PacingThermostatTask as the
+// entry point called from the main loop.
+class Scheduler final : public ThermostatTask {
+  public:
+    // The print is where Dump() writes to.
+    Scheduler(Clock* const clock, Print* const print, ScheduledTask* const tasks,
+              const uint8_t task_count) :
+      clock_(clock),
+      print_(print),
+      tasks_(tasks),
+      task_count_(task_count) {};
+
+    // Returns kSkipped when nothing was due, otherwise the first error of the tasks run.
+    Status RunOnce(Settings* settings) override {
+      const uint32_t now_us = clock_->Micros();
+      const bool changed = settings->changed;
+      Status result = Status::kSkipped;
+
+      for (uint8_t i = 0; i < task_count_; ++i) {
+        ScheduledTask* const task = &tasks_[i];
+        // Everything runs on the first call, so each task sees the first_run.
+        const int32_t late_us = settings->first_run
+                                    ? 0
+                                    : static_cast<int32_t>(now_us - task->due_us);
+        const bool due = late_us >= 0;
+        if (!due && !(changed && task->run_on_change)) {
+          continue;
+        }
+
+        // The tasks read the time from the settings, as with the pacing.
+        settings->now = clock_->Millis();
+        const Status status = task->task->RunOnce(settings);
+        if (result == Status::kSkipped || (result == Status::kOk && status != Status::kSkipped)) {
+          result = status;
+        }
+
+        if (!due) {
+          // An extra run for the changed settings restarts the period.
+          task->due_us = now_us + task->period_ms * 1000;
+          continue;
+        }
+        const uint32_t period_us = task->period_ms * 1000;
+        task->jitter.Record(late_us, static_cast<uint32_t>(late_us) > task->deadline_ms * 1000);
+        // Keep to the original grid so the lateness doesn't accumulate, unless a whole
+        // period was missed, which is dropped rather than run back to back.
+        task->due_us += period_us;
+        if (static_cast<int32_t>(now_us - task->due_us) >= 0) {
+          task->due_us = now_us + period_us;
+        }
+      }
+
+      // Clear the settings initialization default of true.
+      settings->first_run = false;
+      return result;
+    }
+
+    // How long until the next periodic run is due, zero when one is due already. Only
+    // valid after the first RunOnce, which runs everything.
+    uint32_t MicrosUntilDue(const uint32_t now_us) const {
+      uint32_t until_us = 0xFFFFFFFF;
+      for (uint8_t i = 0; i < task_count_; ++i) {
+        const int32_t left_us = static_cast<int32_t>(tasks_[i].due_us - now_us);
+        if (left_us <= 0) {
+          return 0;
+        }
+        until_us = static_cast<uint32_t>(left_us) < until_us ? left_us : until_us;
+      }
+      return until_us;
+    }
+
+    uint8_t task_count() const {
+      return task_count_;
+    }
+
+    const ScheduledTask& task(const uint8_t index) const {
+      return tasks_[index];
+    }
+
+    // Writes the period, run count, missed deadlines and mean/max lateness of each task,
+    // one line per task. The zero byte at the end is the same frame break as in
+    // Timings::Dump().
+    void Dump() const {
+      print_->println("name period runs missed mean max us late");
+      for (uint8_t i = 0; i < task_count_; ++i) {
+        const JitterStats& jitter = tasks_[i].jitter;
+        print_->print(tasks_[i].name);
+        print_->print(' ');
+        print_->print(tasks_[i].period_ms);
+        print_->print(' ');
+        print_->print(static_cast<unsigned int>(jitter.runs()));
+        print_->print(' ');
+        print_->print(static_cast<unsigned int>(jitter.missed()));
+        print_->print(' ');
+        print_->print(jitter.mean_late_us());
+        print_->print(' ');
+        print_->print(jitter.max_late_us());
+        print_->println();
+      }
+      print_->write(0);
+    }
+
+    void Reset() {
+      for (uint8_t i = 0; i < task_count_; ++i) {
+        tasks_[i].jitter.Reset();
+      }
+    }
+
+  private:
+    Clock* const clock_;
+    Print* const print_;
+    ScheduledTask* const tasks_;
+    const uint8_t task_count_;
+};
+
+}  // namespace thermostat
+#endif  // SCHEDULER_H_
@@ -2,33 +2,33 @@
 #define SETTINGS_H_
 // This header implements the object and helper functions to store user settings and HVAC control and status information.
 
+#include <stddef.h>
+
 #include "interfaces.h"
 #include "comparison.h"
+#include "event_log.h"
+#include "schedule.h"
 
 
 namespace thermostat {
 
 // 65536 is the largest representable value.
-constexpr uint16_t VERSION = 34808;
-
-// How many Fan/Hvac updates to store.
-constexpr uint8_t EVENT_SIZE = 24;
+constexpr uint16_t VERSION = 34810;
 
-enum class HvacMode {EMPTY, IDLE, HEAT, COOL, HEAT_LOCKOUT, COOL_LOCKOUT};
-enum class FanMode {EMPTY, ON, OFF};
+// How many Fan/Hvac updates to store. Overridable at build time (up to 255) for
+// benchmarking larger histories. 55 packed events take the same RAM as the 24 unpacked
+// ones used to.
+#ifndef THERMOSTAT_EVENT_SIZE
+#define THERMOSTAT_EVENT_SIZE 55
+#endif
+constexpr uint8_t EVENT_SIZE = THERMOSTAT_EVENT_SIZE;
 
 constexpr char daysOfTheWeek[7][3] = {"Su", "Mo", "Tu", "We", "Th", "Fr", "Sa"};
 
-struct Setpoint {
-  uint8_t hour = 0;
-  uint8_t minute = 0;
-  int temperature_x10 = 0;
-};
-
-
 struct PersistedSettings {
   PersistedSettings()
-    : heat_enabled(true), cool_enabled(true), fan_always_on(false), humidity(30) {};
+    : heat_enabled(true), cool_enabled(true), fan_always_on(false), adaptive_recovery(false),
+      humidity(30) {};
   uint16_t version;
 
   // Is heating enabled.
@@ -40,15 +40,19 @@ struct PersistedSettings {
   // User configured fan setting.
   uint8_t fan_always_on : 1;
 
+  // Start heating ahead of a warmer setpoint so it's reached on time.
+  uint8_t adaptive_recovery : 1;
+
   // RH to set the humidifier to. 0 = Off, 100%=On.
   uint8_t humidity : 7;
 
   // Humidifier: [0] 50% humidity, [1] = 15% humidity. Value is the % time heat running.
   uint8_t humidity_steps[2];
 
-  Setpoint heat_setpoints[2];
-  Setpoint cool_setpoints[2];
-  int tolerance_x10 = 15;  // 1.5 degrees above and below.
+  // The weekly schedules, see schedule.h. Call CompileSchedules after changing them.
+  Setpoint heat_setpoints[kScheduleSize];
+  Setpoint cool_setpoints[kScheduleSize];
+  int16_t tolerance_x10 = 15;  // 1.5 degrees above and below.
 
   uint16_t fan_extend_mins = 0;
   // Run minimum 15% duty cycle (30 mins) every 3 hours.
@@ -56,69 +60,92 @@ struct PersistedSettings {
   uint8_t fan_on_duty = 0; // 0 (OFF) - 99%
 };
 
-// List of events for temperature change calculations.
-class Event {
-  public:
-    Event() : hvac(HvacMode::EMPTY), fan(FanMode::EMPTY) {}
-
-    bool empty() const {
-      return hvac == HvacMode::EMPTY && fan == FanMode::EMPTY;
-    }
-
-    void set_empty() {
-      hvac = HvacMode::EMPTY;
-      fan = FanMode::EMPTY;
-      temperature_x10 = 0;
-      temperature_10min_x10 = 0;
-    }
-
-    HvacMode hvac = HvacMode::IDLE;
-    FanMode fan = FanMode::OFF;
-
-    // The temperature when the event occurred.
-    int16_t temperature_x10;
-    int16_t temperature_10min_x10;
-    uint32_t start_time;
+// Running totals of the closed events overlapping the last day, so the status queries
+// don't need to scan every event. HistoryUpdatingThermostatTask keeps these in sync as
+// events open and close, see events.h.
+struct EventTotals {
+  // Full durations of the closed events from the tail up to the open event.
+  uint32_t heat_ms = 0;
+  uint32_t cool_ms = 0;
+  uint32_t fan_ms = 0;
+
+  // Sum and count of the 10 minute temperature rises of the closed heat events.
+  int32_t heat_rise_x10 = 0;
+  uint8_t heat_rise_count = 0;
+
+  // Age of the oldest closed event in the totals, 0 when there is none.
+  uint8_t tail_age = 0;
+  // When the tail event started.
+  uint32_t tail_start = 0;
 };
 
+// All the mutable state of one thermostat. This is the context passed to every
+// ThermostatTask::RunOnce call, so tasks keep no process-global state and several
+// thermostats can run side by side (multiple zones or parallel simulations).
+//
+// The fields are ordered from the widest to the narrowest, so the host build doesn't pad
+// between them, and use fixed width types. The host still adds alignment padding inside
+// some of the structs, such as Setpoint and EventTotals, so the AVR and host sizes differ
+// and the budgets below check each one. Check the layout with tools/settings_layout after
+// adding a field.
 struct Settings {
-  bool first_run = true;
-  
-  // The settings have had a recently changed field.
-  //
-  // Use SetChanged() to update EEPROM data and this bit.
-  bool changed : 1;  // one bit.
-  bool heat_high : 1; // one bit, indicating heat should be heat high mode.
-  bool within_tolerance : 1;
-
-  // TODO(): Use these instead of the booleans. These are currently
-  // not used.
-  HvacMode hvac = HvacMode::IDLE;
+  Settings()
+    : first_run(true), changed(false), heat_high(false), within_tolerance(false),
+      low_memory(false) {};
 
-  FanMode fan;
+  EventLog<EVENT_SIZE> events;
+  EventTotals event_totals;
 
   // Current time.
   uint32_t now = 0;
 
-  // Snapshot of current humidity.
-  uint8_t current_humidity = 0;
+  uint32_t override_temperature_started_ms = 0;
+
+  PersistedSettings persisted;
 
   // Snapshot of the current temperature.
-  int current_temperature_x10 = 0;
-  int current_bme_temperature_x10 = 0;
-  int current_mean_temperature_x10 = 0;
+  int16_t current_temperature_x10 = 0;
+  int16_t current_mean_temperature_x10 = 0;
 
-  int override_temperature_x10 = 0;
-  uint32_t override_temperature_started_ms = 0;
+  // The heat setpoint the HvacControllerThermostatTask is holding, including an adaptive
+  // recovery.
+  int16_t heat_setpoint_x10 = 0;
 
-  uint16_t average_run_seconds;
-  uint16_t average_off_seconds;
+  int16_t override_temperature_x10 = 0;
 
-  float air_quality_score;
+  // Free RAM at the last scan, and the fewest free bytes since boot.
+  uint16_t free_memory_bytes = 0;
+  uint16_t min_free_memory_bytes = 0;
 
-  uint8_t event_index = 0;
+  // The persisted setpoints sorted into their weekly transitions.
+  WeeklySchedule heat_schedule;
+  WeeklySchedule cool_schedule;
 
-  Event events[EVENT_SIZE];
+  HvacMode hvac = HvacMode::IDLE;
+
+  FanMode fan;
+
+  // Error status latched until the thermostat is reset.
+  Status status = Status::kOk;
+
+  // Snapshot of current humidity.
+  uint8_t current_humidity = 0;
+
+  // Indoor air quality, 0 = bad and 100 = excellent.
+  uint8_t air_quality_score = 0;
+
+  // Cleared after the first pass through the tasks.
+  bool first_run : 1;
+
+  // The settings have had a recently changed field.
+  //
+  // Use SetChanged() to update EEPROM data and this bit.
+  bool changed : 1;  // one bit.
+  bool heat_high : 1; // one bit, indicating heat should be heat high mode.
+  bool within_tolerance : 1;
+  // The stack has come within kLowMemoryBytes of the heap. Only a warning, the HVAC keeps
+  // running.
+  bool low_memory : 1;
 
   HvacMode GetHvacMode() const {
     return hvac;
@@ -127,33 +154,73 @@ struct Settings {
   FanMode GetFanMode() const {
     return fan;
   }
+};
 
-  int CurrentEventIndex() const {
-    if (events[event_index].empty()) {
-      return -1;
-    }
-    return event_index;
-  }
+// RAM budgets, which fail the build when a change grows the settings. The event log is
+// left out since its size follows EVENT_SIZE. PersistedSettings is also the EEPROM
+// record, so a change to its size needs a new VERSION. The budgets are for the default
+// schedule size.
+#if THERMOSTAT_SCHEDULE_SIZE == 4
+#if defined(__AVR__)
+static_assert(sizeof(PersistedSettings) == 53, "PersistedSettings layout changed");
+static_assert(sizeof(EventTotals) == 22, "EventTotals layout changed");
+static_assert(sizeof(Settings) - sizeof(EventLog<EVENT_SIZE>) == 115,
+              "Settings grew, see tools/settings_layout");
+#else
+static_assert(sizeof(PersistedSettings) == 62, "PersistedSettings layout changed");
+static_assert(sizeof(EventTotals) == 24, "EventTotals layout changed");
+static_assert(sizeof(Settings) - sizeof(EventLog<EVENT_SIZE>) == 128,
+              "Settings grew, see tools/settings_layout");
+// Nothing is padded in between the fields of Settings itself.
+static_assert(offsetof(Settings, event_totals) == sizeof(EventLog<EVENT_SIZE>),
+              "EventTotals is padded");
+static_assert(offsetof(Settings, persisted) ==
+              offsetof(Settings, override_temperature_started_ms) + sizeof(uint32_t),
+              "PersistedSettings is padded");
+static_assert(offsetof(Settings, current_temperature_x10) ==
+              offsetof(Settings, persisted) + sizeof(PersistedSettings),
+              "The temperatures are padded");
+#endif  // __AVR__
+#endif  // THERMOSTAT_SCHEDULE_SIZE == 4
 
-  int PrevEventIndex(int index) {
-    if (index == -1) {
-      return -1;
-    }
-    uint8_t unsigned_index = index;
-    if (events[unsigned_index].empty()) {
-      return -1;
-    }
-    if (events[(unsigned_index - 1) % EVENT_SIZE].empty()) {
-      return -1;
-    }
-    return (unsigned_index - 1) % EVENT_SIZE;
-  }
+static int GetSetpointTemp(const Settings& settings, const Date& date, HvacMode mode);
 
-  PersistedSettings persisted;
-};
+// The out of the box settings used when no valid copy has been persisted.
+static PersistedSettings DefaultPersistedSettings() {
+  PersistedSettings defaults;
+  defaults.version = VERSION;
+  // 7am-9pm -> 70.0° ; 9pm-7am -> 69°
+  defaults.heat_setpoints[0].hour = 7;
+  defaults.heat_setpoints[0].temperature_x10 = 695;
+  defaults.heat_setpoints[1].hour = 21;
+  defaults.heat_setpoints[1].temperature_x10 = 685;
+
+  // 7am-9pm -> 77.0° ; 9pm-7am -> 72°
+  defaults.cool_setpoints[0].hour = 7;
+  defaults.cool_setpoints[0].temperature_x10 = 770;
+  defaults.cool_setpoints[1].hour = 21;
+  defaults.cool_setpoints[1].temperature_x10 = 750;
+
+  // heating/cooling enabled defaults.
+  defaults.cool_enabled = false;
+  defaults.heat_enabled = true;
+
+  // With a 1.2° tolerance.
+  //
+  // If the setpoint is 70.0° (1° tolerance), heat starts at 69.0 and stops at 70.0°. When cooling
+  // starts at 71.0°.
+  defaults.tolerance_x10 = 11;
 
+  defaults.fan_extend_mins = 0;
 
-static int GetSetpointTemp(const Settings& settings, const Date& date, HvacMode mode);
+  // Reach the 7am setpoint at 7am rather than starting to heat then.
+  defaults.adaptive_recovery = true;
+
+  // Recommend: minimum 15% duty cycle (30 mins) every 3 hours.
+  defaults.fan_on_min_period = 180;
+  defaults.fan_on_duty = 0; // 0 (OFF) - 99%
+  return defaults;
+}
 
 static bool IsOverrideTempActive(const Settings& settings) {
   return settings.override_temperature_x10 != 0;
@@ -177,35 +244,46 @@ static void SetOverrideTemp(int temp_x10, Settings* settings, const uint32_t now
   settings->override_temperature_started_ms = now;
 }
 
+// Sorts the persisted setpoints into the schedules. Call after loading or editing them.
+static void CompileSchedules(Settings* const settings) {
+  settings->heat_schedule.Compile(settings->persisted.heat_setpoints);
+  settings->cool_schedule.Compile(settings->persisted.cool_setpoints);
+}
+
 // Gets the current setpoint temperature based on current date and any set override.
 static int GetSetpointTemp(const Settings& settings, const Date& date, const HvacMode mode) {
   if (IsOverrideTempActive(settings)) {
     return GetOverrideTemp(settings);
   }
 
-  // TODO: Loop through the setpoints looking for a match, otherwise use the first one
-  // set. Find the setpoint time closest, but smaller than the current date.
-  uint16_t clock_minutes = date.hour * 60 + date.minute;
-
-  uint16_t smallest_diff = 0;
-  int temp = -1;
-
-  for (const Setpoint& setpoint : (mode == HvacMode::HEAT)
-       ? settings.persisted.heat_setpoints
-       : settings.persisted.cool_setpoints) {
-    uint16_t minutes = setpoint.hour * 60 + setpoint.minute;
-    // clock=18:00, set1=19:00, set2=23:00
-    //   diff1= 19-18 = 1
-    //   diff2=
-    const uint16_t diff = (clock_minutes > minutes)
-                          ? clock_minutes - minutes
-                          : ((24 * 60) - minutes) + clock_minutes;
-    if (temp == -1 || diff < smallest_diff) {
-      smallest_diff = diff;
-      temp = setpoint.temperature_x10;
-    }
+  // Without any setpoints this clamps to the lowest temperature.
+  int16_t temp = -1;
+  if (mode == HvacMode::HEAT) {
+    settings.heat_schedule.Current(settings.persisted.heat_setpoints, WeekMinute(date), &temp);
+  } else {
+    settings.cool_schedule.Current(settings.persisted.cool_setpoints, WeekMinute(date), &temp);
+  }
+  return cmax(400, cmin(999, static_cast<int>(temp)));
+}
+
+// Finds the next scheduled setpoint after the current one takes effect. Returns false
+// with an override active, since the override holds regardless of the schedule.
+static bool GetNextSetpoint(const Settings& settings, const Date& date, const HvacMode mode,
+                            int* const temperature_x10, uint16_t* const minutes_until) {
+  if (IsOverrideTempActive(settings)) {
+    return false;
+  }
+
+  int16_t temp = 0;
+  const bool found = (mode == HvacMode::HEAT)
+      ? settings.heat_schedule.Next(settings.persisted.heat_setpoints, WeekMinute(date), &temp,
+                                    minutes_until)
+      : settings.cool_schedule.Next(settings.persisted.cool_setpoints, WeekMinute(date), &temp,
+                                    minutes_until);
+  if (found) {
+    *temperature_x10 = cmax(400, cmin(999, static_cast<int>(temp)));
   }
-  return cmax(400, cmin(999, temp));
+  return found;
 }
 
 }
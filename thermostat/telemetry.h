@@ -0,0 +1,143 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+// Compact binary telemetry records sent over Serial instead of the text logging.
+//
+// Each record is followed by its crc16 and COBS encoded, so the frame contains no zero
+// bytes, and a zero byte ends the frame. A reader can start anywhere in the stream and
+// resynchronize on the next zero. A frame is 19 bytes per cycle against the 100+ bytes of
+// the text logs, which blocked once the 64 byte UART buffer filled up at 38400 baud.
+//
+// Decode captured streams with tools/telemetry_to_csv.
+
+#include <string.h>
+
+#include "crc.h"
+#include "interfaces.h"
+#include "print.h"
+#include "settings.h"
+
+namespace thermostat {
+
+// Bump when the record layout changes.
+constexpr uint8_t kTelemetryVersion = 3;
+
+// Little endian, like both the AVR and the hosts decoding the stream.
+struct TelemetryRecord {
+  uint8_t version;
+  uint32_t now_ms;
+  int16_t temperature_x10;
+  int16_t mean_temperature_x10;
+  uint8_t humidity;
+  // HvacMode in the low nibble and FanMode in the high nibble, like PackedEvent.
+  uint8_t modes;
+  uint8_t status;
+  // kTelemetryHeatHigh | kTelemetryWithinTolerance.
+  uint8_t flags;
+  // The fewest free RAM bytes since boot.
+  uint16_t min_free_memory_bytes;
+} __attribute__((packed));
+
+constexpr uint8_t kTelemetryHeatHigh = 0x01;
+constexpr uint8_t kTelemetryWithinTolerance = 0x02;
+
+// Record and crc.
+constexpr uint8_t kTelemetryPayloadSize = sizeof(TelemetryRecord) + 2;
+// COBS adds one byte for payloads under 254 bytes, plus the zero delimiter.
+constexpr uint8_t kTelemetryFrameSize = kTelemetryPayloadSize + 2;
+
+// Encodes length (< 254) bytes so the output has no zeros. Returns the encoded length,
+// which is length + 1. The zero delimiter isn't added.
+static uint8_t CobsEncode(const uint8_t* const data, const uint8_t length,
+                          uint8_t* const out) {
+  uint8_t code_index = 0;
+  uint8_t out_index = 1;
+  uint8_t code = 1;
+  for (uint8_t i = 0; i < length; ++i) {
+    if (data[i] == 0) {
+      out[code_index] = code;
+      code_index = out_index++;
+      code = 1;
+      continue;
+    }
+    out[out_index++] = data[i];
+    code++;
+  }
+  out[code_index] = code;
+  return out_index;
+}
+
+// Decodes a frame without its zero delimiter. Returns the decoded length, or 0 when the
+// frame is malformed or doesn't fit in capacity bytes.
+static uint8_t CobsDecode(const uint8_t* const frame, const uint8_t length,
+                          uint8_t* const out, const uint8_t capacity) {
+  uint8_t in_index = 0;
+  uint8_t out_index = 0;
+  while (in_index < length) {
+    const uint8_t code = frame[in_index++];
+    if (code == 0 || in_index + code - 1 > length || out_index + code - 1 > capacity) {
+      return 0;
+    }
+    for (uint8_t i = 1; i < code; ++i) {
+      out[out_index++] = frame[in_index++];
+    }
+    // Every block but the last was followed by a zero.
+    if (in_index < length && code < 0xFF) {
+      if (out_index >= capacity) {
+        return 0;
+      }
+      out[out_index++] = 0;
+    }
+  }
+  return out_index;
+}
+
+static TelemetryRecord MakeTelemetryRecord(const Settings& settings, const Status status) {
+  TelemetryRecord record;
+  record.version = kTelemetryVersion;
+  record.now_ms = settings.now;
+  record.temperature_x10 = settings.current_temperature_x10;
+  record.mean_temperature_x10 = settings.current_mean_temperature_x10;
+  record.humidity = settings.current_humidity;
+  record.modes = static_cast<uint8_t>(settings.hvac) |
+                 (static_cast<uint8_t>(settings.fan) << 4);
+  record.status = static_cast<uint8_t>(status);
+  record.flags = (settings.heat_high ? kTelemetryHeatHigh : 0) |
+                 (settings.within_tolerance ? kTelemetryWithinTolerance : 0);
+  record.min_free_memory_bytes = settings.min_free_memory_bytes;
+  return record;
+}
+
+// Writes the framed record, including the zero delimiter.
+static void WriteTelemetryFrame(const TelemetryRecord& record, Print* const print) {
+  uint8_t payload[kTelemetryPayloadSize];
+  memcpy(payload, &record, sizeof(record));
+  const uint16_t crc = Crc16(payload, sizeof(record));
+  payload[sizeof(record)] = crc & 0xFF;
+  payload[sizeof(record) + 1] = crc >> 8;
+
+  uint8_t frame[kTelemetryFrameSize];
+  const uint8_t length = CobsEncode(payload, sizeof(payload), frame);
+  for (uint8_t i = 0; i < length; ++i) {
+    print->write(frame[i]);
+  }
+  print->write(0);
+}
+
+// Decodes a frame without its zero delimiter. Returns false for damaged frames or
+// records from a different version.
+static bool DecodeTelemetryFrame(const uint8_t* const frame, const uint8_t length,
+                                 TelemetryRecord* const record) {
+  uint8_t payload[kTelemetryPayloadSize];
+  if (CobsDecode(frame, length, payload, sizeof(payload)) != sizeof(payload)) {
+    return false;
+  }
+  const uint16_t crc = payload[sizeof(*record)] | (payload[sizeof(*record) + 1] << 8);
+  if (Crc16(payload, sizeof(*record)) != crc) {
+    return false;
+  }
+  memcpy(record, payload, sizeof(*record));
+  return record->version == kTelemetryVersion;
+}
+
+}  // namespace thermostat
+#endif  // TELEMETRY_H_
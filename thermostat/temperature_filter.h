@@ -0,0 +1,110 @@
+#ifndef TEMPERATURE_FILTER_H_
+#define TEMPERATURE_FILTER_H_
+// Filters for the temperature readings the HVAC control acts on.
+//
+// Each filter takes one reading at a time with Add() and returns the filtered value. They
+// trade the noise rejection against how long the output takes to follow a change:
+//
+//   MovingAverageFilter<8>  2 * 8 + 6 bytes. Averages the noise down by 8, but follows a
+//                           change with a delay of 3.5 readings and passes every spike
+//                           through at 1/8 of its size.
+//   ExponentialFilter<2>    5 bytes. Similar noise rejection to the 8 reading average
+//                           with a 3 reading delay, using shifts instead of a division,
+//                           but passes a spike through at 1/4 of its size.
+//   MedianOf5Filter         12 bytes. Ignores single spikes entirely, with a 2 reading
+//                           delay, but only halves the noise.
+//
+// ExponentialFilter<2> is the default. On a simulated January week with noisy readings
+// (benchmarks:filter_benchmark_<name>, sizes on the host):
+//
+//   filter          state   10F spike  heat cycles
+//   average<8>      24 B       1.2F        202
+//   exponential<2>   8 B       2.5F        211
+//   median5         12 B       0.0F        247
+//
+// The median rejects a spike best, but its extra noise cycles the furnace about 17% more
+// often. The other two cycle within 5% of each other, and the exponential filter has a
+// third of the RAM. A spike also rarely reaches the filter, since a failed reading is
+// dropped by the sensor fusion before it gets here. Pick the median when a sensor gives
+// spikes that still pass as valid readings.
+
+namespace thermostat {
+
+// Mean of the last kSize readings, or of all the readings until there are kSize of them.
+template <uint8_t kSize>
+class MovingAverageFilter {
+  public:
+    int16_t Add(const int16_t value) {
+      if (count_ == kSize) {
+        sum_ -= window_[index_];
+      } else {
+        count_++;
+      }
+      window_[index_] = value;
+      sum_ += value;
+      index_ = (index_ + 1) % kSize;
+      return sum_ / count_;
+    }
+
+  private:
+    int16_t window_[kSize] = {0};
+    int32_t sum_ = 0;
+    uint8_t index_ = 0;
+    uint8_t count_ = 0;
+};
+
+// Single pole IIR low pass, which moves the output by 1/2^kShift of the difference to
+// each new reading. The state keeps kShift extra bits, so the small steps aren't lost
+// to rounding.
+template <uint8_t kShift>
+class ExponentialFilter {
+  static_assert(kShift >= 1 && kShift <= 8, "The shift must be from 1 to 8");
+
+  public:
+    int16_t Add(const int16_t value) {
+      if (!primed_) {
+        // Start from the first reading rather than ramping up from zero.
+        state_ = static_cast<int32_t>(value) << kShift;
+        primed_ = true;
+      } else {
+        state_ += value - (state_ >> kShift);
+      }
+      return (state_ + (static_cast<int32_t>(1) << (kShift - 1))) >> kShift;
+    }
+
+  private:
+    // The output scaled by 2^kShift.
+    int32_t state_ = 0;
+    bool primed_ = false;
+};
+
+// Median of the last 5 readings, or of all the readings until there are 5 of them.
+class MedianOf5Filter {
+  public:
+    int16_t Add(const int16_t value) {
+      window_[index_] = value;
+      index_ = (index_ + 1) % 5;
+      if (count_ < 5) {
+        count_++;
+      }
+
+      // Insertion sort a copy, which is fast for this few readings.
+      int16_t sorted[5];
+      for (uint8_t i = 0; i < count_; ++i) {
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > window_[i]; --j) {
+          sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = window_[i];
+      }
+      return sorted[count_ / 2];
+    }
+
+  private:
+    int16_t window_[5] = {0};
+    uint8_t index_ = 0;
+    uint8_t count_ = 0;
+};
+
+}  // namespace thermostat
+#endif  // TEMPERATURE_FILTER_H_
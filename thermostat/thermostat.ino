@@ -10,6 +10,10 @@
 // ========================================================================
 // ========================================================================
 
+// Uncomment to time the thermostat layers and the main loop. The timings are shown on the
+// last status page, where [SEL] dumps them over Serial.
+// #define THERMOSTAT_TIMING 1
+
 // Interfaces which include hardware abstraction layer.
 #include "interfaces.h"
 
@@ -22,17 +26,24 @@
 // Calculate indoor air quality.
 #include "calculate_iaq.h"
 
+#include "buffered_display.h"
 #include "buttons.h"
 #include "events.h"
+#include "fused_sensor.h"
+#include "idle.h"
 #include "menus.h"
+#include "pipeline.h"
+#include "ring_buffer.h"
+#include "scheduler.h"
 #include "settings.h"
 #include "thermostat_tasks.h"
+#include "timing.h"
 #include "settings_storer.h"
 
 
 // Interrupt Logic.
 //
-// This handles LCD backlight dimming.
+// This handles LCD backlight dimming and the button sampling.
 volatile uint16_t g_backlight_count = 10000;
 
 namespace {
@@ -78,6 +89,34 @@ SIGNAL(TIMER0_COMPA_vect) {
   }
 }
 
+// The LCD shield buttons are sampled by the ADC, triggered by the Timer0 overflow every
+// 1024us. Every fifth reading goes to the main loop through the ring, so the debouncing
+// runs on readings 5120us apart however long the thermostat tasks take. The ring holds
+// 160ms of readings.
+constexpr uint8_t kAdcDecimation = 5;
+constexpr uint16_t kButtonSamplePeriodUs = 1024 * kAdcDecimation;
+thermostat::SpscRing<uint16_t, 32> g_button_samples;
+
+void AdcSamplingSetup() {
+  // AVcc reference and the A0 input.
+  ADMUX = _BV(REFS0);
+  // Start a conversion on each Timer0 overflow.
+  ADCSRB = _BV(ADTS2);
+  // Enable with the interrupt and the auto trigger, and a 125kHz ADC clock.
+  ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+ISR(ADC_vect) {
+  static uint8_t conversions = 0;
+  // ADC reads the low and high bytes in the required order.
+  const uint16_t reading = ADC;
+  if (++conversions < kAdcDecimation) {
+    return;
+  }
+  conversions = 0;
+  g_button_samples.Push(reading);
+}
+
 }  // namespace
 
 // Ensure 'int' is 16 bits. If this assumption changes, it may cause code bugs.
@@ -89,8 +128,13 @@ static_assert(sizeof(double) == 4);
 using namespace thermostat;
 
 Output g_print;
+// Per cycle debugging text is discarded, since the Serial port carries the binary
+// telemetry. Pass &g_print instead (and swap the TelemetryThermostatTask for the
+// LoggingThermostatTask) to read it on a serial monitor.
+NullPrint g_debug_print;
 
-EepromSettingsStorer g_storer;
+AvrEeprom g_eeprom;
+LogSettingsStorer g_storer(&g_eeprom);
 
 // Restore the settings to use for the thermostat.
 Settings g_settings = GetEepromOrDefaultSettings(&g_storer);
@@ -99,27 +143,48 @@ Settings g_settings = GetEepromOrDefaultSettings(&g_storer);
 SsdRelays g_relays = SsdRelays();
 
 
+// Create the clock with the real time device.
+RealClock g_clock;
+
 // Create the sensors
 #ifdef DEV_BOARD
-  CannedSensor g_secondary_temp_sensor = CannedSensor(&g_print);
-  Dht22Sensor g_primary_sensor = Dht22Sensor(&g_print);
-//  BmeSensor g_primary_sensor = BmeSensor(&g_print);
+  Dht22Sensor g_primary_sensor = Dht22Sensor(&g_debug_print);
+//  BmeSensor g_primary_sensor = BmeSensor(&g_debug_print);
+
+// The dev board has no DS18B20, so the DHT22 is the only source. Only real sensors are
+// fused, a CannedSensor here would outweigh the room.
+FusedSource g_temperature_sources[] = {
+  {&g_primary_sensor, /*variance=*/25, Clock::SecondsToMillis(10)},
+};
 #else
-  // Create the temperature sensor.
-  DallasSensor g_secondary_temp_sensor = DallasSensor(&g_print);
+  // Create the temperature sensor. The 750ms 12 bit conversion finishes within the 1
+  // second control period.
+  DallasSensor g_secondary_temp_sensor = DallasSensor(&g_clock, Ds18b20Resolution::k12Bit);
   // Create the temperature/humidity sensor.
-  Dht22Sensor g_primary_sensor = Dht22Sensor(&g_print);
+  Dht22Sensor g_primary_sensor = Dht22Sensor(&g_debug_print);
+
+// The thermostat uses the temperature of both sensors, weighted by their noise. The DHT22
+// reads to ±0.5°F and the DS18B20 to ±0.2°F. A sensor which stops reading is dropped
+// after 10 seconds, and the other one carries on alone.
+FusedSource g_temperature_sources[] = {
+  {&g_primary_sensor, /*variance=*/25, Clock::SecondsToMillis(10)},
+  {&g_secondary_temp_sensor, /*variance=*/4, Clock::SecondsToMillis(10)},
+};
 #endif
-
-// Create the clock with the real time device.
-RealClock g_clock;
+FusedSensor g_fused_sensor(&g_clock, g_temperature_sources, sizeof(g_temperature_sources) / sizeof(g_temperature_sources[0]));
 
 // Create the LCD display output.
 Lcd g_lcd;
 
-Status GetSystemStatus() {
-  return g_status;
-}
+// Everything draws into this framebuffer, which only sends the changed characters to the
+// LCD when flushed.
+BufferedDisplay g_display(&g_lcd);
+
+// The free RAM, from the stack painted at boot.
+AvrMemory g_memory;
+
+// Debouncing and auto-press state for the LCD shield buttons.
+SampledButtons g_buttons(kButtonSamplePeriodUs);
 
 // Wire up the thermostat decorators. Each layer does one specific task which has significant advantages:
 // Pros:
@@ -141,24 +206,87 @@ Status GetSystemStatus() {
 // Normally shared_ptr/unique_ptr objects would be used, however for embedded AVR, avoiding malloc/new saves resources. Therefore global
 // objects for static memory usage accounting is used.
 WrapperThermostatTask wrapper_thermostat_task; // This is only for convenience, and could be removed by removing the wrapper from the last ThermostatTask.
-SensorUpdatingThermostatTask g_sensor_updating_thermostat_task(&g_clock, &g_primary_sensor, &g_secondary_temp_sensor, &g_print, &wrapper_thermostat_task);
-HvacControllerThermostatTask g_hvac_controller_thermostat_task(&g_clock, &g_print, &g_sensor_updating_thermostat_task);
-LockoutControllingThermostatTask g_lockout_controlling_thermostat_task(&g_hvac_controller_thermostat_task);
+#ifndef THERMOSTAT_TIMING
+// The control layers from the outermost to the innermost. Each layer calls the next one
+// directly, so the compiler can inline the whole chain.
+typedef Pipeline<WrapperThermostatTask,
+                 TelemetryLayer,
+                 HistoryUpdatingLayer,
+                 ErrorDisplayingLayer,
+                 MemoryMonitoringLayer,
+                 RelaySettingLayer,
+                 FanControllerLayer,
+                 HeatAdvancingLayer,
+                 LockoutControllingLayer,
+                 ControllerLayer,
+                 SensorUpdatingLayer> ControlPipeline;
+
+ControlPipeline::Of<SensorUpdatingLayer> g_sensor_updating_thermostat_task(&g_clock, &g_fused_sensor, &g_debug_print, &wrapper_thermostat_task);
+ControlPipeline::Of<ControllerLayer> g_hvac_controller_thermostat_task(&g_clock, &g_debug_print, &g_sensor_updating_thermostat_task);
+ControlPipeline::Of<LockoutControllingLayer> g_lockout_controlling_thermostat_task(&g_hvac_controller_thermostat_task);
+ControlPipeline::Of<HeatAdvancingLayer> g_heat_advancing_thermostat_task(&g_lockout_controlling_thermostat_task);
+ControlPipeline::Of<FanControllerLayer> g_fan_controller_thermostat_task(&g_clock, &g_debug_print, &g_heat_advancing_thermostat_task);
+ControlPipeline::Of<RelaySettingLayer> g_relay_setting_thermostat_task(&g_relays, &g_debug_print, &g_fan_controller_thermostat_task);
+ControlPipeline::Of<MemoryMonitoringLayer> g_memory_monitoring_thermostat_task(&g_memory, &g_relay_setting_thermostat_task);
+ControlPipeline::Of<ErrorDisplayingLayer> g_error_displaying_thermostat_task(&g_display, &g_debug_print, &g_memory_monitoring_thermostat_task);
+ControlPipeline::Of<HistoryUpdatingLayer> g_history_updating_thermostat_task(&g_error_displaying_thermostat_task);
+ControlPipeline::Of<TelemetryLayer> g_telemetry_thermostat_task(&g_print, &g_history_updating_thermostat_task);
+ChainTask<ControlPipeline::Outermost> g_control_chain_task(&g_telemetry_thermostat_task);
+ThermostatTask* const g_control_task = &g_control_chain_task;
+#else
+// The timed layers are wired through ThermostatTask pointers, since measuring a layer
+// needs the call boundaries that inlining would remove.
+SensorUpdatingThermostatTask g_sensor_updating_thermostat_task(&g_clock, &g_fused_sensor, &g_debug_print, &wrapper_thermostat_task);
+TimingThermostatTask g_sensor_timing(&g_clock, "Sensors", &g_sensor_updating_thermostat_task);
+ControllerThermostatTask g_hvac_controller_thermostat_task(&g_clock, &g_debug_print, &g_sensor_timing);
+TimingThermostatTask g_hvac_timing(&g_clock, "Hvac", &g_hvac_controller_thermostat_task);
+LockoutControllingThermostatTask g_lockout_controlling_thermostat_task(&g_hvac_timing);
 HeatAdvancingThermostatTask g_heat_advancing_thermostat_task(&g_lockout_controlling_thermostat_task);
-FanControllerThermostatTask g_fan_controller_thermostat_task(&g_clock, &g_print, &g_heat_advancing_thermostat_task);
-RelaySettingThermostatTask g_relay_setting_thermostat_task(&g_relays, &g_print, &GetSystemStatus, &g_fan_controller_thermostat_task);
-UpdateDisplayThermostatTask g_update_display_thermostat_task(&g_lcd, &g_print, &g_relay_setting_thermostat_task);
-ErrorDisplayingThermostatTask g_error_displaying_thermostat_task(&g_lcd, &g_print, &g_update_display_thermostat_task);
-HistoryUpdatingThermostatTask g_history_updating_thermostat_task(&g_error_displaying_thermostat_task);
-LoggingThermostatTask g_logging_thermostat_task(&g_print, &g_history_updating_thermostat_task);
-PacingThermostatTask g_pacing_thermostat_task(&g_clock, &g_logging_thermostat_task);
+FanControllerThermostatTask g_fan_controller_thermostat_task(&g_clock, &g_debug_print, &g_heat_advancing_thermostat_task);
+RelaySettingThermostatTask g_relay_setting_thermostat_task(&g_relays, &g_debug_print, &g_fan_controller_thermostat_task);
+TimingThermostatTask g_relay_timing(&g_clock, "Relays", &g_relay_setting_thermostat_task);
+MemoryMonitoringThermostatTask g_memory_monitoring_thermostat_task(&g_memory, &g_relay_timing);
+ErrorDisplayingThermostatTask g_error_displaying_thermostat_task(&g_display, &g_debug_print, &g_memory_monitoring_thermostat_task);
+// The error/spinner cell and the memory scan. The top row readings are the separate
+// Display task below, whose lateness is on the jitter status page.
+TimingThermostatTask g_status_timing(&g_clock, "Status", &g_error_displaying_thermostat_task);
+HistoryUpdatingThermostatTask g_history_updating_thermostat_task(&g_status_timing);
+TelemetryThermostatTask g_telemetry_thermostat_task(&g_print, &g_history_updating_thermostat_task);
+TimingThermostatTask g_chain_timing(&g_clock, "Chain", &g_telemetry_thermostat_task);
+ThermostatTask* const g_control_task = &g_chain_timing;
+
+// From the innermost layer outwards.
+TimingThermostatTask* const g_timing_layers[] = {
+  &g_sensor_timing, &g_hvac_timing, &g_relay_timing, &g_status_timing, &g_chain_timing};
+Timings g_timings(&g_clock, &g_print, g_timing_layers, sizeof(g_timing_layers) / sizeof(g_timing_layers[0]));
+#endif
 
-// Resulting CreateThermostatTask pointer.
-ThermostatTask* const g_thermostat_task = &g_pacing_thermostat_task;
+// The work which doesn't need to follow every control cycle runs at its own pace.
+UpdateDisplayThermostatTask g_update_display_thermostat_task(&g_display, &g_debug_print, &wrapper_thermostat_task);
+HistoryPruningThermostatTask g_history_pruning_thermostat_task(&wrapper_thermostat_task);
+IaqUpdatingThermostatTask g_iaq_updating_thermostat_task(&g_primary_sensor, &wrapper_thermostat_task);
+
+// Each task with its period and how late it may start in ms. The control and display
+// also run right away when a setting such as the fan changed from the menus.
+ScheduledTask g_scheduled_tasks[] = {
+  {"Control", g_control_task, 1000, 500, true},
+  {"Display", &g_update_display_thermostat_task, 250, 100, true},
+  {"Prune", &g_history_pruning_thermostat_task, Clock::MinutesToMillis(1), Clock::SecondsToMillis(10), false},
+  {"IAQ", &g_iaq_updating_thermostat_task, Clock::MinutesToMillis(5), Clock::MinutesToMillis(1), false},
+};
+Scheduler g_scheduler(&g_clock, &g_print, g_scheduled_tasks, sizeof(g_scheduled_tasks) / sizeof(g_scheduled_tasks[0]));
+
+// Sleeps between the main loop passes until a task is due or the button readings need
+// taking. Taking them every 5ms keeps up with the ADC interrupt, so a press is seen about
+// 15ms after it settles.
+IdleSleeper g_sleeper;
+Idler g_idler(&g_clock, &g_sleeper, &g_scheduler, /*poll_ms=*/5);
 
 void setup() {
   // Add an extra Timer0 interrupt for the backlight dimming.
   CustomInterruptSetup();
+  // Sample the buttons from the ADC interrupt.
+  AdcSamplingSetup();
 
   // Setup the relay ports.
   g_relays.SetUp();
@@ -166,10 +294,9 @@ void setup() {
   g_print.SetUp();
   Wire.begin();
 
-  // We use bme for humidity and indoor air quality.
-  g_primary_sensor.SetUp();
-  // We use dallas for temperature
-  g_secondary_temp_sensor.SetUp();
+  // Sets up the primary sensor, used for humidity and indoor air quality, and the dallas
+  // temperature sensor.
+  g_fused_sensor.SetUp();
 
   // Start handling interrupts.
   sei();
@@ -190,18 +317,32 @@ Button WaitForButtonPress(const uint32_t timeout) {
 
   while (button == Button::NONE) {
 
-    // Keep calling the layered thermostat decorators which make the HVAC system work. The thermostat task implements pacing to avoid being called to frequently.
-    const Status status = g_thermostat_task->RunOnce(&g_settings);
+    // Keep running the thermostat tasks which make the HVAC system work. The scheduler only runs the ones that are due.
+    const Status status = g_scheduler.RunOnce(&g_settings);
 
-    // Poll for single button presses.
-    //
-    // This uses a decorator pattern to add hysteresis and debouncing logic.
-    button = Buttons::GetSinglePress(
-               Buttons::StabilizedButtonPressed(Buttons::GetButton(analogRead(0))), g_clock.Millis());
+    // Send whatever the tasks and menus changed on the screen.
+    g_display.Flush();
+
+#ifdef THERMOSTAT_TIMING
+    g_timings.Poll();
+#endif
+
+    // Take the button readings from the ADC interrupt in order, which adds the
+    // debouncing and auto-presses. A press stops the draining, and the remaining readings
+    // are taken on the next call.
+    uint16_t reading;
+    while (button == Button::NONE && g_button_samples.Pop(&reading)) {
+      button = g_buttons.Add(reading);
+    }
 
     if (g_clock.millisSince(start) >= timeout) {
       return Button::TIMEOUT;
     }
+
+    // Sleep until the next task or button sample rather than spinning.
+    if (button == Button::NONE) {
+      g_idler.Idle(status != Status::kSkipped);
+    }
   }
 
   // When a button is pressed, turn on the backlight for some length of time.
@@ -215,7 +356,11 @@ Button WaitForButtonPress(const uint32_t timeout) {
 // fields.
 //
 // All blocking calls use WaitForButtonPress to ensure MaintainHvac is always periodically called.
-Menus menu(&g_settings, &WaitForButtonPress, &g_clock, &g_lcd, &g_storer);
+#ifdef THERMOSTAT_TIMING
+Menus menu(&g_settings, &WaitForButtonPress, &g_clock, &g_display, &g_storer, &g_timings, &g_scheduler);
+#else
+Menus menu(&g_settings, &WaitForButtonPress, &g_clock, &g_display, &g_storer, nullptr, &g_scheduler);
+#endif
 
 
 void loop() {
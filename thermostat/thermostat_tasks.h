@@ -4,6 +4,11 @@
 // makes it hard to use in the arduino IDE.
 //
 // These classes manage the top row of the LCD Display, relays, sensor readings, fan, history data.
+//
+// Each decorator layer is a template on the type of the layer it wraps. The
+// ...ThermostatTask typedefs wrap any ThermostatTask through the virtual RunOnce, which
+// the unit tests use to wrap mocks. The sketch composes the concrete layers with a
+// Pipeline instead, see pipeline.h.
 #ifndef MAINTAIN_HVAC_H_
 #define MAINTAIN_HVAC_H_
 
@@ -11,28 +16,100 @@
 #include "interfaces.h"
 #include "calculate_iaq.h"
 #include "events.h"
+#include "memory_monitor.h"
+#include "pi_controller.h"
+#include "pipeline.h"
+#include "telemetry.h"
+#include "temperature_filter.h"
 
 namespace thermostat {
 constexpr uint32_t kManualTemperatureOverrideDuration = Clock::HoursToMillis(2);
 
-constexpr uint8_t kTemperatureWindowSize = 8;
+// The filter of the temperature the HVAC control acts on, see temperature_filter.h for
+// why this is the default. Define THERMOSTAT_TEMPERATURE_FILTER to build with another one.
+#ifndef THERMOSTAT_TEMPERATURE_FILTER
+#define THERMOSTAT_TEMPERATURE_FILTER ExponentialFilter<2>
+#endif
+typedef THERMOSTAT_TEMPERATURE_FILTER TemperatureFilter;
 
 constexpr int kRunEveryMillis = 1500;
 
-// Error status latching value.
-static Status g_status = Status::kOk;
+// The longest a heat call should take to reach the setpoint at the low stage before the
+// high stage is used. Define THERMOSTAT_HEAT_STAGING_MINUTES to build with another target.
+#ifndef THERMOSTAT_HEAT_STAGING_MINUTES
+#define THERMOSTAT_HEAT_STAGING_MINUTES 20
+#endif
+constexpr uint8_t kHeatStagingMinutes = THERMOSTAT_HEAT_STAGING_MINUTES;
+
+// The earliest the adaptive recovery starts heating ahead of a setpoint, which limits
+// how early a slow learned heating rate can start.
+constexpr uint16_t kMaxRecoveryMinutes = 180;
+
+// How long the sensors get to convert after StartRequestAsync before the reading is
+// collected. The BME680 needs ~150ms for the gas heater plus oversampling.
+constexpr uint32_t kSensorSettleMillis = 250;
 
-class WrapperThermostatTask : public ThermostatTask {
+// Innermost layer which does nothing.
+class WrapperThermostatTask final : public ThermostatTask {
   public:
     Status RunOnce(Settings* settings) override {
+      UNUSED(settings);
       return Status::kOk;
     }
 };
 
+// Allow the manual temperature override to only apply for 2 hours. We clear the
+// override temperature to indicate no override is being applied.
+static void ExpireOverrideTemperature(Settings* const settings) {
+  if (settings->override_temperature_x10 != 0 &&
+      Clock::MillisDiff(settings->override_temperature_started_ms, settings->now) >
+      kManualTemperatureOverrideDuration) {
+    settings->override_temperature_x10 = 0;
+  }
+}
+
+// With the adaptive recovery, heats to a warmer next setpoint once the learned heating
+// rate needs the time left to reach it, so the room is warm at the setpoint's time
+// rather than starting to heat then. Once started, the recovery holds until the
+// setpoint takes over, so it doesn't cycle on the remaining time.
+class AdaptiveRecovery {
+  public:
+    // Returns the setpoint to heat to instead of the scheduled setpoint_x10.
+    int HeatSetpoint(const Settings& settings, const Date& date, const int setpoint_x10) {
+      int next_x10 = 0;
+      uint16_t minutes_until = 0;
+      if (!settings.persisted.adaptive_recovery ||
+          !GetNextSetpoint(settings, date, HvacMode::HEAT, &next_x10, &minutes_until) ||
+          next_x10 <= setpoint_x10 || minutes_until > kMaxRecoveryMinutes) {
+        recovering_ = false;
+        return setpoint_x10;
+      }
+
+      // Nothing learned yet.
+      const int16_t rate_x100 = RecentHeatTempPerMinX100(settings);
+      if (rate_x100 <= 0) {
+        return recovering_ ? next_x10 : setpoint_x10;
+      }
+
+      // Degrees x10 * 10 / degrees per minute x100 = minutes.
+      const int32_t needed_minutes =
+        static_cast<int32_t>(next_x10 - settings.current_mean_temperature_x10) * 10 / rate_x100;
+      if (needed_minutes >= minutes_until) {
+        recovering_ = true;
+      }
+      return recovering_ ? next_x10 : setpoint_x10;
+    }
+
+  private:
+    // Heating to the next setpoint ahead of its time.
+    bool recovering_ = false;
+};
+
 // ThermostatTask decorator layer that performs HV/AC control management.
-class HvacControllerThermostatTask final : public ThermostatTask {
+template <typename Next>
+class HvacControllerLayer final : public LayerBase<Next> {
   public:
-    explicit HvacControllerThermostatTask(Clock* const clock, Print* const print, ThermostatTask* const wrapped) :
+    explicit HvacControllerLayer(Clock* const clock, Print* const print, Next* const wrapped) :
       clock_(clock),
       print_(print),
       wrapped_(wrapped) {};
@@ -72,7 +149,8 @@ class HvacControllerThermostatTask final : public ThermostatTask {
       return mode;
     }
 
-    HvacMode DetermineHeatMode(const Settings& settings, bool* within_tolerance) {
+    HvacMode DetermineHeatMode(const Settings& settings, bool* within_tolerance,
+                               int16_t* setpoint_x10_out) {
       HvacMode mode = settings.hvac;
             
       if (!settings.persisted.heat_enabled) {
@@ -82,8 +160,10 @@ class HvacControllerThermostatTask final : public ThermostatTask {
         return mode;
       }
 
+      const Date date = clock_->Now();
       const int setpoint_x10 =
-        GetSetpointTemp(settings, clock_->Now(), HvacMode::HEAT);
+        recovery_.HeatSetpoint(settings, date, GetSetpointTemp(settings, date, HvacMode::HEAT));
+      *setpoint_x10_out = setpoint_x10;
 
       // If heating is on, keep the temperature above the setpoint.
       // If cooling is on, keep the temperature below the setpoint.
@@ -126,7 +206,7 @@ class HvacControllerThermostatTask final : public ThermostatTask {
       return mode;
     }
 
-    Status RunOnce(Settings* settings) override {
+    Status RunOnce(Settings* settings) {
       Status status = wrapped_->RunOnce(settings);
       if (status != Status::kOk) {
         return status;
@@ -136,16 +216,11 @@ class HvacControllerThermostatTask final : public ThermostatTask {
       // in the settings object.
       settings->changed = 0;
 
-      // Allow the manual temperature override to only apply for 2 hours. We clear the
-      // override temperature to indicate no override is being applied.
-      if (settings->override_temperature_x10 != 0 &&
-          Clock::MillisDiff(settings->override_temperature_started_ms, settings->now) >
-          kManualTemperatureOverrideDuration) {
-        settings->override_temperature_x10 = 0;
-      }
+      ExpireOverrideTemperature(settings);
 
       bool within_tolerance = true;
-      settings->hvac = DetermineHeatMode(*settings, &within_tolerance);
+      settings->hvac = DetermineHeatMode(*settings, &within_tolerance,
+                                         &settings->heat_setpoint_x10);
 
       settings->within_tolerance = within_tolerance;
 
@@ -174,18 +249,139 @@ class HvacControllerThermostatTask final : public ThermostatTask {
     Clock* const clock_;
     Print* const print_;
 
-    ThermostatTask* const wrapped_;
+    AdaptiveRecovery recovery_;
+
+    Next* const wrapped_;
 };
+typedef HvacControllerLayer<ThermostatTask> HvacControllerThermostatTask;
+
+// ThermostatTask decorator layer that holds the setpoint with a PiController instead of
+// the tolerance band, see pi_controller.h. It replaces the HvacControllerLayer, so the
+// lockout, staging and relay layers apply the same.
+//
+// The heat loop runs below the midpoint between the heat and cool setpoints and the cool
+// loop above it. Switching loops starts the new one from scratch.
+template <typename Next>
+class PiControllerLayer final : public LayerBase<Next> {
+  public:
+    explicit PiControllerLayer(Clock* const clock, Print* const print, Next* const wrapped,
+                               const PiControlConfig& config = PiControlConfig()) :
+      clock_(clock),
+      print_(print),
+      controller_(config.kp_permille, config.ki_permille_per_hour),
+      proportioner_(Clock::MinutesToMillis(config.cycle_minutes),
+                    Clock::MinutesToMillis(config.min_on_minutes),
+                    Clock::MinutesToMillis(config.min_off_minutes)),
+      wrapped_(wrapped) {};
 
+    Status RunOnce(Settings* settings) {
+      Status status = wrapped_->RunOnce(settings);
+      if (status != Status::kOk) {
+        return status;
+      }
 
+      // Reset the settings changed flag since we're going to update the HVAC with the values
+      // in the settings object.
+      settings->changed = 0;
+      ExpireOverrideTemperature(settings);
+
+      const Date date = clock_->Now();
+      HvacMode loop = HvacMode::IDLE;
+      int16_t error_x10 = 0;
+      if (settings->persisted.heat_enabled) {
+        settings->heat_setpoint_x10 = recovery_.HeatSetpoint(
+            *settings, date, GetSetpointTemp(*settings, date, HvacMode::HEAT));
+      }
+      const int cool_setpoint_x10 = GetSetpointTemp(*settings, date, HvacMode::COOL);
+      if (settings->persisted.heat_enabled &&
+          (!settings->persisted.cool_enabled ||
+           settings->current_mean_temperature_x10 <
+             (settings->heat_setpoint_x10 + cool_setpoint_x10) / 2)) {
+        loop = HvacMode::HEAT;
+        error_x10 = settings->heat_setpoint_x10 + settings->persisted.tolerance_x10 / 2 -
+                    settings->current_mean_temperature_x10;
+      } else if (settings->persisted.cool_enabled) {
+        loop = HvacMode::COOL;
+        error_x10 = settings->current_mean_temperature_x10 -
+                    (cool_setpoint_x10 - settings->persisted.tolerance_x10 / 2);
+      }
 
-// ThermostatTask decorator layer that increases to High Heat after 10 minutes.
-class HeatAdvancingThermostatTask final : public ThermostatTask {
+      if (loop != loop_) {
+        loop_ = loop;
+        controller_.Reset();
+        proportioner_.Reset();
+      }
+      const uint32_t dt_ms = started_ ? Clock::MillisDiff(last_run_ms_, settings->now) : 0;
+      started_ = true;
+      last_run_ms_ = settings->now;
+
+      settings->within_tolerance = error_x10 <= 0;
+      if (loop == HvacMode::IDLE) {
+        settings->hvac = HvacMode::IDLE;
+        return status;
+      }
+
+      duty_permille_ = controller_.Update(error_x10, dt_ms);
+      settings->hvac =
+        proportioner_.Update(duty_permille_, settings->now) ? loop : HvacMode::IDLE;
+
+      print_->print("Mean: ");
+      print_->print(settings->current_mean_temperature_x10);
+      print_->print(" Duty: ");
+      print_->print(duty_permille_);
+      print_->println();
+
+      return status;
+    }
+
+    // The duty of the last update in permille.
+    int16_t duty_permille() const {
+      return duty_permille_;
+    }
+
+  private:
+    Clock* const clock_;
+    Print* const print_;
+
+    PiController controller_;
+    TimeProportioner proportioner_;
+    AdaptiveRecovery recovery_;
+
+    HvacMode loop_ = HvacMode::IDLE;
+    bool started_ = false;
+    uint32_t last_run_ms_ = 0;
+    int16_t duty_permille_ = 0;
+
+    Next* const wrapped_;
+};
+typedef PiControllerLayer<ThermostatTask> PiControllerThermostatTask;
+
+// The layer deciding when to heat and cool, the tolerance band of the HvacControllerLayer
+// or the PiControllerLayer. Define THERMOSTAT_HVAC_CONTROLLER to build with another one.
+#ifndef THERMOSTAT_HVAC_CONTROLLER
+#define THERMOSTAT_HVAC_CONTROLLER HvacControllerLayer
+#endif
+template <typename Next>
+using ControllerLayer = THERMOSTAT_HVAC_CONTROLLER<Next>;
+typedef ControllerLayer<ThermostatTask> ControllerThermostatTask;
+
+
+
+// ThermostatTask decorator layer that chooses the heat stage.
+//
+// At the start of a heat call, the low stage rise rate learned from the recent heat events
+// predicts how long the low stage takes to reach the setpoint. The call starts at high when
+// that's longer than kHeatStagingMinutes, and otherwise at low, which is also the start
+// without anything learned. After 10 minutes at low, the rise seen so far in the call is
+// checked the same way, and the call moves to high if the rest of the gap won't close in
+// time. High stays on until the heat turns off.
+template <typename Next>
+class HeatAdvancingLayer final : public LayerBase<Next> {
   public:
-    explicit HeatAdvancingThermostatTask(ThermostatTask* const wrapped) :
+    explicit HeatAdvancingLayer(Next* const wrapped) :
       wrapped_(wrapped) {};
 
-    Status RunOnce(Settings* settings) override {
+    Status RunOnce(Settings* settings) {
       Status status = wrapped_->RunOnce(settings);
 
       // If this is the first run from boot, initialize.
@@ -199,17 +395,31 @@ class HeatAdvancingThermostatTask final : public ThermostatTask {
         // Keep the start_time tracking the last non-heating mode.
         hvac_start_time_ = settings->now;
         settings->heat_high = false;
+        heating_ = false;
+        return status;
+      }
+
+      const int32_t gap_x10 =
+        settings->heat_setpoint_x10 - settings->current_mean_temperature_x10;
+      if (!heating_) {
+        heating_ = true;
+        start_temperature_x10_ = settings->current_mean_temperature_x10;
+        const int16_t rate_x100 = RecentHeatTempPerMinX100(*settings);
+        settings->heat_high =
+          rate_x100 > 0 && LowStageMinutes(gap_x10, rate_x100) > kHeatStagingMinutes;
         return status;
       }
 
-      // If we've been heating for 10 minutes and haven't gotten above the low, move to high mode.
-      //
       // The high heat flag needs to be sticky until heat turns off, which is why we only clear it
       // if not in HEAT mode.
-      //
-      // This ensures we run at low heat most of the time, except when low really can't keep us within
-      // our tolerance.
-      if (Clock::MinutesDiff(hvac_start_time_, settings->now) > 10 && !settings->within_tolerance) {
+      const uint32_t minutes = Clock::MinutesDiff(hvac_start_time_, settings->now);
+      if (settings->heat_high || minutes <= 10 || settings->within_tolerance) {
+        return status;
+      }
+      const int32_t rate_x100 =
+        (static_cast<int32_t>(settings->current_mean_temperature_x10) - start_temperature_x10_) *
+        10 / static_cast<int32_t>(minutes);
+      if (minutes + LowStageMinutes(gap_x10, rate_x100) > kHeatStagingMinutes) {
         settings->heat_high = true;
       }
 
@@ -217,18 +427,34 @@ class HeatAdvancingThermostatTask final : public ThermostatTask {
     }
 
   private:
+    // Minutes to rise gap_x10 at rate_x100 degrees x100 per minute, saturated.
+    static uint32_t LowStageMinutes(const int32_t gap_x10, const int32_t rate_x100) {
+      if (gap_x10 <= 0) {
+        return 0;
+      }
+      if (rate_x100 <= 0) {
+        return 0xFFFF;
+      }
+      return cmin(static_cast<int32_t>(0xFFFF), gap_x10 * 10 / rate_x100);
+    }
+
     uint32_t hvac_start_time_ = 0;
-    ThermostatTask* const wrapped_;
+    // Whether the current heat call started, and the temperature it started at.
+    bool heating_ = false;
+    int16_t start_temperature_x10_ = 0;
+    Next* const wrapped_;
 };
+typedef HeatAdvancingLayer<ThermostatTask> HeatAdvancingThermostatTask;
 
 // ThermostatTask decorator layer that performs HVAC lockout at power on and when switching modes.
-class LockoutControllingThermostatTask final : public ThermostatTask {
+template <typename Next>
+class LockoutControllingLayer final : public LayerBase<Next> {
   public:
-    explicit LockoutControllingThermostatTask(ThermostatTask* const wrapped) :
+    explicit LockoutControllingLayer(Next* const wrapped) :
       wrapped_(wrapped) {};
 
 
-    Status RunOnce(Settings* settings) override {
+    Status RunOnce(Settings* settings) {
       // The decorator layers below us don't understand lockout (which really
       // means idle), so update them to IDLE.
       if (settings->hvac == HvacMode::COOL_LOCKOUT || settings->hvac == HvacMode::HEAT_LOCKOUT) {
@@ -268,126 +494,117 @@ class LockoutControllingThermostatTask final : public ThermostatTask {
 
   private:
     uint32_t hvac_start_time_ = 0;
-    ThermostatTask* const wrapped_;
+    Next* const wrapped_;
 };
+typedef LockoutControllingLayer<ThermostatTask> LockoutControllingThermostatTask;
 
-// ThermostatTask decorator layer that performs HV/AC control management.
-class SensorUpdatingThermostatTask final : public ThermostatTask {
+// ThermostatTask decorator layer that keeps the sensor readings updated.
+//
+// With more than one temperature sensor, pass a FusedSensor which combines them.
+//
+// Readings are collected with a small state machine so RunOnce never blocks waiting on a
+// sensor:
+//   kIdle      -> StartRequestAsync() is issued and the pass is skipped (no data yet).
+//   kRequested -> Until kSensorSettleMillis elapsed, the previous values are kept.
+//                 Afterwards EndReading() collects the values and the next request is issued.
+template <typename Next>
+class SensorUpdatingLayer final : public LayerBase<Next> {
   public:
-    explicit SensorUpdatingThermostatTask(Clock* const clock, Sensor* const dual_sensor, Sensor* const secondary_temp_sensor, Print* const print, ThermostatTask* const wrapped) :
+    explicit SensorUpdatingLayer(Clock* const clock, Sensor* const sensor, Print* const print, Next* const wrapped) :
       clock_(clock),
       print_(print),
-      primary_sensor_(dual_sensor),
-      secondary_temp_sensor_(secondary_temp_sensor),
+      sensor_(sensor),
       wrapped_(wrapped) {};
 
-    Status RunOnce(Settings* settings) override {
+    Status RunOnce(Settings* settings) {
       Status status = wrapped_->RunOnce(settings);
       if (status != Status::kOk) {
         return status;
       }
 
-      if (!sensor_started_) {
-        // Kick off the next asynchronous readings.
-        primary_sensor_->StartRequestAsync();
-        secondary_temp_sensor_->StartRequestAsync();
-        sensor_started_ = true;
-        ;
+      if (sensor_state_ == SensorState::kIdle) {
+        // Kick off the first asynchronous readings. There is nothing to report until they
+        // complete, so skip the layers that depend on the temperature.
+        StartRequests();
+        return Status::kSkipped;
+      }
+
+      // The sensors are still converting, keep using the previous values rather than
+      // waiting on them.
+      if (clock_->millisSince(requested_ms_) < kSensorSettleMillis) {
+        return values_initialized_ ? status : Status::kSkipped;
+      }
 
-        // Give the sensor time to get a value.
-        for (const uint32_t now = clock_->Millis(); clock_->millisSince(now) < 100;) {
-          // Do nothing
-        }
+      if (!sensor_->EndReading()) {
+        // Retry on the next pass.
+        StartRequests();
+        return Status::kPrimarySensorFail;
       }
 
-      // Scale by 10 and clip the temperature to 99.9°.
-      const int temperature =
-        cmin(primary_sensor_->GetTemperature() * 10, 999);
+      // Clip the temperature to 99.9°.
+      const int temperature = cmin(sensor_->GetTemperatureX10(), 999);
 
       // Store the new value in the settings.
       settings->current_temperature_x10 = temperature;
+      settings->current_humidity = sensor_->GetHumidity();
 
-      if (!primary_sensor_->EndReading()) {
-        return Status::kPrimarySensorFail;
-      }
-      settings->current_humidity = primary_sensor_->GetHumidity();
-
-      const int bme_temperature = cmin(primary_sensor_->GetTemperature() * 10.0, 999);
-      settings->current_bme_temperature_x10 = bme_temperature;
       print_->print(" Pressure = ");
-      print_->print(primary_sensor_->GetPressure() / 100.0);
+      print_->print(sensor_->GetPressure() / 100);
       print_->println(" hPa");
 
       // Kick off the next asynchronous readings.
-      primary_sensor_->StartRequestAsync();
-      secondary_temp_sensor_->StartRequestAsync();
+      StartRequests();
+      values_initialized_ = true;
 
-      // Only subtract past values that were previously added to the window.
-      if (temperature_filled_) {
-        temperature_sum_ -= temperature_window_[temperature_index_];
-      }
-      temperature_window_[temperature_index_] = settings->current_temperature_x10;
-      temperature_sum_ += temperature_window_[temperature_index_];
-      if (temperature_index_ == kTemperatureWindowSize - 1) {
-        temperature_filled_ = true;
-      }
-      temperature_index_ = (temperature_index_ + 1) % kTemperatureWindowSize;
-
-      const uint8_t temperature_counts =
-        temperature_filled_ ? kTemperatureWindowSize : temperature_index_;
-      const int temperature_mean = temperature_sum_ / temperature_counts;
-      settings->current_mean_temperature_x10 = temperature_mean;
+      settings->current_mean_temperature_x10 = temperature_filter_.Add(temperature);
 
       return status;
     }
 
   private:
-    // Window for calculating the mean temperature.
-    //
-    // This conditions the temperature signal ensuring fast fluctations don't
-    // affect the HVAC.
-    int temperature_window_[kTemperatureWindowSize] = {0};
+    enum class SensorState : uint8_t { kIdle, kRequested };
 
-    // Maintain a sum of the window values to make calculating the mean fast.
-    int temperature_sum_ = 0;
-
-    // Index to fill in next. Starts at zero so the mean can be calculated accurately during
-    // initial filling.
-    uint8_t temperature_index_ = 0;
+    void StartRequests() {
+      sensor_->StartRequestAsync();
+      requested_ms_ = clock_->Millis();
+      sensor_state_ = SensorState::kRequested;
+    }
 
-    // Flag gets updated to true once temperature_index reaches temperature_SIZE. This ensures
-    // the mean calculation is accurate.
-    bool temperature_filled_ = false;
+    // Conditions the temperature signal ensuring fast fluctations don't affect the HVAC.
+    TemperatureFilter temperature_filter_;
 
-    bool sensor_started_ = false;
+    SensorState sensor_state_ = SensorState::kIdle;
     bool values_initialized_ = false;
 
+    // When the outstanding sensor request was issued.
+    uint32_t requested_ms_ = 0;
+
     Clock* const clock_;
     Print* const print_;
 
-    Sensor* const primary_sensor_;
-    Sensor* const secondary_temp_sensor_;
+    Sensor* const sensor_;
 
-
-    ThermostatTask* const wrapped_;
+    Next* const wrapped_;
 };
+typedef SensorUpdatingLayer<ThermostatTask> SensorUpdatingThermostatTask;
 
 // ThermostatTask decorator layer that performs debug logging.
-class LoggingThermostatTask final : public ThermostatTask {
+template <typename Next>
+class LoggingLayer final : public LayerBase<Next> {
   public:
-    explicit LoggingThermostatTask(Print* const print, ThermostatTask* const wrapped) :
+    explicit LoggingLayer(Print* const print, Next* const wrapped) :
       print_(print),
       wrapped_(wrapped) {};
 
-    Status RunOnce(Settings* settings) override {
+    Status RunOnce(Settings* settings) {
       Status status = wrapped_->RunOnce(settings);
 
-      print_->print(" 2nd Temp = ");
-      print_->print(settings->current_bme_temperature_x10);
-      print_->println("°F");
-      print_->print(" Primary = ");
+      print_->print(" Temp = ");
       print_->print(settings->current_temperature_x10);
       print_->println("°F");
+      print_->print(" Filtered = ");
+      print_->print(settings->current_mean_temperature_x10);
+      print_->println("°F");
       print_->print(" Humidity = ");
       print_->print(static_cast<int>(settings->current_humidity));
       print_->println(" %");
@@ -400,17 +617,48 @@ class LoggingThermostatTask final : public ThermostatTask {
 
   private:
     Print* const print_;
-    ThermostatTask* const wrapped_;
+    Next* const wrapped_;
 };
+typedef LoggingLayer<ThermostatTask> LoggingThermostatTask;
+
+// ThermostatTask decorator layer that sends a binary telemetry record per cycle, see
+// telemetry.h.
+template <typename Next>
+class TelemetryLayer final : public LayerBase<Next> {
+  public:
+    explicit TelemetryLayer(Print* const print, Next* const wrapped) :
+      print_(print),
+      wrapped_(wrapped) {};
+
+    Status RunOnce(Settings* settings) {
+      const Status status = wrapped_->RunOnce(settings);
+
+      // End whatever was sent before (such as the boot message), so the first record
+      // decodes.
+      if (first_frame_) {
+        print_->write(0);
+        first_frame_ = false;
+      }
+      WriteTelemetryFrame(MakeTelemetryRecord(*settings, status), print_);
+      return status;
+    }
+
+  private:
+    Print* const print_;
+    Next* const wrapped_;
+    bool first_frame_ = true;
+};
+typedef TelemetryLayer<ThermostatTask> TelemetryThermostatTask;
 
 // ThermostatTask decorator layer that performs HV/AC control management.
-class PacingThermostatTask final : public ThermostatTask {
+template <typename Next>
+class PacingLayer final : public LayerBase<Next> {
   public:
-    explicit PacingThermostatTask(Clock* const clock, ThermostatTask* const wrapped) :
+    explicit PacingLayer(Clock* const clock, Next* const wrapped) :
       clock_(clock),
       wrapped_(wrapped) {};
 
-    Status RunOnce(Settings* settings) override {
+    Status RunOnce(Settings* settings) {
       const uint32_t now = clock_->Millis();
 
       // Run only once every 1.5 seconds unless the settings (such as fan state) changed.
@@ -431,8 +679,9 @@ class PacingThermostatTask final : public ThermostatTask {
 
   private:
     Clock* const clock_;
-    ThermostatTask* const wrapped_;
+    Next* const wrapped_;
 };
+typedef PacingLayer<ThermostatTask> PacingThermostatTask;
 
 // Perform Fan Control using a ThermostatTask decorator layer.
 //
@@ -440,15 +689,16 @@ class PacingThermostatTask final : public ThermostatTask {
 //
 // This allows the fan to run for 5 minutes for better room balancing after the HVAC stops
 // running.
-class FanControllerThermostatTask final : public ThermostatTask {
+template <typename Next>
+class FanControllerLayer final : public LayerBase<Next> {
   public:
-    explicit FanControllerThermostatTask(Clock* const clock, Print* const print, ThermostatTask* const wrapped) :
+    explicit FanControllerLayer(Clock* const clock, Print* const print, Next* const wrapped) :
       clock_(clock),
       print_(print),
       last_maintain_time_(clock->Millis()),
       wrapped_(wrapped) {};
 
-    Status RunOnce(Settings* settings) override {
+    Status RunOnce(Settings* settings) {
 
       const bool hvac_previously_on = (last_hvac_on_ == last_maintain_time_);
 
@@ -470,30 +720,31 @@ class FanControllerThermostatTask final : public ThermostatTask {
 
       const bool fan_is_running = settings->GetFanMode() == FanMode::ON;
 
+      // The cycle is kept in seconds scaled by the duty %, so draining at 1 / duty% is a
+      // plain subtraction. A 0% duty drains everything at once.
+      const uint8_t duty = settings->persisted.fan_on_duty;
+      const uint8_t scale = duty == 0 ? 1 : duty;
+      const uint32_t elapsed_seconds = clock_->secondsSince(last_maintain_time_);
       if (fan_is_running || fan_auto_runnning) {
         // We decrease scaled based on the fan duty cycle.
-        cycle_seconds -=  clock_->secondsSince(last_maintain_time_) / (settings->persisted.fan_on_duty / 100.0);;
+        const uint32_t drain = duty == 0 ? cycle_scaled_seconds_ : elapsed_seconds * 100;
+        cycle_scaled_seconds_ -= cmin(drain, cycle_scaled_seconds_);
       } else {
         // We increase in seconds for enablement when reaching the desired period.
-        cycle_seconds += clock_->secondsSince(last_maintain_time_);
-      }
-
-      // Bound the range of cycle_seconds.
-      if (cycle_seconds < 0) {
-        cycle_seconds = 0;
+        cycle_scaled_seconds_ += elapsed_seconds * scale;
       }
 
       // Require the fan to run some number of minutes.
       const uint32_t fan_period_sec = static_cast<uint32_t>(settings->persisted.fan_on_min_period) * 60;
 
       // Enable the fan if we hit the upper bound period.
-      if (cycle_seconds >= fan_period_sec) {
-        cycle_seconds = fan_period_sec;
+      if (cycle_scaled_seconds_ >= fan_period_sec * scale) {
+        cycle_scaled_seconds_ = fan_period_sec * scale;
         fan_enable = true;
       }
 
       // Keep the fan running until we empty the tokens to run the desired duty cycle length.
-      if (fan_is_running && cycle_seconds > 0) {
+      if (fan_is_running && cycle_scaled_seconds_ > 0) {
         fan_enable = true;
       }
 
@@ -513,36 +764,35 @@ class FanControllerThermostatTask final : public ThermostatTask {
     Clock* const clock_;
     Print* const print_;
 
-    float cycle_seconds = 0;
-
     uint32_t last_maintain_time_ = 0;
     bool last_hvac_on_set_ = false;
 
-    // Ensures the fan meets the fan running duty cycle. Each time the fan runs, the fan will continue running until cycle_seconds returns to zero.
+    // Ensures the fan meets the fan running duty cycle. Each time the fan runs, the fan will continue running until this returns to zero.
     //
-    // We increment for each second the fan is off and decrement (1 second / duty%) for every second fan on.
+    // We increment for each second the fan is off and decrement (1 second / duty%) for every second fan on, all multiplied by the duty %.
     // Each time the hvac runs, we run until this counter reaches zero. To handle hvac off cases, when the cycle counter reaches the cycle period, the fan will be forced on.
+    uint32_t cycle_scaled_seconds_ = 0;
+
     uint32_t last_hvac_on_ = 0;
 
-    ThermostatTask* const wrapped_;
+    Next* const wrapped_;
 };
+typedef FanControllerLayer<ThermostatTask> FanControllerThermostatTask;
 
 // ThermostatTask decorator layer that performs HV/AC control management.
-class RelaySettingThermostatTask final : public ThermostatTask {
+template <typename Next>
+class RelaySettingLayer final : public LayerBase<Next> {
   public:
-    using GetSystemStatusFn = Status (*)(void);
-
-    explicit RelaySettingThermostatTask(Relays* const relays, Print* const print, GetSystemStatusFn system_status, ThermostatTask* const wrapped) :
+    explicit RelaySettingLayer(Relays* const relays, Print* const print, Next* const wrapped) :
       relays_(relays),
       print_(print),
-      system_status_(system_status),
       wrapped_(wrapped) {};
 
-    Status RunOnce(Settings* settings) override {
+    Status RunOnce(Settings* settings) {
       const Status status = wrapped_->RunOnce(settings);
 
-      // On system error, force off.
-      if (system_status_() != Status::kOk) {
+      // On a latched system error, force off.
+      if (settings->status != Status::kOk) {
         relays_->Set(RelayType::kHeat, RelayState::kOff);
         relays_->Set(RelayType::kCool, RelayState::kOff);
         relays_->Set(RelayType::kFan, RelayState::kOff);
@@ -585,20 +835,21 @@ class RelaySettingThermostatTask final : public ThermostatTask {
   private:
     Relays* const relays_;
     Print* const print_;
-    GetSystemStatusFn system_status_;
 
-    ThermostatTask* const wrapped_;
+    Next* const wrapped_;
 };
+typedef RelaySettingLayer<ThermostatTask> RelaySettingThermostatTask;
 
 // ThermostatTask decorator layer that performs HV/AC control management.
-class UpdateDisplayThermostatTask final : public ThermostatTask {
+template <typename Next>
+class UpdateDisplayLayer final : public LayerBase<Next> {
   public:
-    explicit UpdateDisplayThermostatTask(Display* const display, Print* const print, ThermostatTask* const wrapped) :
+    explicit UpdateDisplayLayer(Display* const display, Print* const print, Next* const wrapped) :
       display_(display),
       print_(print),
       wrapped_(wrapped) {};
 
-    Status RunOnce(Settings* settings) override {
+    Status RunOnce(Settings* settings) {
       const Status status = wrapped_->RunOnce(settings);
 
       // Skip empty statuses and don't spin the spinner.
@@ -668,20 +919,61 @@ class UpdateDisplayThermostatTask final : public ThermostatTask {
   private:
     Display* const display_;
     Print* const print_;
-    ThermostatTask* const wrapped_;
+    Next* const wrapped_;
+};
+typedef UpdateDisplayLayer<ThermostatTask> UpdateDisplayThermostatTask;
+
+// ThermostatTask decorator layer that keeps track of the free RAM. Once the stack has
+// come within low_bytes of the heap it sets settings->low_memory, which the
+// ErrorDisplayingLayer shows, so a board about to reset shows why. This isn't a Status,
+// since any latched Status turns the relays off.
+//
+// Scanning the painted RAM takes a few ms, so it only runs every kMemoryScanMillis.
+template <typename Next>
+class MemoryMonitoringLayer final : public LayerBase<Next> {
+  public:
+    explicit MemoryMonitoringLayer(Memory* const memory, Next* const wrapped,
+                                   const uint16_t low_bytes = kLowMemoryBytes) :
+      memory_(memory),
+      wrapped_(wrapped),
+      low_bytes_(low_bytes) {};
+
+    Status RunOnce(Settings* settings) {
+      const Status status = wrapped_->RunOnce(settings);
+
+      if (settings->first_run ||
+          Clock::MillisDiff(scanned_ms_, settings->now) >= kMemoryScanMillis) {
+        scanned_ms_ = settings->now;
+        settings->free_memory_bytes = memory_->FreeBytes();
+        settings->min_free_memory_bytes = memory_->MinFreeBytes();
+      }
+
+      // The minimum never rises again, so this stays set until the reset.
+      if (settings->min_free_memory_bytes < low_bytes_) {
+        settings->low_memory = true;
+      }
+      return status;
+    }
+
+  private:
+    Memory* const memory_;
+    Next* const wrapped_;
+    const uint16_t low_bytes_;
+
+    uint32_t scanned_ms_ = 0;
 };
+typedef MemoryMonitoringLayer<ThermostatTask> MemoryMonitoringThermostatTask;
 
 // ThermostatTask decorator layer that performs HV/AC control management.
-class ErrorDisplayingThermostatTask final : public ThermostatTask {
+template <typename Next>
+class ErrorDisplayingLayer final : public LayerBase<Next> {
   public:
-    explicit ErrorDisplayingThermostatTask(Display* const display, Print* const print, ThermostatTask* const wrapped) :
+    explicit ErrorDisplayingLayer(Display* const display, Print* const print, Next* const wrapped) :
       display_(display),
       print_(print),
       wrapped_(wrapped) {};
 
-    Status RunOnce(Settings* settings) override {
-      static uint8_t s_counter = 0;
-
+    Status RunOnce(Settings* settings) {
       const Status status = wrapped_->RunOnce(settings);
 
       // Skip empty statuses and don't spin the spinner.
@@ -691,100 +983,155 @@ class ErrorDisplayingThermostatTask final : public ThermostatTask {
 
       // An error gets latched on the screen until the thermostat is reset.
       if (status != Status::kOk) {
-        g_status = status;
+        settings->status = status;
       }
 
       // The character in the first row far right is the status.
       display_->SetCursor(15, 0);
 
       // We use the last character in the first row.
-      if (g_status != Status::kOk) {
+      if (settings->status != Status::kOk) {
         // Show the error instead.
         // Errors are in the range of A-Z (0-26).
-        display_->print(static_cast<char>('A' + static_cast<uint8_t>(g_status)));
+        display_->print(static_cast<char>('A' + static_cast<uint8_t>(settings->status)));
+        return status;
+      }
+
+      // Low memory replaces the spinner, but the HVAC keeps running.
+      if (settings->low_memory) {
+        display_->write('M');
         return status;
       }
 
       // Make the spinning animation to allow a user to know the HVAC is still fully updating.
-      s_counter = (s_counter + 1) % 4;
-      if (s_counter == 0) {
+      spinner_counter_ = (spinner_counter_ + 1) % 4;
+      if (spinner_counter_ == 0) {
         display_->write('/');
       }
-      if (s_counter == 1) {
+      if (spinner_counter_ == 1) {
         display_->write('-');
       }
-      if (s_counter == 2) {
+      if (spinner_counter_ == 2) {
         display_->write(uint8_t(1));  // Prints a custom '\'. The LCD's default '\' is the Yen symbol.
       }
-      if (s_counter == 3) {
+      if (spinner_counter_ == 3) {
         display_->write('|');
       }
       return status;
     }
 
   private:
+    // Position of the spinning animation.
+    uint8_t spinner_counter_ = 0;
+
     Display* const display_;
     Print* const print_;
-    ThermostatTask* const wrapped_;
+    Next* const wrapped_;
 };
+typedef ErrorDisplayingLayer<ThermostatTask> ErrorDisplayingThermostatTask;
 
 // ThermostatTask decorator layer that performs HV/AC control management.
-class HistoryUpdatingThermostatTask final : public ThermostatTask {
+template <typename Next>
+class HistoryUpdatingLayer final : public LayerBase<Next> {
   public:
-    explicit HistoryUpdatingThermostatTask(ThermostatTask* const wrapped) :
+    explicit HistoryUpdatingLayer(Next* const wrapped) :
       wrapped_(wrapped) {};
 
-    Status RunOnce(Settings* settings) override {
+    Status RunOnce(Settings* settings) {
       Status status = wrapped_->RunOnce(settings);
 
-      // Clear any events that are over 24 days old.
-      // Since the max time stored in a uint32_t is 49.7 days and we want to clearly detect rollover,
-      // no event should be more than max time / 2. See MillisSubtract for more details.
-      for (uint8_t i = 0; i < EVENT_SIZE; ++i) {
-        if (settings->events[i].empty()) {
-          continue;
-        }
-        if (Clock::MillisDiff(settings->events[i].start_time, settings->now) >
-            Clock::DaysToMillis(24)) {
-          settings->events[i].set_empty();
-        }
-      }
+      // Slide the status totals window.
+      ExpireEventTotals(settings);
 
-      Event* const event = &settings->events[settings->event_index];
+      EventLog<EVENT_SIZE>* const events = &settings->events;
       const HvacMode current_hvac = Sanitize(settings->GetHvacMode());
       const FanMode current_fan = Sanitize(settings->GetFanMode());
-
-      // Update the 10 minute temperature when heating more than 10 minutes.
-      if (current_hvac == HvacMode::HEAT) {
-        if (Clock::MillisDiff(event->start_time, settings->now) > Clock::MinutesToMillis(10)) {
-          event->temperature_10min_x10 = settings->current_mean_temperature_x10;
-        }
+      const uint32_t event_ms = events->DurationMillis(0, settings->now);
+
+      // Record the temperature rise once the heat ran for 10 minutes. Only low stage rises
+      // are kept, since those are what the HeatAdvancingThermostatTask predicts from.
+      int16_t rise_x10;
+      if (current_hvac == HvacMode::HEAT && events->hvac(0) == HvacMode::HEAT &&
+          !settings->heat_high && !events->GetHeatRise(0, &rise_x10) &&
+          event_ms > Clock::MinutesToMillis(10)) {
+        events->SetHeatRise(settings->current_mean_temperature_x10 -
+                            events->newest_temperature_x10());
       }
 
-      // When the current event matches current settings, don't create a new event.
-      if (current_hvac == event->hvac && current_fan == event->fan) {
+      // When the current event matches current settings, don't create a new event unless
+      // it's getting too long for the packed event format.
+      if (current_hvac == events->hvac(0) && current_fan == events->fan(0) &&
+          event_ms < kMaxEventMillis - Clock::MinutesToMillis(1)) {
         return status;
       }
 
-      settings->event_index = (settings->event_index + 1) % EVENT_SIZE;
-      Event* new_event = &settings->events[settings->event_index];
-      new_event->start_time = settings->now;
+      PushEvent(settings, current_hvac, current_fan);
 
-      new_event->temperature_x10 = settings->current_mean_temperature_x10;
-      new_event->hvac = current_hvac;
-      new_event->fan = current_fan;
+      return status;
+    };
+  private:
+    Next* const wrapped_;
 
-      // We need always maintain one empty event to ensure we don't have an
-      // incorrect duration comparing against the oldest start time.
-      settings->events[(settings->event_index + 1) % EVENT_SIZE]
-      .set_empty();
+};
+typedef HistoryUpdatingLayer<ThermostatTask> HistoryUpdatingThermostatTask;
+
+// ThermostatTask decorator layer that drops the events which are too old to keep.
+//
+// Events only expire after days, so this doesn't need to run every cycle.
+template <typename Next>
+class HistoryPruningLayer final : public LayerBase<Next> {
+  public:
+    explicit HistoryPruningLayer(Next* const wrapped) :
+      wrapped_(wrapped) {};
 
+    Status RunOnce(Settings* settings) {
+      const Status status = wrapped_->RunOnce(settings);
+
+      // Clear any events that are over 24 days old.
+      // Since the max time stored in a uint32_t is 49.7 days and we want to clearly detect rollover,
+      // no event should be more than max time / 2. See MillisSubtract for more details.
+      //
+      // Only the oldest events need checking, and each is dropped once.
+      while (settings->events.size() > 1 &&
+             Clock::MillisDiff(settings->events.oldest_start(), settings->now) >
+             Clock::DaysToMillis(24)) {
+        DropOldestEvent(settings);
+      }
       return status;
-    };
+    }
+
   private:
-    ThermostatTask* const wrapped_;
+    Next* const wrapped_;
+};
+typedef HistoryPruningLayer<ThermostatTask> HistoryPruningThermostatTask;
 
+// ThermostatTask decorator layer that updates the indoor air quality score from the gas
+// sensor's last reading.
+//
+// The score follows the slowly changing air, so this only needs to run every few minutes.
+template <typename Next>
+class IaqUpdatingLayer final : public LayerBase<Next> {
+  public:
+    explicit IaqUpdatingLayer(Sensor* const gas_sensor, Next* const wrapped) :
+      gas_sensor_(gas_sensor),
+      wrapped_(wrapped) {};
+
+    Status RunOnce(Settings* settings) {
+      const Status status = wrapped_->RunOnce(settings);
+
+      // Sensors without a gas heater report no resistance.
+      const uint32_t resistance = gas_sensor_->GetGasResistance();
+      if (resistance != 0) {
+        settings->air_quality_score = CalculateIaqScore(settings->current_humidity, resistance);
+      }
+      return status;
+    }
+
+  private:
+    Sensor* const gas_sensor_;
+    Next* const wrapped_;
 };
+typedef IaqUpdatingLayer<ThermostatTask> IaqUpdatingThermostatTask;
 
 }
 #endif // MAINTAIN_HVAC_H_
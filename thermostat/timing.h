@@ -0,0 +1,234 @@
+#ifndef TIMING_H_
+#define TIMING_H_
+// Optional instrumentation of how long the thermostat layers and the main loop take.
+//
+// Wrapping a layer in a TimingThermostatTask records the RunOnce durations of the layer
+// and everything it wraps. Timing each layer of the chain gives the cost of a layer as the
+// difference from the timed layer below it. The sketch only wires these in when
+// THERMOSTAT_TIMING is defined, so there is no cost otherwise.
+//
+// The main loop is measured as the time between button polls rather than the number of
+// loop iterations between them. Every pass of the WaitForButtonPress loop polls the
+// buttons, so that count would always be one, while the time shows how long the
+// scheduled tasks and the display flush held the buttons off.
+
+#include "interfaces.h"
+#include "print.h"
+
+namespace thermostat {
+
+// Log2 histogram buckets. Bucket 0 holds 0-1us, bucket i holds [2^i, 2^(i+1))us and the
+// last one everything from 2^15us (32ms).
+constexpr uint8_t kTimingBuckets = 16;
+
+// Mean of a running series of microsecond values, also used for the scheduler lateness.
+class RunningMean {
+  public:
+    void Record(const uint32_t us) {
+      // Halve the history instead of overflowing, which keeps the mean.
+      if (count_ == 0xFFFF || total_us_ > 0xFFFFFFFF - us) {
+        const uint32_t mean = total_us_ / count_;
+        count_ /= 2;
+        total_us_ = mean * count_;
+      }
+      count_++;
+      total_us_ += us;
+    }
+
+    uint16_t count() const {
+      return count_;
+    }
+
+    uint32_t mean_us() const {
+      return count_ == 0 ? 0 : total_us_ / count_;
+    }
+
+  private:
+    uint32_t total_us_ = 0;
+    uint16_t count_ = 0;
+};
+
+// Min/max/mean and a log2 histogram of durations in microseconds.
+class TimingStats {
+  public:
+    void Record(const uint32_t us) {
+      mean_.Record(us);
+      min_us_ = us < min_us_ ? us : min_us_;
+      max_us_ = us > max_us_ ? us : max_us_;
+
+      uint16_t* const bucket = &buckets_[Bucket(us)];
+      if (*bucket < 0xFFFF) {
+        (*bucket)++;
+      }
+    }
+
+    void Reset() {
+      *this = TimingStats();
+    }
+
+    static uint8_t Bucket(uint32_t us) {
+      uint8_t bucket = 0;
+      while (us > 1 && bucket < kTimingBuckets - 1) {
+        us >>= 1;
+        bucket++;
+      }
+      return bucket;
+    }
+
+    uint16_t count() const {
+      return mean_.count();
+    }
+
+    // Zero until something was recorded.
+    uint32_t min_us() const {
+      return mean_.count() == 0 ? 0 : min_us_;
+    }
+
+    uint32_t max_us() const {
+      return max_us_;
+    }
+
+    uint32_t mean_us() const {
+      return mean_.mean_us();
+    }
+
+    uint16_t bucket(const uint8_t index) const {
+      return buckets_[index];
+    }
+
+  private:
+    RunningMean mean_;
+    uint32_t min_us_ = 0xFFFFFFFF;
+    uint32_t max_us_ = 0;
+    uint16_t buckets_[kTimingBuckets] = {};
+};
+
+// ThermostatTask decorator layer that times the RunOnce of the layer it wraps.
+class TimingThermostatTask final : public ThermostatTask {
+  public:
+    // The name is shown on the status page, so it should fit in 7 characters.
+    explicit TimingThermostatTask(Clock* const clock, const char* const name,
+                                  ThermostatTask* const wrapped) :
+      clock_(clock),
+      name_(name),
+      wrapped_(wrapped) {};
+
+    Status RunOnce(Settings* settings) override {
+      const uint32_t start = clock_->Micros();
+      const Status status = wrapped_->RunOnce(settings);
+      stats_.Record(clock_->Micros() - start);
+      return status;
+    }
+
+    const char* name() const {
+      return name_;
+    }
+
+    const TimingStats& stats() const {
+      return stats_;
+    }
+
+    void Reset() {
+      stats_.Reset();
+    }
+
+  private:
+    Clock* const clock_;
+    const char* const name_;
+    ThermostatTask* const wrapped_;
+    TimingStats stats_;
+};
+
+// The timed layers, from the innermost one outwards, and the time between the button
+// polls of the main loop.
+class Timings {
+  public:
+    Timings(Clock* const clock, Print* const print,
+            TimingThermostatTask* const* const layers, const uint8_t layer_count) :
+      clock_(clock),
+      print_(print),
+      layers_(layers),
+      layer_count_(layer_count) {};
+
+    // Called at every button poll, which is once per main loop iteration. Records the
+    // microseconds since the previous poll.
+    void Poll() {
+      const uint32_t now = clock_->Micros();
+      if (polled_) {
+        loop_.Record(now - last_poll_us_);
+      }
+      polled_ = true;
+      last_poll_us_ = now;
+    }
+
+    const TimingStats& loop() const {
+      return loop_;
+    }
+
+    uint8_t layer_count() const {
+      return layer_count_;
+    }
+
+    const TimingThermostatTask& layer(const uint8_t index) const {
+      return *layers_[index];
+    }
+
+    // Mean time spent in the layer itself, without the timed layer it wraps.
+    uint32_t SelfMeanMicros(const uint8_t index) const {
+      const uint32_t mean = layers_[index]->stats().mean_us();
+      const uint32_t inner = index == 0 ? 0 : layers_[index - 1]->stats().mean_us();
+      return mean > inner ? mean - inner : 0;
+    }
+
+    // Writes a text table of the timings. Ends with a zero byte so a telemetry decoder
+    // reading the same port drops the table as one bad frame and stays in sync.
+    void Dump() const {
+      print_->println("name count min mean max self 2^0..2^15us");
+      DumpStats("loop", loop_, loop_.mean_us(), print_);
+      for (uint8_t i = 0; i < layer_count_; ++i) {
+        DumpStats(layers_[i]->name(), layers_[i]->stats(), SelfMeanMicros(i), print_);
+      }
+      print_->write(0);
+    }
+
+    void Reset() {
+      loop_.Reset();
+      polled_ = false;
+      for (uint8_t i = 0; i < layer_count_; ++i) {
+        layers_[i]->Reset();
+      }
+    }
+
+  private:
+    static void DumpStats(const char* const name, const TimingStats& stats,
+                          const uint32_t self_us, Print* const print) {
+      print->print(name);
+      print->print(' ');
+      print->print(static_cast<unsigned int>(stats.count()));
+      print->print(' ');
+      print->print(stats.min_us());
+      print->print(' ');
+      print->print(stats.mean_us());
+      print->print(' ');
+      print->print(stats.max_us());
+      print->print(' ');
+      print->print(self_us);
+      for (uint8_t i = 0; i < kTimingBuckets; ++i) {
+        print->print(i == 0 ? ' ' : ',');
+        print->print(static_cast<unsigned int>(stats.bucket(i)));
+      }
+      print->println();
+    }
+
+    Clock* const clock_;
+    Print* const print_;
+    TimingThermostatTask* const* const layers_;
+    const uint8_t layer_count_;
+
+    TimingStats loop_;
+    bool polled_ = false;
+    uint32_t last_poll_us_ = 0;
+};
+
+}  // namespace thermostat
+#endif  // TIMING_H_
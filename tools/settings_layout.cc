@@ -0,0 +1,97 @@
+// Prints the host layout of Settings and the structs in it, one line per field with its
+// offset, size and the gap in front of it. A gap is padding, or the bit fields declared
+// there.
+//
+//   settings_layout
+//
+// The AVR doesn't align anything, so its sizes are these without the padding. The budgets
+// the build checks are in settings.h.
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "thermostat/settings.h"
+
+namespace thermostat {
+namespace {
+
+struct Field {
+  const char* name;
+  size_t offset;
+  size_t size;
+};
+
+#define SETTINGS_FIELD(type, name) {#name, offsetof(type, name), sizeof(type::name)}
+
+// Prints the fields, which must be in declaration order. Whatever follows the last field
+// is printed as the tail.
+void PrintLayout(const char* const type, const size_t type_size, const Field* const fields,
+                 const size_t count) {
+  printf("%s: %zu bytes\n", type, type_size);
+  printf("  %-34s %6s %6s %6s\n", "field", "offset", "size", "gap");
+  size_t end = 0;
+  size_t gaps = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const Field& field = fields[i];
+    printf("  %-34s %6zu %6zu %6zu\n", field.name, field.offset, field.size,
+           field.offset - end);
+    gaps += field.offset - end;
+    end = field.offset + field.size;
+  }
+  printf("  %-34s %6zu %6zu\n", "(tail)", end, type_size - end);
+  printf("  gaps between the fields: %zu bytes\n\n", gaps);
+}
+
+int Main() {
+  const Field settings[] = {
+      SETTINGS_FIELD(Settings, events),
+      SETTINGS_FIELD(Settings, event_totals),
+      SETTINGS_FIELD(Settings, now),
+      SETTINGS_FIELD(Settings, override_temperature_started_ms),
+      SETTINGS_FIELD(Settings, persisted),
+      SETTINGS_FIELD(Settings, current_temperature_x10),
+      SETTINGS_FIELD(Settings, current_mean_temperature_x10),
+      SETTINGS_FIELD(Settings, heat_setpoint_x10),
+      SETTINGS_FIELD(Settings, override_temperature_x10),
+      SETTINGS_FIELD(Settings, free_memory_bytes),
+      SETTINGS_FIELD(Settings, min_free_memory_bytes),
+      SETTINGS_FIELD(Settings, heat_schedule),
+      SETTINGS_FIELD(Settings, cool_schedule),
+      SETTINGS_FIELD(Settings, hvac),
+      SETTINGS_FIELD(Settings, fan),
+      SETTINGS_FIELD(Settings, status),
+      SETTINGS_FIELD(Settings, current_humidity),
+      SETTINGS_FIELD(Settings, air_quality_score),
+  };
+  PrintLayout("Settings", sizeof(Settings), settings, sizeof(settings) / sizeof(settings[0]));
+
+  const Field persisted[] = {
+      SETTINGS_FIELD(PersistedSettings, version),
+      SETTINGS_FIELD(PersistedSettings, humidity_steps),
+      SETTINGS_FIELD(PersistedSettings, heat_setpoints),
+      SETTINGS_FIELD(PersistedSettings, cool_setpoints),
+      SETTINGS_FIELD(PersistedSettings, tolerance_x10),
+      SETTINGS_FIELD(PersistedSettings, fan_extend_mins),
+      SETTINGS_FIELD(PersistedSettings, fan_on_min_period),
+      SETTINGS_FIELD(PersistedSettings, fan_on_duty),
+  };
+  PrintLayout("PersistedSettings", sizeof(PersistedSettings), persisted,
+              sizeof(persisted) / sizeof(persisted[0]));
+
+  const Field totals[] = {
+      SETTINGS_FIELD(EventTotals, heat_ms),
+      SETTINGS_FIELD(EventTotals, cool_ms),
+      SETTINGS_FIELD(EventTotals, fan_ms),
+      SETTINGS_FIELD(EventTotals, heat_rise_x10),
+      SETTINGS_FIELD(EventTotals, heat_rise_count),
+      SETTINGS_FIELD(EventTotals, tail_age),
+      SETTINGS_FIELD(EventTotals, tail_start),
+  };
+  PrintLayout("EventTotals", sizeof(EventTotals), totals, sizeof(totals) / sizeof(totals[0]));
+  return 0;
+}
+
+}  // namespace
+}  // namespace thermostat
+
+int main() { return thermostat::Main(); }
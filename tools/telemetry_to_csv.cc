@@ -0,0 +1,108 @@
+// Converts a captured binary telemetry stream (see thermostat/telemetry.h) to CSV.
+//
+//   telemetry_to_csv [capture.bin] > telemetry.csv
+//
+// Reads stdin when no file is given, so it also works on a live port:
+//
+//   stty -F /dev/ttyACM0 38400 raw && telemetry_to_csv < /dev/ttyACM0
+//
+// Damaged frames are skipped and counted on stderr.
+#include <stdint.h>
+#include <stdio.h>
+
+#include "thermostat/telemetry.h"
+
+namespace thermostat {
+namespace {
+
+const char* HvacName(const uint8_t hvac) {
+  switch (static_cast<HvacMode>(hvac)) {
+    case HvacMode::EMPTY:
+      return "EMPTY";
+    case HvacMode::IDLE:
+      return "IDLE";
+    case HvacMode::HEAT:
+      return "HEAT";
+    case HvacMode::COOL:
+      return "COOL";
+    case HvacMode::HEAT_LOCKOUT:
+      return "HEAT_LOCKOUT";
+    case HvacMode::COOL_LOCKOUT:
+      return "COOL_LOCKOUT";
+  }
+  return "UNKNOWN";
+}
+
+const char* FanName(const uint8_t fan) {
+  switch (static_cast<FanMode>(fan)) {
+    case FanMode::EMPTY:
+      return "EMPTY";
+    case FanMode::ON:
+      return "ON";
+    case FanMode::OFF:
+      return "OFF";
+  }
+  return "UNKNOWN";
+}
+
+void PrintRecord(const TelemetryRecord& record) {
+  printf("%u,%.1f,%.1f,%u,%s,%s,%u,%d,%d,%u\n", static_cast<unsigned>(record.now_ms),
+         record.temperature_x10 / 10.0, record.mean_temperature_x10 / 10.0,
+         record.humidity, HvacName(record.modes & 0x0F),
+         FanName(record.modes >> 4), record.status,
+         (record.flags & kTelemetryHeatHigh) ? 1 : 0,
+         (record.flags & kTelemetryWithinTolerance) ? 1 : 0,
+         record.min_free_memory_bytes);
+}
+
+int Run(FILE* const in) {
+  printf(
+      "millis,temperature_f,mean_temperature_f,humidity,hvac,fan,"
+      "status,heat_high,within_tolerance,min_free_memory_bytes\n");
+
+  // Longer runs without a zero can't be a frame, keep dropping them until the next zero.
+  uint8_t frame[kTelemetryFrameSize];
+  size_t length = 0;
+  bool overflow = false;
+  uint64_t records = 0;
+  uint64_t damaged = 0;
+  int ch;
+  while ((ch = fgetc(in)) != EOF) {
+    if (ch != 0) {
+      if (length < sizeof(frame)) {
+        frame[length++] = ch;
+      } else {
+        overflow = true;
+      }
+      continue;
+    }
+    TelemetryRecord record;
+    if (overflow || !DecodeTelemetryFrame(frame, length, &record)) {
+      // Empty frames are just delimiters, such as the one sent at boot.
+      damaged += (overflow || length > 0) ? 1 : 0;
+    } else {
+      PrintRecord(record);
+      records++;
+    }
+    length = 0;
+    overflow = false;
+  }
+  fprintf(stderr, "%llu records, %llu damaged frames\n",
+          static_cast<unsigned long long>(records), static_cast<unsigned long long>(damaged));
+  return 0;
+}
+
+}  // namespace
+}  // namespace thermostat
+
+int main(int argc, char** argv) {
+  FILE* in = stdin;
+  if (argc > 1) {
+    in = fopen(argv[1], "rb");
+    if (in == nullptr) {
+      fprintf(stderr, "Can't open %s\n", argv[1]);
+      return 1;
+    }
+  }
+  return thermostat::Run(in);
+}